@@ -17,6 +17,19 @@
 #endif
 
 void InitializeSdkObjects(FbxManager*& pManager, FbxScene*& pScene)
+{
+	InitializeSdkManager(pManager);
+
+    //Create an FBX scene. This object holds most objects imported/exported from/to files.
+    pScene = FbxScene::Create(pManager, "My Scene");
+	if( !pScene )
+    {
+        FBXSDK_printf("Error: Unable to create FBX scene!\n");
+        exit(1);
+    }
+}
+
+void InitializeSdkManager(FbxManager*& pManager)
 {
     //The first thing to do is to create the FBX Manager which is the object allocator for almost all the classes in the SDK
     pManager = FbxManager::Create();
@@ -34,14 +47,6 @@ void InitializeSdkObjects(FbxManager*& pManager, FbxScene*& pScene)
 	//Load plugins from the executable directory (optional)
 	FbxString lPath = FbxGetApplicationDirectory();
 	pManager->LoadPluginsDirectory(lPath.Buffer());
-
-    //Create an FBX scene. This object holds most objects imported/exported from/to files.
-    pScene = FbxScene::Create(pManager, "My Scene");
-	if( !pScene )
-    {
-        FBXSDK_printf("Error: Unable to create FBX scene!\n");
-        exit(1);
-    }
 }
 
 void DestroySdkObjects(FbxManager* pManager, bool pExitStatus)
@@ -51,14 +56,8 @@ void DestroySdkObjects(FbxManager* pManager, bool pExitStatus)
 	if( pExitStatus ) FBXSDK_printf("Program Success!\n");
 }
 
-bool SaveScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename, int pFileFormat, bool pEmbedMedia)
+int GetExportFormat(FbxManager* pManager, int pFileFormat)
 {
-    int lMajor, lMinor, lRevision;
-    bool lStatus = true;
-
-    // Create an exporter.
-    FbxExporter* lExporter = FbxExporter::Create(pManager, "");
-
     if( pFileFormat < 0 || pFileFormat >= pManager->GetIOPluginRegistry()->GetWriterFormatCount() )
     {
         // Write in fall back format in less no ASCII format found
@@ -81,35 +80,75 @@ bool SaveScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename,
             }
         } 
     }
+    return pFileFormat;
+}
 
-    // Set the export states. By default, the export states are always set to 
-    // true except for the option eEXPORT_TEXTURE_AS_EMBEDDED. The code below 
-    // shows how to change these states.
-    IOS_REF.SetBoolProp(EXP_FBX_MATERIAL,        true);
-    IOS_REF.SetBoolProp(EXP_FBX_TEXTURE,         true);
+// Set the export states. By default, the export states are always set to 
+// true except for the option eEXPORT_TEXTURE_AS_EMBEDDED, and the geometry
+// related ones when only the animation is exported.
+static void SetExportSettings(FbxManager* pManager, bool pEmbedMedia, bool pExportGeometry)
+{
+    IOS_REF.SetBoolProp(EXP_FBX_MATERIAL,        pExportGeometry);
+    IOS_REF.SetBoolProp(EXP_FBX_TEXTURE,         pExportGeometry);
     IOS_REF.SetBoolProp(EXP_FBX_EMBEDDED,        pEmbedMedia);
-    IOS_REF.SetBoolProp(EXP_FBX_SHAPE,           true);
-    IOS_REF.SetBoolProp(EXP_FBX_GOBO,            true);
+    IOS_REF.SetBoolProp(EXP_FBX_SHAPE,           pExportGeometry);
+    IOS_REF.SetBoolProp(EXP_FBX_GOBO,            pExportGeometry);
     IOS_REF.SetBoolProp(EXP_FBX_ANIMATION,       true);
     IOS_REF.SetBoolProp(EXP_FBX_GLOBAL_SETTINGS, true);
+}
+
+// Export pScene through an exporter that has been initialized, then destroy the exporter.
+static bool ExportScene(FbxExporter* pExporter, FbxDocument* pScene)
+{
+    int lMajor, lMinor, lRevision;
+    FbxManager::GetFileFormatVersion(lMajor, lMinor, lRevision);
+    FBXSDK_printf("FBX file format version %d.%d.%d\n\n", lMajor, lMinor, lRevision);
+
+    // Export the scene.
+    bool lStatus = pExporter->Export(pScene); 
+
+    // Destroy the exporter.
+    pExporter->Destroy();
+    return lStatus;
+}
+
+bool SaveScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename, int pFileFormat, bool pEmbedMedia, bool pExportGeometry)
+{
+    // Create an exporter.
+    FbxExporter* lExporter = FbxExporter::Create(pManager, "");
+
+    pFileFormat = GetExportFormat(pManager, pFileFormat);
+    SetExportSettings(pManager, pEmbedMedia, pExportGeometry);
 
     // Initialize the exporter by providing a filename.
     if(lExporter->Initialize(pFilename, pFileFormat, pManager->GetIOSettings()) == false)
     {
         FBXSDK_printf("Call to FbxExporter::Initialize() failed.\n");
         FBXSDK_printf("Error returned: %s\n\n", lExporter->GetStatus().GetErrorString());
+        lExporter->Destroy();
         return false;
     }
 
-    FbxManager::GetFileFormatVersion(lMajor, lMinor, lRevision);
-    FBXSDK_printf("FBX file format version %d.%d.%d\n\n", lMajor, lMinor, lRevision);
+    return ExportScene(lExporter, pScene);
+}
 
-    // Export the scene.
-    lStatus = lExporter->Export(pScene); 
+bool SaveScene(FbxManager* pManager, FbxDocument* pScene, FbxStream* pStream, int pFileFormat, bool pEmbedMedia, bool pExportGeometry)
+{
+    FbxExporter* lExporter = FbxExporter::Create(pManager, "");
 
-    // Destroy the exporter.
-    lExporter->Destroy();
-    return lStatus;
+    pFileFormat = GetExportFormat(pManager, pFileFormat);
+    SetExportSettings(pManager, pEmbedMedia, pExportGeometry);
+
+    // Initialize the exporter with the stream; its GetWriterID() must match pFileFormat.
+    if(lExporter->Initialize(pStream, NULL, pFileFormat, pManager->GetIOSettings()) == false)
+    {
+        FBXSDK_printf("Call to FbxExporter::Initialize() failed.\n");
+        FBXSDK_printf("Error returned: %s\n\n", lExporter->GetStatus().GetErrorString());
+        lExporter->Destroy();
+        return false;
+    }
+
+    return ExportScene(lExporter, pScene);
 }
 
 bool LoadScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename)
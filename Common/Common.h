@@ -15,57 +15,53 @@
 #define _COMMON_H
 
 #include <fbxsdk.h>
-#include "nlohmann/json.hpp"
 #include<iostream>
 #include<fstream>
 
+struct PoseTrack;
+
 void InitializeSdkObjects(FbxManager*& pManager, FbxScene*& pScene);
+// Manager, IO settings and plugins only; scenes are created per conversion.
+void InitializeSdkManager(FbxManager*& pManager);
 void DestroySdkObjects(FbxManager* pManager, bool pExitStatus);
 
-bool SaveScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename, int pFileFormat=-1, bool pEmbedMedia=false);
+// pExportGeometry false turns the material, texture, shape and gobo export off.
+bool SaveScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename, int pFileFormat=-1, bool pEmbedMedia=false, bool pExportGeometry=true);
+// Same, written to pStream (e.g. an FbxMemoryStream created with GetExportFormat(pManager, pFileFormat)).
+bool SaveScene(FbxManager* pManager, FbxDocument* pScene, FbxStream* pStream, int pFileFormat=-1, bool pEmbedMedia=false, bool pExportGeometry=true);
+// Writer format index SaveScene uses for pFileFormat: out of range values select the ASCII FBX writer.
+int GetExportFormat(FbxManager* pManager, int pFileFormat);
 bool LoadScene(FbxManager* pManager, FbxDocument* pScene, const char* pFilename);
 
 // Create a camera
 FbxNode* CreateCamera(
 	FbxScene* pScene,
-	char* pName
+	const char* pName
 );
 
 void SetCameraDefaultPosition(
 	FbxNode* pCamera
 );
 
-void AnimatePosition(
+// Translation and rotation keys of a tracked device in a single pass, at
+// the key times BuildTimeline() stored in the track.
+void AnimateTrack(
 	FbxNode* pPosition,
+	FbxNode* pRotation,
 	FbxAnimLayer* pAnimLayer,
-    nlohmann::json& j,
-	std::string& nodeName
+	const PoseTrack& pTrack
 );
 
-void AnimateRotation(
+void AnimatePosition(
 	FbxNode* pPosition,
 	FbxAnimLayer* pAnimLayer,
-	nlohmann::json& j,
-	std::string & nodeName
-);
-
-void CreateMaterials(
-	FbxScene* pScene,
-	FbxMesh* pMesh
+	const PoseTrack& pTrack
 );
 
-FbxNode* CreatePyramidWithMaterials(
-	FbxScene* pScene,
-	char* pName,
-	const double& side, 
-	const double& height
-);
-
-FbxNode* CreatePyramidWithMaterialsRightHand(
-	FbxScene* pScene,
-	char* pName,
-	const double& side,
-	const double& height
+void AnimateRotation(
+	FbxNode* pPosition,
+	FbxAnimLayer* pAnimLayer,
+	const PoseTrack& pTrack
 );
 
 void SetMeshDefaultPosition(
@@ -77,7 +73,7 @@ void SetMeshDefaultPosition(
 // Create a marker to use a point of interest for the camera. 
 FbxNode* CreateMarker(
 	FbxScene* pScene,
-	char* pName
+	const char* pName
 );
 
 void SetMarkerDefaultPosition(
@@ -0,0 +1,100 @@
+#include "BenchData.h"
+#include "../src/KeyTime.h"
+#include "../src/PoseBuffer.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+namespace
+{
+	const char* const kTracks[] = { "camera", "left", "right" };
+	const int kTrackCount = 3;
+
+	struct Sample
+	{
+		double mPosition[3];
+		double mRotation[3];
+		double mTimestamp;
+	};
+
+	void ComputeSample(size_t pIndex, int pTrack, Sample& pSample)
+	{
+		double lT = double(pIndex) / 90.0 + pTrack;
+		pSample.mPosition[0] = 0.3 * sin(lT);
+		pSample.mPosition[1] = 1.6 + 0.05 * cos(lT * 0.7);
+		pSample.mPosition[2] = -0.4 * sin(lT * 0.3);
+		pSample.mRotation[0] = 20.0 * sin(lT * 0.5);
+		pSample.mRotation[1] = 180.0 * sin(lT * 0.05);
+		pSample.mRotation[2] = 5.0 * cos(lT);
+		pSample.mTimestamp = 1000.0 + double(pIndex) * 11.111;
+	}
+
+	int FormatPose(char* pBuffer, size_t pSize, size_t pIndex, int pTrack)
+	{
+		Sample s;
+		ComputeSample(pIndex, pTrack, s);
+		return snprintf(pBuffer, pSize,
+			"{\"position\":{\"x\":%.6f,\"y\":%.6f,\"z\":%.6f},"
+			"\"rotation\":{\"x\":%.4f,\"y\":%.4f,\"z\":%.4f},"
+			"\"timestamp\":%.3f}",
+			s.mPosition[0], s.mPosition[1], s.mPosition[2],
+			s.mRotation[0], s.mRotation[1], s.mRotation[2],
+			s.mTimestamp);
+	}
+}
+
+size_t WriteSyntheticRecording(const char* pFilename, size_t pTargetBytes)
+{
+	char lPose[256];
+	size_t lPoseBytes = size_t(FormatPose(lPose, sizeof(lPose), 0, 0)) + 1;
+	size_t lPoseCount = pTargetBytes / (lPoseBytes * kTrackCount);
+	if (lPoseCount == 0)
+		lPoseCount = 1;
+
+	FILE* lFile = fopen(pFilename, "wb");
+	if (!lFile)
+		return 0;
+
+	static char lBuffer[1 << 20];
+	setvbuf(lFile, lBuffer, _IOFBF, sizeof(lBuffer));
+
+	fputc('{', lFile);
+	for (int t = 0; t < kTrackCount; t++)
+	{
+		fprintf(lFile, "%s\"%s\":{\"poses\":[", t ? "," : "", kTracks[t]);
+		for (size_t i = 0; i < lPoseCount; i++)
+		{
+			if (i)
+				fputc(',', lFile);
+			int lLength = FormatPose(lPose, sizeof(lPose), i, t);
+			fwrite(lPose, 1, size_t(lLength), lFile);
+		}
+		fputs("],\"events\":[]}", lFile);
+	}
+	fputs("}\n", lFile);
+
+	bool lOk = ferror(lFile) == 0;
+	lOk = fclose(lFile) == 0 && lOk;
+	return lOk ? lPoseCount : 0;
+}
+
+void FillSyntheticTrack(PoseTrack& pTrack, size_t pCount)
+{
+	pTrack.Clear();
+	pTrack.Reserve(pCount);
+	for (size_t i = 0; i < pCount; i++)
+	{
+		Sample s;
+		ComputeSample(i, 0, s);
+		size_t lPose = pTrack.AddPose();
+		pTrack.mTimestamp[lPose] = int64_t(floor(s.mTimestamp * double(kMicrosecondsPerMillisecond) + 0.5));
+		pTrack.mPositionX[lPose] = float(s.mPosition[0]);
+		pTrack.mPositionY[lPose] = float(s.mPosition[1]);
+		pTrack.mPositionZ[lPose] = float(s.mPosition[2]);
+		pTrack.mRotationX[lPose] = float(s.mRotation[0]);
+		pTrack.mRotationY[lPose] = float(s.mRotation[1]);
+		pTrack.mRotationZ[lPose] = float(s.mRotation[2]);
+	}
+	BuildKeyTimes(pTrack, GetTrackStart(pTrack));
+}
@@ -0,0 +1,17 @@
+#ifndef _BENCH_DATA_H
+#define _BENCH_DATA_H
+
+#include <stddef.h>
+
+struct PoseTrack;
+
+// Write an A-Frame style recording with "camera", "left" and "right" tracks
+// of roughly pTargetBytes bytes. The content is deterministic.
+// Return the number of poses written per track, or 0 on failure.
+size_t WriteSyntheticRecording(const char* pFilename, size_t pTargetBytes);
+
+// Fill pTrack with pCount poses sampled at 90 Hz, same motion as above, and
+// build its key times.
+void FillSyntheticTrack(PoseTrack& pTrack, size_t pCount);
+
+#endif // #ifndef _BENCH_DATA_H
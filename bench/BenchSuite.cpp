@@ -0,0 +1,575 @@
+#include "BenchSuite.h"
+#include "BenchData.h"
+#include "../Common/Common.h"
+#include "../generator/SyntheticRecording.h"
+#include "../src/BinaryRecording.h"
+#include "../src/ConversionStats.h"
+#include "../src/KeyTime.h"
+#include "../src/ParallelIngest.h"
+#include "../src/PoseBuffer.h"
+#include "../src/SceneBuilder.h"
+#include "nlohmann/json.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using json = nlohmann::json;
+
+namespace
+{
+	typedef chrono::steady_clock Clock;
+
+	const char* const kSceneFile = "bench_suite.fbx";
+
+	double SecondsSince(const Clock::time_point& pStart)
+	{
+		return chrono::duration<double>(Clock::now() - pStart).count();
+	}
+
+	long long FileSize(const char* pFilename)
+	{
+		ifstream lFile(pFilename, ios::binary | ios::ate);
+		return lFile ? (long long)lFile.tellg() : -1;
+	}
+
+	struct SuiteSettings
+	{
+		vector<size_t> mSizes;		// poses per recording or track
+		vector<size_t> mDevices;	// devices per recording of the scaling benchmarks
+		int mIterations;			// 0 to derive the count from the size
+		int mWarmup;
+		string mOnly;				// run only the benchmarks starting with this
+		string mOutput;
+
+		SuiteSettings()
+			: mIterations(0), mWarmup(1), mOutput("bench_results.json")
+		{
+			mSizes.push_back(1000);
+			mSizes.push_back(100000);
+			mSizes.push_back(10000000);
+			mDevices.push_back(8);
+			mDevices.push_back(64);
+			mDevices.push_back(512);
+		}
+
+		bool Selected(const char* pName) const
+		{
+			return strncmp(pName, mOnly.c_str(), mOnly.size()) == 0;
+		}
+
+		// Many iterations for small inputs so the percentiles mean something,
+		// few for large ones. Depends on the size only, so runs are comparable.
+		int Iterations(size_t pPoses) const
+		{
+			if (mIterations > 0)
+				return mIterations;
+			size_t lIterations = 10000000 / (pPoses ? pPoses : 1);
+			return int(std::max<size_t>(5, std::min<size_t>(200, lIterations)));
+		}
+	};
+
+	// Run one iteration and return the seconds of the measured part, or a
+	// negative value if it failed. Setup and cleanup stay outside the timing.
+	typedef function<double()> Iteration;
+
+	struct Measurement
+	{
+		string mName;
+		size_t mPoses;
+		int mWarmup;
+		vector<double> mSeconds;	// sorted
+		double mWork;				// units of mUnit done by one iteration
+		const char* mUnit;
+
+		// Linear interpolation between the closest ranks.
+		double Percentile(double pPercent) const
+		{
+			double lRank = pPercent / 100.0 * double(mSeconds.size() - 1);
+			size_t lLower = size_t(lRank);
+			if (lLower + 1 >= mSeconds.size())
+				return mSeconds.back();
+			double lFraction = lRank - double(lLower);
+			return mSeconds[lLower] + (mSeconds[lLower + 1] - mSeconds[lLower]) * lFraction;
+		}
+
+		double Mean() const
+		{
+			double lSum = 0.0;
+			for (size_t i = 0; i < mSeconds.size(); i++)
+				lSum += mSeconds[i];
+			return lSum / double(mSeconds.size());
+		}
+
+		// Throughput at the median time.
+		double Rate() const
+		{
+			double lMedian = Percentile(50.0);
+			return lMedian > 0.0 ? mWork / lMedian : 0.0;
+		}
+	};
+
+	// Run the warmup and measured iterations of a benchmark. pWork is read
+	// after the iterations, so an iteration may set it (e.g. bytes written).
+	bool Measure(const SuiteSettings& pSettings, const char* pName, size_t pPoses, const double& pWork,
+		const char* pUnit, const Iteration& pIteration, vector<Measurement>& pResults)
+	{
+		if (!pSettings.Selected(pName))
+			return true;
+
+		Measurement lMeasurement;
+		lMeasurement.mName = pName;
+		lMeasurement.mPoses = pPoses;
+		lMeasurement.mWarmup = pSettings.mWarmup;
+		lMeasurement.mUnit = pUnit;
+
+		int lIterations = pSettings.Iterations(pPoses);
+		for (int i = 0; i < pSettings.mWarmup + lIterations; i++)
+		{
+			double lSeconds = pIteration();
+			if (lSeconds < 0.0)
+			{
+				printf("Error: %s failed on %u poses\n", pName, unsigned(pPoses));
+				return false;
+			}
+			if (i >= pSettings.mWarmup)
+				lMeasurement.mSeconds.push_back(lSeconds);
+		}
+		sort(lMeasurement.mSeconds.begin(), lMeasurement.mSeconds.end());
+		lMeasurement.mWork = pWork;
+
+		printf("%-16s %9u poses %4d x  p50 %10.3f ms  p99 %10.3f ms  %14.1f %s\n", pName, unsigned(pPoses), lIterations,
+			lMeasurement.Percentile(50.0) * 1000.0, lMeasurement.Percentile(99.0) * 1000.0, lMeasurement.Rate(), pUnit);
+		pResults.push_back(lMeasurement);
+		return true;
+	}
+
+	// Generate a recording of about pPoses poses over pDevices devices (camera,
+	// left, right, device3...) without dropped frames and read it into pText.
+	bool GenerateRecording(size_t pPoses, vector<char>& pText, int pDevices = 3)
+	{
+		GeneratorSettings lSettings;
+		lSettings.mDropRate = 0.0;
+		lSettings.mDeviceCount = pDevices;
+		size_t lFrames = (pPoses + lSettings.mDeviceCount - 1) / lSettings.mDeviceCount;
+		lSettings.mDuration = double(lFrames) / lSettings.mSampleRate;
+
+		FILE* lFile = tmpfile();
+		if (!lFile)
+			return false;
+
+		GeneratorStats lStats;
+		bool lOk = WriteGeneratedRecording(lFile, lSettings, lStats) && fseek(lFile, 0, SEEK_SET) == 0;
+		if (lOk)
+		{
+			pText.resize(size_t(lStats.mBytes));
+			lOk = fread(&pText[0], 1, pText.size(), lFile) == pText.size();
+		}
+		fclose(lFile);
+		return lOk;
+	}
+
+	// Time pAnimate on a new scene, layer and node.
+	double TimeAnimate(FbxManager* pManager, void (*pAnimate)(FbxNode*, FbxAnimLayer*, const PoseTrack&),
+		const PoseTrack& pTrack)
+	{
+		FbxScene* lScene = FbxScene::Create(pManager, "Bench");
+		FbxAnimStack* lStack = FbxAnimStack::Create(lScene, "Stack");
+		FbxAnimLayer* lLayer = FbxAnimLayer::Create(lScene, "Layer");
+		lStack->AddMember(lLayer);
+		FbxNode* lNode = FbxNode::Create(lScene, "Node");
+		lScene->GetRootNode()->AddChild(lNode);
+
+		Clock::time_point lStart = Clock::now();
+		pAnimate(lNode, lLayer, pTrack);
+		double lSeconds = SecondsSince(lStart);
+
+		lScene->Destroy();
+		return lSeconds;
+	}
+
+	// Time CreateScene on pRecording.
+	double TimeCreateScene(FbxManager* pManager, const PoseRecording& pRecording)
+	{
+		FbxScene* lScene = FbxScene::Create(pManager, "Bench");
+		ConversionStats lStats;
+
+		Clock::time_point lStart = Clock::now();
+		bool lOk = CreateScene(pManager, lScene, pRecording, lStats);
+		double lSeconds = SecondsSince(lStart);
+
+		lScene->Destroy();
+		return lOk ? lSeconds : -1.0;
+	}
+
+	// Time SaveScene of pScene and set pMegabytes to the size of the file.
+	double TimeSave(FbxManager* pManager, FbxScene* pScene, int pFileFormat, double& pMegabytes)
+	{
+		Clock::time_point lStart = Clock::now();
+		bool lOk = SaveScene(pManager, pScene, kSceneFile, pFileFormat);
+		double lSeconds = SecondsSince(lStart);
+
+		pMegabytes = double(FileSize(kSceneFile)) / (1 << 20);
+		return lOk ? lSeconds : -1.0;
+	}
+
+	// Every benchmark that depends on the input size, at pPoses poses.
+	bool RunSize(const SuiteSettings& pSettings, FbxManager* pManager, size_t pPoses, vector<Measurement>& pResults)
+	{
+		bool lIngest = pSettings.Selected("ingest_serial") || pSettings.Selected("ingest_parallel")
+			|| pSettings.Selected("ingest_m2fb");
+		bool lAnimate = pSettings.Selected("animate_position") || pSettings.Selected("animate_rotation");
+		bool lSave = pSettings.Selected("save_binary") || pSettings.Selected("save_ascii");
+
+		if (lIngest || lSave)
+		{
+			vector<char> lText;
+			if (!GenerateRecording(pPoses, lText))
+			{
+				printf("Error: Unable to generate a recording of %u poses\n", unsigned(pPoses));
+				return false;
+			}
+
+			PoseRecording lRecording;
+			if (!ReadPoseRecordingParallel(&lText[0], lText.size(), lRecording))
+				return false;
+
+			const char* lData = &lText[0];
+			size_t lSize = lText.size();
+			double lMegabytes = double(lSize) / (1 << 20);
+
+			bool lOk = Measure(pSettings, "ingest_serial", pPoses, lMegabytes, "MB/s", [&]()
+				{
+					PoseRecording lParsed;
+					Clock::time_point lStart = Clock::now();
+					bool lParsedOk = ReadPoseRecording(lData, lSize, lParsed);
+					return lParsedOk ? SecondsSince(lStart) : -1.0;
+				}, pResults);
+
+			lOk = lOk && Measure(pSettings, "ingest_parallel", pPoses, lMegabytes, "MB/s", [&]()
+				{
+					PoseRecording lParsed;
+					Clock::time_point lStart = Clock::now();
+					bool lParsedOk = ReadPoseRecordingParallel(lData, lSize, lParsed);
+					return lParsedOk ? SecondsSince(lStart) : -1.0;
+				}, pResults);
+
+			// the same recording stored as .m2fb, loaded from memory
+			std::ostringstream lBinaryStream(std::ios::binary);
+			lOk = lOk && WriteBinaryRecording(lBinaryStream, lRecording);
+			std::string lBinary = lBinaryStream.str();
+			double lBinaryMegabytes = double(lBinary.size()) / (1 << 20);
+
+			lOk = lOk && Measure(pSettings, "ingest_m2fb", pPoses, lBinaryMegabytes, "MB/s", [&]()
+				{
+					PoseRecording lLoaded;
+					Clock::time_point lStart = Clock::now();
+					bool lLoadedOk = ReadBinaryRecording(lBinary.data(), lBinary.size(), lLoaded);
+					return lLoadedOk ? SecondsSince(lStart) : -1.0;
+				}, pResults);
+
+			vector<char>().swap(lText);
+
+			if (lOk && lSave)
+			{
+				BuildTimeline(lRecording);
+				FbxScene* lScene = FbxScene::Create(pManager, "Bench");
+				ConversionStats lStats;
+				lOk = CreateScene(pManager, lScene, lRecording, lStats);
+
+				double lFileMegabytes = 0.0;
+				lOk = lOk && Measure(pSettings, "save_binary", pPoses, lFileMegabytes, "MB/s", [&]()
+					{
+						return TimeSave(pManager, lScene, 0, lFileMegabytes);
+					}, pResults);
+
+				lOk = lOk && Measure(pSettings, "save_ascii", pPoses, lFileMegabytes, "MB/s", [&]()
+					{
+						return TimeSave(pManager, lScene, -1, lFileMegabytes);
+					}, pResults);
+
+				lScene->Destroy();
+				remove(kSceneFile);
+			}
+
+			if (!lOk)
+				return false;
+		}
+
+		if (lAnimate)
+		{
+			PoseTrack lTrack;
+			FillSyntheticTrack(lTrack, pPoses);
+			double lKeys = 3.0 * double(pPoses);
+
+			bool lOk = Measure(pSettings, "animate_position", pPoses, lKeys, "keys/s", [&]()
+				{
+					return TimeAnimate(pManager, AnimatePosition, lTrack);
+				}, pResults);
+
+			lOk = lOk && Measure(pSettings, "animate_rotation", pPoses, lKeys, "keys/s", [&]()
+				{
+					return TimeAnimate(pManager, AnimateRotation, lTrack);
+				}, pResults);
+
+			if (!lOk)
+				return false;
+		}
+
+		return true;
+	}
+
+	// CreateScene with the curves of every device and SaveScene in binary
+	// format on a recording of pDevices devices, kDeviceFrames poses each.
+	// Devices per second stay the same as long as both scale linearly.
+	bool RunDevices(const SuiteSettings& pSettings, FbxManager* pManager, size_t pDevices, vector<Measurement>& pResults)
+	{
+		if (!pSettings.Selected("devices_scene") && !pSettings.Selected("devices_save"))
+			return true;
+
+		const size_t kDeviceFrames = 900;
+		size_t lPoses = pDevices * kDeviceFrames;
+		vector<char> lText;
+		PoseRecording lRecording;
+		if (!GenerateRecording(lPoses, lText, int(pDevices)) || !ReadPoseRecordingParallel(&lText[0], lText.size(), lRecording))
+		{
+			printf("Error: Unable to generate a recording of %u devices\n", unsigned(pDevices));
+			return false;
+		}
+		vector<char>().swap(lText);
+		BuildTimeline(lRecording);
+		double lDevices = double(pDevices);
+
+		bool lOk = Measure(pSettings, "devices_scene", lPoses, lDevices, "devices/s", [&]()
+			{
+				return TimeCreateScene(pManager, lRecording);
+			}, pResults);
+
+		if (lOk && pSettings.Selected("devices_save"))
+		{
+			FbxScene* lScene = FbxScene::Create(pManager, "Bench");
+			ConversionStats lStats;
+			lOk = CreateScene(pManager, lScene, lRecording, lStats);
+
+			double lFileMegabytes = 0.0;
+			lOk = lOk && Measure(pSettings, "devices_save", lPoses, lDevices, "devices/s", [&]()
+				{
+					return TimeSave(pManager, lScene, 0, lFileMegabytes);
+				}, pResults);
+
+			lScene->Destroy();
+			remove(kSceneFile);
+		}
+
+		return lOk;
+	}
+
+	// "1000", "100k", "10M"
+	bool ParseSizes(const char* pText, vector<size_t>& pSizes)
+	{
+		pSizes.clear();
+		const char* p = pText;
+		while (*p)
+		{
+			char* lEnd;
+			double lValue = strtod(p, &lEnd);
+			if (lEnd == p)
+				return false;
+			if (*lEnd == 'k' || *lEnd == 'K')
+				lValue *= 1e3, lEnd++;
+			else if (*lEnd == 'm' || *lEnd == 'M')
+				lValue *= 1e6, lEnd++;
+			if (lValue < 1.0 || (*lEnd != ',' && *lEnd != '\0'))
+				return false;
+
+			pSizes.push_back(size_t(lValue));
+			p = *lEnd == ',' ? lEnd + 1 : lEnd;
+		}
+		return !pSizes.empty();
+	}
+
+	bool ParseCount(const char* pText, int pMinimum, int& pCount)
+	{
+		char* lEnd;
+		long lValue = strtol(pText, &lEnd, 10);
+		pCount = int(lValue);
+		return lEnd != pText && *lEnd == '\0' && lValue >= pMinimum;
+	}
+
+	json ToJson(const Measurement& pMeasurement)
+	{
+		json lSeconds = json::object();
+		lSeconds["min"] = pMeasurement.mSeconds.front();
+		lSeconds["mean"] = pMeasurement.Mean();
+		lSeconds["p50"] = pMeasurement.Percentile(50.0);
+		lSeconds["p90"] = pMeasurement.Percentile(90.0);
+		lSeconds["p99"] = pMeasurement.Percentile(99.0);
+		lSeconds["max"] = pMeasurement.mSeconds.back();
+
+		json lResult = json::object();
+		lResult["name"] = pMeasurement.mName;
+		lResult["poses"] = pMeasurement.mPoses;
+		lResult["warmup"] = pMeasurement.mWarmup;
+		lResult["iterations"] = pMeasurement.mSeconds.size();
+		lResult["seconds"] = lSeconds;
+		lResult["unit"] = pMeasurement.mUnit;
+		lResult["rate"] = pMeasurement.Rate();
+		return lResult;
+	}
+
+	bool LoadResults(const char* pFilename, json& pResults)
+	{
+		ifstream lFile(pFilename);
+		if (!lFile)
+		{
+			printf("Error: Unable to open '%s'\n", pFilename);
+			return false;
+		}
+
+		try
+		{
+			lFile >> pResults;
+		}
+		catch (const exception& e)
+		{
+			printf("Error: Unable to parse '%s': %s\n", pFilename, e.what());
+			return false;
+		}
+
+		if (!pResults.is_object() || !pResults["benchmarks"].is_array())
+		{
+			printf("Error: '%s' is not a benchmark result file\n", pFilename);
+			return false;
+		}
+		return true;
+	}
+}
+
+int RunBenchSuite(int argc, char** argv)
+{
+	SuiteSettings lSettings;
+	for (int i = 2; i < argc; i++)
+	{
+		const char* lArg = argv[i];
+		bool lValid = i + 1 < argc;
+
+		if (strcmp(lArg, "--sizes") == 0)
+			lValid = lValid && ParseSizes(argv[++i], lSettings.mSizes);
+		else if (strcmp(lArg, "--devices") == 0)
+			lValid = lValid && ParseSizes(argv[++i], lSettings.mDevices);
+		else if (strcmp(lArg, "--iterations") == 0)
+			lValid = lValid && ParseCount(argv[++i], 1, lSettings.mIterations);
+		else if (strcmp(lArg, "--warmup") == 0)
+			lValid = lValid && ParseCount(argv[++i], 0, lSettings.mWarmup);
+		else if (strcmp(lArg, "--only") == 0 && lValid)
+			lSettings.mOnly = argv[++i];
+		else if (strcmp(lArg, "--output") == 0 && lValid)
+			lSettings.mOutput = argv[++i];
+		else
+		{
+			printf("Error: Unexpected argument '%s'\n", lArg);
+			return 1;
+		}
+
+		if (!lValid)
+		{
+			printf("Error: Invalid value for %s\n", lArg);
+			return 1;
+		}
+	}
+
+	FbxManager* lManager = NULL;
+	InitializeSdkManager(lManager);
+	if (!lManager)
+		return 1;
+
+	vector<Measurement> lResults;
+	bool lOk = Measure(lSettings, "create_scene", 0, 1.0, "scenes/s", [&]()
+		{
+			return TimeCreateScene(lManager, PoseRecording());
+		}, lResults);
+
+	for (size_t s = 0; lOk && s < lSettings.mSizes.size(); s++)
+		lOk = RunSize(lSettings, lManager, lSettings.mSizes[s], lResults);
+
+	for (size_t d = 0; lOk && d < lSettings.mDevices.size(); d++)
+		lOk = RunDevices(lSettings, lManager, lSettings.mDevices[d], lResults);
+
+	lManager->Destroy();
+	if (!lOk)
+		return 1;
+
+	json lBenchmarks = json::array();
+	for (size_t i = 0; i < lResults.size(); i++)
+		lBenchmarks.push_back(ToJson(lResults[i]));
+
+	json lReport = json::object();
+	lReport["hardware_threads"] = thread::hardware_concurrency();
+	lReport["benchmarks"] = lBenchmarks;
+
+	ofstream lFile(lSettings.mOutput.c_str());
+	lFile << lReport.dump(2) << "\n";
+	if (!lFile)
+	{
+		printf("Error: Unable to write '%s'\n", lSettings.mOutput.c_str());
+		return 1;
+	}
+	printf("Results written to %s\n", lSettings.mOutput.c_str());
+	return 0;
+}
+
+int CompareBenchResults(int argc, char** argv)
+{
+	if (argc < 4)
+	{
+		printf("usage: %s compare <baseline.json> <results.json> [<max slowdown %%>]\n", argv[0]);
+		return 1;
+	}
+	double lMaxSlowdown = argc > 4 ? atof(argv[4]) : 5.0;
+
+	json lBaseline, lCurrent;
+	if (!LoadResults(argv[2], lBaseline) || !LoadResults(argv[3], lCurrent))
+		return 1;
+
+	const json& lOld = lBaseline["benchmarks"];
+	const json& lNew = lCurrent["benchmarks"];
+
+	int lRegressions = 0;
+	printf("%-16s %9s %16s %16s %8s\n", "benchmark", "poses", "baseline", "current", "change");
+	for (size_t i = 0; i < lNew.size(); i++)
+	{
+		const json& lResult = lNew[i];
+		std::string lName = lResult["name"];
+		size_t lPoses = lResult["poses"];
+
+		for (size_t j = 0; j < lOld.size(); j++)
+		{
+			if (lOld[j]["name"] != lName || lOld[j]["poses"] != lPoses)
+				continue;
+
+			double lBefore = lOld[j]["rate"];
+			double lAfter = lResult["rate"];
+			double lChange = lBefore > 0.0 ? (lAfter / lBefore - 1.0) * 100.0 : 0.0;
+			bool lRegressed = lChange < -lMaxSlowdown;
+			if (lRegressed)
+				lRegressions++;
+
+			std::string lUnit = lResult["unit"];
+			printf("%-16s %9u %16.1f %16.1f %+7.1f%% %s%s\n", lName.c_str(), unsigned(lPoses), lBefore, lAfter, lChange,
+				lUnit.c_str(), lRegressed ? "  REGRESSION" : "");
+			break;
+		}
+	}
+
+	printf("%d regressions (slower by more than %g%%)\n", lRegressions, lMaxSlowdown);
+	return lRegressions ? 1 : 0;
+}
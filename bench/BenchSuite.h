@@ -0,0 +1,24 @@
+#ifndef _BENCH_SUITE_H
+#define _BENCH_SUITE_H
+
+// Benchmarks of the converter hot paths on generated recordings: JSON
+// ingest (single threaded and parallel), loading .m2fb, AnimatePosition, AnimateRotation,
+// CreateScene without animation and SaveScene in binary and ASCII format,
+// plus CreateScene and binary SaveScene on recordings of 8, 64 and 512
+// devices to check that both scale linearly with the device count.
+// Every benchmark runs a fixed number of warmup and measured iterations per
+// size, and the percentiles of the measured times plus the throughput at
+// the median are written as JSON.
+//
+//	motion2fbx_bench suite [--sizes 1000,100000,10000000] [--devices 8,64,512]
+//		[--iterations <n>] [--warmup <n>] [--only <name>] [--output <results.json>]
+int RunBenchSuite(int argc, char** argv);
+
+// Compare two result files of RunBenchSuite and list the throughput change
+// of every benchmark found in both. Return 1 if any of them got slower than
+// the allowed percentage (default 5), so it can gate a build.
+//
+//	motion2fbx_bench compare <baseline.json> <results.json> [<max slowdown %>]
+int CompareBenchResults(int argc, char** argv);
+
+#endif // #ifndef _BENCH_SUITE_H
@@ -0,0 +1,307 @@
+#include "BenchData.h"
+#include "BenchSuite.h"
+#include "../Common/Common.h"
+#include "../src/FastNumber.h"
+#include "../src/InputFile.h"
+#include "../src/ParallelIngest.h"
+#include "../src/PoseBuffer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+static double SecondsSince(const Clock::time_point& pStart)
+{
+	return chrono::duration<double>(Clock::now() - pStart).count();
+}
+
+static long long FileSize(const char* pFilename)
+{
+	ifstream lFile(pFilename, ios::binary | ios::ate);
+	return lFile ? (long long)lFile.tellg() : -1;
+}
+
+// Parse the recording through std::ifstream, as main() used to.
+static bool IngestStream(const char* pFilename, size_t& pPoses)
+{
+	ifstream lStream(pFilename);
+	PoseRecording lRecording;
+	if (!ReadPoseRecording(lStream, lRecording))
+		return false;
+	pPoses = lRecording.PoseCount();
+	return true;
+}
+
+// Parse the recording from a memory mapped view of the file.
+static bool IngestMapped(const char* pFilename, size_t& pPoses)
+{
+	InputFile lInput;
+	if (!lInput.Open(pFilename))
+		return false;
+	PoseRecording lRecording;
+	if (!ReadPoseRecording(lInput.GetData(), lInput.GetSize(), lRecording))
+		return false;
+	pPoses = lRecording.PoseCount();
+	return true;
+}
+
+// Parse the memory mapped recording with the chunked parser on every core.
+static bool IngestParallel(const char* pFilename, size_t& pPoses)
+{
+	InputFile lInput;
+	if (!lInput.Open(pFilename))
+		return false;
+	PoseRecording lRecording;
+	if (!ReadPoseRecordingParallel(lInput.GetData(), lInput.GetSize(), lRecording))
+		return false;
+	pPoses = lRecording.PoseCount();
+	return true;
+}
+
+static int BenchIngest(int argc, char** argv)
+{
+	size_t lMegabytes = argc > 2 ? size_t(atol(argv[2])) : 500;
+	string lFilename = argc > 3 ? argv[3] : "bench_recording.json";
+	const int lRuns = 3;
+
+	if (FileSize(lFilename.c_str()) <= 0)
+	{
+		printf("Generating %u MB recording '%s'...\n", unsigned(lMegabytes), lFilename.c_str());
+		if (!WriteSyntheticRecording(lFilename.c_str(), lMegabytes << 20))
+		{
+			printf("Error: Unable to write '%s'\n", lFilename.c_str());
+			return 1;
+		}
+	}
+
+	double lMegabytesRead = double(FileSize(lFilename.c_str())) / (1 << 20);
+	printf("Input: %s (%.1f MB), best of %d runs\n", lFilename.c_str(), lMegabytesRead, lRuns);
+
+	struct Method
+	{
+		const char* mName;
+		bool (*mIngest)(const char*, size_t&);
+	};
+	const Method lMethods[] = { { "ifstream", IngestStream }, { "mmap", IngestMapped }, { "parallel", IngestParallel } };
+
+	for (size_t m = 0; m < sizeof(lMethods) / sizeof(lMethods[0]); m++)
+	{
+		double lBest = 0.0;
+		size_t lPoses = 0;
+		for (int r = 0; r < lRuns; r++)
+		{
+			Clock::time_point lStart = Clock::now();
+			if (!lMethods[m].mIngest(lFilename.c_str(), lPoses))
+				return 1;
+			double lSeconds = SecondsSince(lStart);
+			if (r == 0 || lSeconds < lBest)
+				lBest = lSeconds;
+		}
+		printf("%-10s %8.3f s %8.1f MB/s %10u poses\n", lMethods[m].mName, lBest,
+			lMegabytesRead / lBest, unsigned(lPoses));
+	}
+
+	return 0;
+}
+
+// Compare strtod() with the pose number kernel on typical pose field text.
+static int BenchNumbers(int argc, char** argv)
+{
+	size_t lCount = argc > 2 ? size_t(atol(argv[2])) : 1000000;
+	const int lRuns = 3;
+
+	// half short fixed point values, half full precision JavaScript doubles
+	vector<string> lTexts(lCount);
+	char lBuffer[64];
+	unsigned lSeed = 12345;
+	for (size_t i = 0; i < lCount; i++)
+	{
+		lSeed = lSeed * 1103515245u + 12345u;
+		double lValue = (double(lSeed >> 8) / double(1 << 24) - 0.5) * 360.0;
+		snprintf(lBuffer, sizeof(lBuffer), i % 2 ? "%.17g" : "%.6f", lValue);
+		lTexts[i] = lBuffer;
+	}
+
+	double lBestStrtod = 0.0, lBestKernel = 0.0, lSum = 0.0;
+	for (int r = 0; r < lRuns; r++)
+	{
+		Clock::time_point lStart = Clock::now();
+		for (size_t i = 0; i < lCount; i++)
+			lSum += float(strtod(lTexts[i].c_str(), NULL));
+		double lSeconds = SecondsSince(lStart);
+		if (r == 0 || lSeconds < lBestStrtod)
+			lBestStrtod = lSeconds;
+
+		lStart = Clock::now();
+		for (size_t i = 0; i < lCount; i++)
+		{
+			float lValue = 0.0f;
+			ParseJsonNumber(lTexts[i].data(), lTexts[i].data() + lTexts[i].size(), lValue);
+			lSum += lValue;
+		}
+		lSeconds = SecondsSince(lStart);
+		if (r == 0 || lSeconds < lBestKernel)
+			lBestKernel = lSeconds;
+	}
+
+	printf("%u numbers, best of %d runs (checksum %g)\n", unsigned(lCount), lRuns, lSum);
+	printf("%-10s %8.1f ns/number\n", "strtod", lBestStrtod * 1e9 / double(lCount));
+	printf("%-10s %8.1f ns/number\n", "kernel", lBestKernel * 1e9 / double(lCount));
+	return 0;
+}
+
+// Documents around the strings and timestamps of a pose, which the serial
+// and the parallel parser must both accept with the same poses or both
+// reject.
+static const char* const kParserDocuments[] = {
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"ok \\\" \\\\ \\/ \\b \\f \\n \\r \\t \\u00e9 \\ud83d\\ude00\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"caf\xc3\xa9 \xf0\x9f\x98\x80\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"bad\\q\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"tab\there\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"\\u12\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"\\ud83d\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"\\ude00\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"\xc0\xaf\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"\xed\xa0\x80\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"\xf4\x90\x80\x80\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000,\"note\":\"\xe2\x82\"}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000}]},\"na\\u006De\":\"x\\\\\"}",
+	"{\"camera\":{\"poses\":[{\"position\":{\"x\":1}},{\"timestamp\":1000},{\"timestamp\":1011}]}}",
+	"{\"camera\":{\"poses\":[{\"timestamp\":1000},{\"position\":{\"x\":1}},{\"timestamp\":1011}]}}"
+};
+
+static bool SameRecording(const PoseRecording& pA, const PoseRecording& pB)
+{
+	if (pA.mTracks.size() != pB.mTracks.size())
+		return false;
+	for (size_t t = 0; t < pA.mTracks.size(); t++)
+	{
+		const PoseTrack& lA = pA.mTracks[t];
+		const PoseTrack& lB = pB.mTracks[t];
+		if (lA.mName != lB.mName || lA.mTimestamp != lB.mTimestamp || lA.mPositionX != lB.mPositionX
+			|| lA.mPositionY != lB.mPositionY || lA.mPositionZ != lB.mPositionZ || lA.mRotationX != lB.mRotationX
+			|| lA.mRotationY != lB.mRotationY || lA.mRotationZ != lB.mRotationZ)
+			return false;
+	}
+	return true;
+}
+
+// Check that ReadPoseRecordingParallel() accepts and rejects the same
+// documents as ReadPoseRecording().
+static int CheckParsers(int, char**)
+{
+	int lFailures = 0;
+	size_t lCount = sizeof(kParserDocuments) / sizeof(kParserDocuments[0]);
+	for (size_t i = 0; i < lCount; i++)
+	{
+		const char* lText = kParserDocuments[i];
+		PoseRecording lSerial, lParallel;
+		bool lSerialOk = ReadPoseRecording(lText, strlen(lText), lSerial);
+		bool lParallelOk = ReadPoseRecordingParallel(lText, strlen(lText), lParallel);
+		bool lAgree = lSerialOk == lParallelOk && (!lSerialOk || SameRecording(lSerial, lParallel));
+		printf("%-8s document %u: serial %s, parallel %s\n", lAgree ? "ok" : "MISMATCH", unsigned(i),
+			lSerialOk ? "accepts" : "rejects", lParallelOk ? "accepts" : "rejects");
+		if (!lAgree)
+			lFailures++;
+	}
+	printf("%d of %u documents parsed differently\n", lFailures, unsigned(lCount));
+	return lFailures == 0 ? 0 : 1;
+}
+
+// Curve construction as it was before keys were batched: every key of every
+// component re-fetches the curve and opens/closes it for modification.
+static void AnimatePositionPerKey(FbxNode* pPosition, FbxAnimLayer* pAnimLayer, const PoseTrack& pTrack)
+{
+	FbxTime lTime;
+	const char* lComponents[] = { FBXSDK_CURVENODE_COMPONENT_X, FBXSDK_CURVENODE_COMPONENT_Y, FBXSDK_CURVENODE_COMPONENT_Z };
+	const vector<float>* lValues[] = { &pTrack.mPositionX, &pTrack.mPositionY, &pTrack.mPositionZ };
+
+	pPosition->LclTranslation.GetCurveNode(pAnimLayer, true);
+	for (size_t i = 0; i < pTrack.Size(); i++)
+	{
+		for (int c = 0; c < 3; c++)
+		{
+			FbxAnimCurve* lCurve = pPosition->LclTranslation.GetCurve(pAnimLayer, lComponents[c], true);
+			lCurve->KeyModifyBegin();
+			lTime.Set(pTrack.mKeyTime[i]);
+			int lKeyIndex = lCurve->KeyAdd(lTime);
+			lCurve->KeySet(lKeyIndex, lTime, (*lValues[c])[i] * 100.0f, FbxAnimCurveDef::eInterpolationLinear);
+			lCurve->KeyModifyEnd();
+		}
+	}
+}
+
+// Time the per-key and the batched construction of three translation curves.
+static int BenchCurves(int argc, char** argv)
+{
+	size_t lPoses = argc > 2 ? size_t(atol(argv[2])) : 1000000;
+
+	PoseTrack lTrack;
+	FillSyntheticTrack(lTrack, lPoses);
+
+	struct Method
+	{
+		const char* mName;
+		void (*mAnimate)(FbxNode*, FbxAnimLayer*, const PoseTrack&);
+	};
+	const Method lMethods[] = { { "per-key", AnimatePositionPerKey }, { "batched", AnimatePosition } };
+
+	printf("%u poses, 3 curves\n", unsigned(lPoses));
+	for (size_t m = 0; m < sizeof(lMethods) / sizeof(lMethods[0]); m++)
+	{
+		FbxManager* lManager = FbxManager::Create();
+		FbxScene* lScene = FbxScene::Create(lManager, "Bench");
+		FbxAnimStack* lStack = FbxAnimStack::Create(lScene, "Stack");
+		FbxAnimLayer* lLayer = FbxAnimLayer::Create(lScene, "Layer");
+		lStack->AddMember(lLayer);
+		FbxNode* lNode = FbxNode::Create(lScene, "Node");
+		lScene->GetRootNode()->AddChild(lNode);
+
+		Clock::time_point lStart = Clock::now();
+		lMethods[m].mAnimate(lNode, lLayer, lTrack);
+		double lSeconds = SecondsSince(lStart);
+
+		double lKeys = 3.0 * double(lPoses);
+		printf("%-10s %8.3f s %12.0f keys/s\n", lMethods[m].mName, lSeconds, lKeys / lSeconds);
+		lManager->Destroy();
+	}
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if (argc < 2)
+	{
+		printf("usage: %s ingest [<megabytes>] [<recording.json>]\n", argv[0]);
+		printf("       %s numbers [<count>]\n", argv[0]);
+		printf("       %s curves [<poses>]\n", argv[0]);
+		printf("       %s parsers\n", argv[0]);
+		printf("       %s suite [--sizes 1000,100000,10000000] [--devices 8,64,512] [--iterations <n>] [--warmup <n>] [--only <name>] [--output <results.json>]\n", argv[0]);
+		printf("       %s compare <baseline.json> <results.json> [<max slowdown %%>]\n", argv[0]);
+		return 0;
+	}
+
+	if (strcmp(argv[1], "ingest") == 0)
+		return BenchIngest(argc, argv);
+	if (strcmp(argv[1], "numbers") == 0)
+		return BenchNumbers(argc, argv);
+	if (strcmp(argv[1], "curves") == 0)
+		return BenchCurves(argc, argv);
+	if (strcmp(argv[1], "parsers") == 0)
+		return CheckParsers(argc, argv);
+	if (strcmp(argv[1], "suite") == 0)
+		return RunBenchSuite(argc, argv);
+	if (strcmp(argv[1], "compare") == 0)
+		return CompareBenchResults(argc, argv);
+
+	printf("Unknown benchmark '%s'\n", argv[1]);
+	return 1;
+}
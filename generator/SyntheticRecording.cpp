@@ -0,0 +1,376 @@
+#include "SyntheticRecording.h"
+
+#include <cmath>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+namespace
+{
+	const double kPi = 3.14159265358979323846;
+
+	// recordings start at this performance.now() time, in milliseconds
+	const double kStartTime = 1000.0;
+
+	// frames formatted by one thread at a time
+	const uint64_t kChunkFrames = 32 * 1024;
+
+	// dropped frames come in runs of this length (a hitch of the browser)
+	const int kDropRun = 3;
+
+	// random streams; device streams are offset by kStreamsPerDevice * device
+	enum ERandomStream
+	{
+		eJitterStream,
+		eDropStream,
+		eNoiseStream,		// 6 components
+		eMotionStream = eNoiseStream + 6,
+		kStreamsPerDevice = 64
+	};
+
+	// splitmix64 finalizer: every random value is a hash of (seed, frame,
+	// stream), so any frame can be generated on any thread.
+	uint64_t Mix(uint64_t x)
+	{
+		x += 0x9e3779b97f4a7c15ULL;
+		x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+		x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+		return x ^ (x >> 31);
+	}
+
+	uint64_t Hash(uint64_t pSeed, uint64_t pFrame, uint64_t pStream)
+	{
+		return Mix(Mix(pSeed ^ Mix(pFrame)) ^ pStream);
+	}
+
+	// [0, 1)
+	double Uniform(uint64_t pSeed, uint64_t pFrame, uint64_t pStream)
+	{
+		return double(Hash(pSeed, pFrame, pStream) >> 11) * (1.0 / 9007199254740992.0);
+	}
+
+	// Approximately standard normal: the sum of four 16 bit uniforms of one
+	// hash (Irwin-Hall), scaled to unit variance. Good enough for noise and
+	// much cheaper than Box-Muller.
+	double Gaussian(uint64_t pSeed, uint64_t pFrame, uint64_t pStream)
+	{
+		uint64_t lBits = Hash(pSeed, pFrame, pStream);
+		double lSum = double((lBits & 0xffff) + ((lBits >> 16) & 0xffff) + ((lBits >> 32) & 0xffff) + (lBits >> 48));
+		return (lSum * (1.0 / 65536.0) - 2.0) * 1.7320508075688772;
+	}
+
+	// Smooth motion of one component: a base value plus three sines.
+	struct Channel
+	{
+		double mBase;
+		double mAmplitude[3];
+		double mFrequency[3];	// radians per second
+		double mPhase[3];
+	};
+
+	// sin(w * t + phase) on a grid of frames: sin(x + d) = 2 cos(d) sin(x) - sin(x - d)
+	struct SineSequence
+	{
+		double mCurrent;
+		double mPrevious;
+		double mFactor;
+
+		void Start(double pFrequency, double pPhase, double pTime, double pStep)
+		{
+			mCurrent = sin(pFrequency * pTime + pPhase);
+			mPrevious = sin(pFrequency * (pTime - pStep) + pPhase);
+			mFactor = 2.0 * cos(pFrequency * pStep);
+		}
+
+		void Next()
+		{
+			double lNext = mFactor * mCurrent - mPrevious;
+			mPrevious = mCurrent;
+			mCurrent = lNext;
+		}
+	};
+
+	// Head or hand like motion of a device: positions in meters, Euler angles in degrees.
+	struct DeviceMotion
+	{
+		Channel mChannels[6];
+
+		DeviceMotion(uint64_t pSeed, int pDevice)
+		{
+			// camera at head height, hands below and in front of it, further devices around the user
+			double lBase[3];
+			if (pDevice == 0)
+			{
+				lBase[0] = 0.0; lBase[1] = 1.6; lBase[2] = 0.0;
+			}
+			else if (pDevice <= 2)
+			{
+				lBase[0] = pDevice == 1 ? -0.25 : 0.25; lBase[1] = 1.2; lBase[2] = -0.3;
+			}
+			else
+			{
+				double lAngle = 2.0 * kPi * Uniform(pSeed, pDevice, eMotionStream);
+				lBase[0] = 1.5 * cos(lAngle); lBase[1] = 0.2 + 1.5 * Uniform(pSeed, pDevice, eMotionStream + 1); lBase[2] = 1.5 * sin(lAngle);
+			}
+
+			// amplitude ranges: position (m), pitch, yaw, roll (deg)
+			const double lMaxAmplitude[6] = { 0.3, 0.1, 0.3, 30.0, 180.0, 10.0 };
+			const double lMaxFrequency[6] = { 0.8, 0.8, 0.8, 0.6, 0.1, 0.6 };
+
+			uint64_t lStream = uint64_t(eMotionStream + 2) * 64;
+			for (int c = 0; c < 6; c++)
+			{
+				Channel& lChannel = mChannels[c];
+				lChannel.mBase = c < 3 ? lBase[c] : 0.0;
+				for (int k = 0; k < 3; k++)
+				{
+					lChannel.mAmplitude[k] = lMaxAmplitude[c] / (k + 1) * (0.5 + 0.5 * Uniform(pSeed, pDevice, lStream++));
+					lChannel.mFrequency[k] = 2.0 * kPi * lMaxFrequency[c] * (k + 1) * (0.2 + 0.8 * Uniform(pSeed, pDevice, lStream++));
+					lChannel.mPhase[k] = 2.0 * kPi * Uniform(pSeed, pDevice, lStream++);
+				}
+			}
+		}
+	};
+
+	bool IsDropped(const GeneratorSettings& pSettings, uint64_t pFrame)
+	{
+		if (pSettings.mDropRate <= 0.0 || pFrame == 0)
+			return false;
+		double lStartRate = pSettings.mDropRate / kDropRun;
+		for (int r = 0; r < kDropRun && uint64_t(r) <= pFrame; r++)
+		{
+			if (Uniform(pSettings.mSeed, pFrame - r, eDropStream) < lStartRate)
+				return true;
+		}
+		return false;
+	}
+
+	// Frame time in milliseconds; jitter stays within 40% of a frame so timestamps keep increasing.
+	double FrameTime(const GeneratorSettings& pSettings, uint64_t pFrame)
+	{
+		double lPeriod = 1000.0 / pSettings.mSampleRate;
+		double lTime = kStartTime + double(pFrame) * lPeriod;
+		if (pSettings.mJitter > 0.0)
+		{
+			double lJitter = pSettings.mJitter * Gaussian(pSettings.mSeed, pFrame, eJitterStream);
+			double lLimit = 0.4 * lPeriod;
+			lTime += lJitter < -lLimit ? -lLimit : (lJitter > lLimit ? lLimit : lJitter);
+		}
+		return lTime;
+	}
+
+	// printf("%.*f") without the locale and format parsing overhead.
+	char* WriteFixed(char* p, double pValue, int pDecimals)
+	{
+		static const double kScales[] = { 1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0 };
+
+		double lScaled = floor(fabs(pValue) * kScales[pDecimals] + 0.5);
+		uint64_t lDigits = uint64_t(lScaled);
+		if (pValue < 0.0)
+			*p++ = '-';
+
+		char lText[32];
+		int lLength = 0;
+		do
+		{
+			lText[lLength++] = char('0' + lDigits % 10);
+			lDigits /= 10;
+		} while (lDigits > 0 || lLength <= pDecimals);
+
+		for (int i = lLength - 1; i >= 0; i--)
+		{
+			*p++ = lText[i];
+			if (i == pDecimals && pDecimals > 0)
+				*p++ = '.';
+		}
+		return p;
+	}
+
+	char* WriteText(char* p, const char* pText, size_t pLength)
+	{
+		memcpy(p, pText, pLength);
+		return p + pLength;
+	}
+
+	#define WRITE_LITERAL(p, text) WriteText(p, text, sizeof(text) - 1)
+
+	// Append the poses of frames [pBegin, pEnd) of one device, each preceded by a comma.
+	void FormatChunk(const GeneratorSettings& pSettings, const DeviceMotion& pMotion, int pDevice,
+		uint64_t pBegin, uint64_t pEnd, std::vector<char>& pText, uint64_t& pPoses)
+	{
+		const size_t kMaxPoseBytes = 256;
+		pText.resize(size_t(pEnd - pBegin) * kMaxPoseBytes);
+		char* p = pText.empty() ? NULL : &pText[0];
+		char* lStart = p;
+
+		uint64_t lNoiseStream = uint64_t(pDevice) * kStreamsPerDevice + eNoiseStream;
+		pPoses = 0;
+
+		// the motion is sampled on the frame grid; chunks start from exact
+		// values, so the output does not depend on how frames are split
+		double lStep = 1.0 / pSettings.mSampleRate;
+		SineSequence lSines[6][3];
+		for (int c = 0; c < 6; c++)
+			for (int k = 0; k < 3; k++)
+				lSines[c][k].Start(pMotion.mChannels[c].mFrequency[k], pMotion.mChannels[c].mPhase[k], double(pBegin) * lStep, lStep);
+
+		for (uint64_t f = pBegin; f < pEnd; f++)
+		{
+			double lValues[6];
+			for (int c = 0; c < 6; c++)
+			{
+				const Channel& lChannel = pMotion.mChannels[c];
+				lValues[c] = lChannel.mBase
+					+ lChannel.mAmplitude[0] * lSines[c][0].mCurrent
+					+ lChannel.mAmplitude[1] * lSines[c][1].mCurrent
+					+ lChannel.mAmplitude[2] * lSines[c][2].mCurrent;
+				for (int k = 0; k < 3; k++)
+					lSines[c][k].Next();
+			}
+
+			if (IsDropped(pSettings, f))
+				continue;
+
+			double lTimestamp = FrameTime(pSettings, f);
+
+			for (int c = 0; c < 6; c++)
+			{
+				double lNoise = c < 3 ? pSettings.mPositionNoise / 100.0 : pSettings.mRotationNoise;
+				if (lNoise > 0.0)
+					lValues[c] += lNoise * Gaussian(pSettings.mSeed, f, lNoiseStream + c);
+			}
+
+			// yaw is reported in [-180, 180), like A-Frame does for a turning user
+			lValues[4] = fmod(lValues[4] + 180.0, 360.0);
+			if (lValues[4] < 0.0)
+				lValues[4] += 360.0;
+			lValues[4] -= 180.0;
+
+			p = WRITE_LITERAL(p, ",{\"position\":{\"x\":");
+			p = WriteFixed(p, lValues[0], 6);
+			p = WRITE_LITERAL(p, ",\"y\":");
+			p = WriteFixed(p, lValues[1], 6);
+			p = WRITE_LITERAL(p, ",\"z\":");
+			p = WriteFixed(p, lValues[2], 6);
+			p = WRITE_LITERAL(p, "},\"rotation\":{\"x\":");
+			p = WriteFixed(p, lValues[3], 4);
+			p = WRITE_LITERAL(p, ",\"y\":");
+			p = WriteFixed(p, lValues[4], 4);
+			p = WRITE_LITERAL(p, ",\"z\":");
+			p = WriteFixed(p, lValues[5], 4);
+			p = WRITE_LITERAL(p, "},\"timestamp\":");
+			p = WriteFixed(p, lTimestamp, 3);
+			*p++ = '}';
+			pPoses++;
+		}
+
+		pText.resize(size_t(p - lStart));
+	}
+
+	bool WriteBytes(FILE* pFile, const char* pData, size_t pSize, GeneratorStats& pStats)
+	{
+		pStats.mBytes += pSize;
+		return pSize == 0 || fwrite(pData, 1, pSize, pFile) == pSize;
+	}
+
+	bool WriteString(FILE* pFile, const std::string& pText, GeneratorStats& pStats)
+	{
+		return WriteBytes(pFile, pText.data(), pText.size(), pStats);
+	}
+}
+
+GeneratorSettings::GeneratorSettings()
+	: mDuration(60.0), mSampleRate(90.0), mDeviceCount(3), mJitter(0.5), mDropRate(0.01),
+	mPositionNoise(0.05), mRotationNoise(0.05), mSeed(1), mThreadCount(0)
+{
+}
+
+uint64_t GeneratorSettings::FrameCount() const
+{
+	double lFrames = floor(mDuration * mSampleRate + 0.5);
+	return lFrames < 1.0 ? 1 : uint64_t(lFrames);
+}
+
+GeneratorStats::GeneratorStats()
+	: mPoses(0), mBytes(0)
+{
+}
+
+std::string GetDeviceName(int pIndex)
+{
+	static const char* lNames[] = { "camera", "left", "right" };
+	if (pIndex < 3)
+		return lNames[pIndex];
+	char lName[32];
+	snprintf(lName, sizeof(lName), "device%d", pIndex);
+	return lName;
+}
+
+double EstimatePoseBytes(const GeneratorSettings& pSettings)
+{
+	GeneratorSettings lSample = pSettings;
+	DeviceMotion lMotion(lSample.mSeed, 0);
+	std::vector<char> lText;
+	uint64_t lPoses;
+	FormatChunk(lSample, lMotion, 0, 0, 1000, lText, lPoses);
+	return lPoses ? double(lText.size()) / double(lPoses) : 150.0;
+}
+
+bool WriteGeneratedRecording(FILE* pFile, const GeneratorSettings& pSettings, GeneratorStats& pStats)
+{
+	unsigned lThreadCount = pSettings.mThreadCount ? pSettings.mThreadCount : std::thread::hardware_concurrency();
+	if (lThreadCount == 0)
+		lThreadCount = 1;
+
+	uint64_t lFrameCount = pSettings.FrameCount();
+	std::vector<std::vector<char> > lTexts(lThreadCount);
+	std::vector<uint64_t> lPoses(lThreadCount);
+	bool lOk = WriteBytes(pFile, "{", 1, pStats);
+
+	for (int d = 0; d < pSettings.mDeviceCount && lOk; d++)
+	{
+		DeviceMotion lMotion(pSettings.mSeed, d);
+		lOk = WriteString(pFile, std::string(d ? "," : "") + "\"" + GetDeviceName(d) + "\":{\"poses\":[", pStats);
+		bool lFirst = true;
+
+		// each round formats one chunk per thread, then writes them in frame order
+		for (uint64_t lRound = 0; lRound < lFrameCount && lOk; lRound += kChunkFrames * lThreadCount)
+		{
+			std::vector<std::thread> lThreads;
+			for (unsigned t = 0; t < lThreadCount; t++)
+			{
+				uint64_t lBegin = lRound + t * kChunkFrames;
+				uint64_t lEnd = lBegin + kChunkFrames < lFrameCount ? lBegin + kChunkFrames : lFrameCount;
+				if (lBegin >= lEnd)
+				{
+					lTexts[t].clear();
+					lPoses[t] = 0;
+					continue;
+				}
+				auto lTask = [&, t, d, lBegin, lEnd]() { FormatChunk(pSettings, lMotion, d, lBegin, lEnd, lTexts[t], lPoses[t]); };
+				if (t + 1 < lThreadCount)
+					lThreads.push_back(std::thread(lTask));
+				else
+					lTask();
+			}
+			for (size_t i = 0; i < lThreads.size(); i++)
+				lThreads[i].join();
+
+			for (unsigned t = 0; t < lThreadCount && lOk; t++)
+			{
+				if (lTexts[t].empty())
+					continue;
+				// the first pose of the device has no comma in front of it
+				size_t lSkip = lFirst ? 1 : 0;
+				lOk = WriteBytes(pFile, &lTexts[t][lSkip], lTexts[t].size() - lSkip, pStats);
+				pStats.mPoses += lPoses[t];
+				lFirst = false;
+			}
+		}
+
+		lOk = lOk && WriteString(pFile, "],\"events\":[]}", pStats);
+	}
+
+	lOk = lOk && WriteString(pFile, "}\n", pStats);
+	return lOk && fflush(pFile) == 0;
+}
@@ -0,0 +1,45 @@
+#ifndef _SYNTHETIC_RECORDING_H
+#define _SYNTHETIC_RECORDING_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string>
+
+// Shape of a generated A-Frame motion capture recording.
+struct GeneratorSettings
+{
+	double mDuration;			// seconds
+	double mSampleRate;			// poses per second and device
+	int mDeviceCount;			// "camera", "left", "right", then "device3", "device4"...
+	double mJitter;				// standard deviation of the timestamp jitter, milliseconds
+	double mDropRate;			// share of frames missing from the recording
+	double mPositionNoise;		// standard deviation, centimeters
+	double mRotationNoise;		// standard deviation, degrees
+	uint64_t mSeed;
+	unsigned mThreadCount;		// 0 for one per hardware thread
+
+	GeneratorSettings();
+
+	uint64_t FrameCount() const;
+};
+
+struct GeneratorStats
+{
+	uint64_t mPoses;		// over all devices
+	uint64_t mBytes;
+
+	GeneratorStats();
+};
+
+// Name of device pIndex.
+std::string GetDeviceName(int pIndex);
+
+// Write the recording as JSON to pFile. The output depends only on the
+// settings (not on the thread count), so a seed always reproduces the same
+// bytes. Return false if writing failed.
+bool WriteGeneratedRecording(FILE* pFile, const GeneratorSettings& pSettings, GeneratorStats& pStats);
+
+// Approximate JSON bytes per pose and device, to size a recording.
+double EstimatePoseBytes(const GeneratorSettings& pSettings);
+
+#endif // #ifndef _SYNTHETIC_RECORDING_H
@@ -0,0 +1,157 @@
+#include "SyntheticRecording.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+	#include <fcntl.h>
+	#include <io.h>
+#endif
+
+using namespace std;
+
+static void PrintUsage(const char* pProgram)
+{
+	printf("usage: %s <json output|-> [options]\n", pProgram);
+	printf("  --duration <seconds>      length of the recording (default 60)\n");
+	printf("  --size <bytes>[K|M|G]     make the file about this large instead\n");
+	printf("  --rate <hz>               poses per second (default 90)\n");
+	printf("  --devices <count>         camera, left, right, device3... (default 3)\n");
+	printf("  --jitter <ms>             timestamp jitter, standard deviation (default 0.5)\n");
+	printf("  --drop <fraction>         share of dropped frames (default 0.01)\n");
+	printf("  --noise <cm> <degrees>    tracking noise, standard deviation (default 0.05 0.05)\n");
+	printf("  --seed <n>                the same seed gives the same file (default 1)\n");
+	printf("  --threads <count>         formatting threads (default: hardware threads)\n");
+}
+
+static bool ParseNumber(const char* pText, double& pValue)
+{
+	char* lEnd;
+	pValue = strtod(pText, &lEnd);
+	return lEnd != pText && *lEnd == '\0';
+}
+
+// "500M", "2G", "1048576"
+static bool ParseSize(const char* pText, double& pBytes)
+{
+	char* lEnd;
+	pBytes = strtod(pText, &lEnd);
+	if (lEnd == pText || pBytes <= 0.0)
+		return false;
+
+	switch (*lEnd)
+	{
+	case 'K': case 'k': pBytes *= 1024.0; lEnd++; break;
+	case 'M': case 'm': pBytes *= 1024.0 * 1024.0; lEnd++; break;
+	case 'G': case 'g': pBytes *= 1024.0 * 1024.0 * 1024.0; lEnd++; break;
+	}
+	return *lEnd == '\0';
+}
+
+int main(int argc, char** argv)
+{
+	GeneratorSettings lSettings;
+	const char* lOutput = NULL;
+	double lTargetBytes = 0.0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* lArg = argv[i];
+		bool lValid = true;
+		double lValue = 0.0;
+
+		if (strcmp(lArg, "--duration") == 0)
+			lValid = i + 1 < argc && ParseNumber(argv[++i], lSettings.mDuration) && lSettings.mDuration > 0.0;
+		else if (strcmp(lArg, "--size") == 0)
+			lValid = i + 1 < argc && ParseSize(argv[++i], lTargetBytes);
+		else if (strcmp(lArg, "--rate") == 0)
+			lValid = i + 1 < argc && ParseNumber(argv[++i], lSettings.mSampleRate) && lSettings.mSampleRate > 0.0;
+		else if (strcmp(lArg, "--devices") == 0)
+		{
+			lValid = i + 1 < argc && ParseNumber(argv[++i], lValue) && lValue >= 1.0 && lValue == floor(lValue);
+			lSettings.mDeviceCount = int(lValue);
+		}
+		else if (strcmp(lArg, "--jitter") == 0)
+			lValid = i + 1 < argc && ParseNumber(argv[++i], lSettings.mJitter) && lSettings.mJitter >= 0.0;
+		else if (strcmp(lArg, "--drop") == 0)
+			lValid = i + 1 < argc && ParseNumber(argv[++i], lSettings.mDropRate)
+				&& lSettings.mDropRate >= 0.0 && lSettings.mDropRate < 1.0;
+		else if (strcmp(lArg, "--noise") == 0)
+		{
+			lValid = i + 2 < argc && ParseNumber(argv[i + 1], lSettings.mPositionNoise)
+				&& ParseNumber(argv[i + 2], lSettings.mRotationNoise)
+				&& lSettings.mPositionNoise >= 0.0 && lSettings.mRotationNoise >= 0.0;
+			i += 2;
+		}
+		else if (strcmp(lArg, "--seed") == 0)
+		{
+			lValid = i + 1 < argc;
+			if (lValid)
+				lSettings.mSeed = strtoull(argv[++i], NULL, 10);
+		}
+		else if (strcmp(lArg, "--threads") == 0)
+		{
+			lValid = i + 1 < argc && ParseNumber(argv[++i], lValue) && lValue >= 0.0 && lValue == floor(lValue);
+			lSettings.mThreadCount = unsigned(lValue);
+		}
+		else if (strncmp(lArg, "--", 2) != 0 && !lOutput)
+			lOutput = lArg;
+		else
+		{
+			printf("Error: Unexpected argument '%s'\n", lArg);
+			return 1;
+		}
+
+		if (!lValid)
+		{
+			printf("Error: Invalid value for %s\n", lArg);
+			return 1;
+		}
+	}
+
+	if (!lOutput)
+	{
+		PrintUsage(argv[0]);
+		return 1;
+	}
+
+	if (lTargetBytes > 0.0)
+	{
+		double lFrameBytes = EstimatePoseBytes(lSettings) * lSettings.mDeviceCount * (1.0 - lSettings.mDropRate);
+		lSettings.mDuration = lTargetBytes / lFrameBytes / lSettings.mSampleRate;
+	}
+
+	bool lToStdout = strcmp(lOutput, "-") == 0;
+	FILE* lFile = lToStdout ? stdout : fopen(lOutput, "wb");
+	if (!lFile)
+	{
+		printf("Error: Unable to create '%s'\n", lOutput);
+		return 1;
+	}
+#ifdef _WIN32
+	if (lToStdout)
+		_setmode(_fileno(stdout), _O_BINARY);
+#endif
+
+	chrono::steady_clock::time_point lStart = chrono::steady_clock::now();
+
+	GeneratorStats lStats;
+	bool lOk = WriteGeneratedRecording(lFile, lSettings, lStats);
+	if (!lToStdout)
+		lOk = fclose(lFile) == 0 && lOk;
+	if (!lOk)
+	{
+		fprintf(stderr, "Error: Unable to write '%s'\n", lOutput);
+		return 1;
+	}
+
+	// stdout may be the recording itself
+	double lSeconds = chrono::duration<double>(chrono::steady_clock::now() - lStart).count();
+	fprintf(lToStdout ? stderr : stdout, "%s: %d devices, %llu poses, %.1f s at %g Hz, %.1f MB in %.2f s (%.0f MB/s)\n",
+		lOutput, lSettings.mDeviceCount, (unsigned long long)lStats.mPoses, lSettings.mDuration, lSettings.mSampleRate,
+		double(lStats.mBytes) / (1024.0 * 1024.0), lSeconds, double(lStats.mBytes) / (1024.0 * 1024.0) / lSeconds);
+	return 0;
+}
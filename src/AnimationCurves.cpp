@@ -0,0 +1,109 @@
+#include "../Common/Common.h"
+#include "KeyTime.h"
+#include "PoseBuffer.h"
+#include "Trace.h"
+
+namespace
+{
+	// One animated component: the curve, the pose values feeding it and
+	// the KeyAdd() search hint for appending in time order.
+	struct Channel
+	{
+		FbxAnimCurve* mCurve;
+		const float* mValues;
+		float mScale;
+		int mLast;
+	};
+
+	int AddChannels(FbxPropertyT<FbxDouble3>& pProperty, FbxAnimLayer* pAnimLayer,
+		const std::vector<float>& pX, const std::vector<float>& pY, const std::vector<float>& pZ,
+		float pScale, Channel* pChannels)
+	{
+		const char* lComponents[] = { FBXSDK_CURVENODE_COMPONENT_X, FBXSDK_CURVENODE_COMPONENT_Y, FBXSDK_CURVENODE_COMPONENT_Z };
+		const std::vector<float>* lValues[] = { &pX, &pY, &pZ };
+
+		pProperty.GetCurveNode(pAnimLayer, true);
+
+		int lCount = 0;
+		for (int c = 0; c < 3; c++)
+		{
+			FbxAnimCurve* lCurve = pProperty.GetCurve(pAnimLayer, lComponents[c], true);
+			if (!lCurve)
+				continue;
+
+			Channel& lChannel = pChannels[lCount++];
+			lChannel.mCurve = lCurve;
+			lChannel.mValues = &(*lValues[c])[0];
+			lChannel.mScale = pScale;
+			lChannel.mLast = 0;
+		}
+		return lCount;
+	}
+}
+
+// Build translation (on pPosition) and rotation (on pRotation) curves from
+// one pass over the track: the key times are the precomputed pTrack.mKeyTime
+// (see BuildTimeline) and the six keys of a pose are written together.
+// Either node may be NULL.
+// Every curve is opened for modification once, with its key buffer sized
+// for the whole track, and keys are appended using the KeyAdd() hint.
+void AnimateTrack(FbxNode* pPosition, FbxNode* pRotation, FbxAnimLayer* pAnimLayer, const PoseTrack& pTrack)
+{
+	TRACE_SPAN_DETAIL("AnimateTrack", pTrack.mName);
+
+	size_t lPoseCount = pTrack.Size();
+	if (lPoseCount == 0)
+	{
+		// no poses: the curve nodes exist but carry no curves
+		if (pPosition)
+			pPosition->LclTranslation.GetCurveNode(pAnimLayer, true);
+		if (pRotation)
+			pRotation->LclRotation.GetCurveNode(pAnimLayer, true);
+		return;
+	}
+
+	Channel lChannels[6];
+	int lChannelCount = 0;
+
+	// positions are recorded in meters, FBX uses centimeters
+	if (pPosition)
+		lChannelCount += AddChannels(pPosition->LclTranslation, pAnimLayer,
+			pTrack.mPositionX, pTrack.mPositionY, pTrack.mPositionZ, 100.0f, lChannels + lChannelCount);
+	if (pRotation)
+		lChannelCount += AddChannels(pRotation->LclRotation, pAnimLayer,
+			pTrack.mRotationX, pTrack.mRotationY, pTrack.mRotationZ, 1.0f, lChannels + lChannelCount);
+
+	for (int c = 0; c < lChannelCount; c++)
+	{
+		lChannels[c].mCurve->KeyModifyBegin();
+		lChannels[c].mCurve->ResizeKeyBuffer(lChannels[c].mCurve->KeyGetCount() + int(lPoseCount));
+	}
+
+	FbxTime lTime;
+	const int64_t* lKeyTime = &pTrack.mKeyTime[0];
+	for (size_t i = 0; i < lPoseCount; i++)
+	{
+		lTime.Set(lKeyTime[i]);
+
+		for (int c = 0; c < lChannelCount; c++)
+		{
+			Channel& lChannel = lChannels[c];
+			int lKeyIndex = lChannel.mCurve->KeyAdd(lTime, &lChannel.mLast);
+			lChannel.mCurve->KeySet(lKeyIndex, lTime, lChannel.mValues[i] * lChannel.mScale, FbxAnimCurveDef::eInterpolationLinear);
+		}
+	}
+
+	for (int c = 0; c < lChannelCount; c++)
+		lChannels[c].mCurve->KeyModifyEnd();
+}
+
+// Position animation
+void AnimatePosition(FbxNode* pPosition, FbxAnimLayer* pAnimLayer, const PoseTrack& pTrack)
+{
+	AnimateTrack(pPosition, NULL, pAnimLayer, pTrack);
+}
+
+void AnimateRotation(FbxNode* pRotation, FbxAnimLayer* pAnimLayer, const PoseTrack& pTrack)
+{
+	AnimateTrack(NULL, pRotation, pAnimLayer, pTrack);
+}
@@ -0,0 +1,145 @@
+#include "BatchJobs.h"
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+
+JobResult::JobResult()
+	: mSucceeded(false), mInputBytes(0), mPoseCount(0), mSeconds(0.0)
+{
+}
+
+static std::string Trim(const std::string& pText)
+{
+	const char* lSpace = " \t\r\n";
+	size_t lBegin = pText.find_first_not_of(lSpace);
+	if (lBegin == std::string::npos)
+		return std::string();
+	size_t lEnd = pText.find_last_not_of(lSpace);
+	return pText.substr(lBegin, lEnd - lBegin + 1);
+}
+
+std::string DefaultOutputName(const std::string& pInput)
+{
+	size_t lSlash = pInput.find_last_of("/\\");
+	size_t lDot = pInput.find_last_of('.');
+	if (lDot == std::string::npos || (lSlash != std::string::npos && lDot < lSlash))
+		return pInput + ".fbx";
+	return pInput.substr(0, lDot) + ".fbx";
+}
+
+uint64_t GetFileSize(const std::string& pPath)
+{
+	std::ifstream lFile(pPath.c_str(), std::ios::binary | std::ios::ate);
+	if (!lFile)
+		return 0;
+	std::streamoff lSize = lFile.tellg();
+	return lSize > 0 ? uint64_t(lSize) : 0;
+}
+
+static bool ParseManifestLine(const std::string& pLine, ConversionJob& pJob)
+{
+	size_t lSplit = pLine.find('\t');
+	if (lSplit == std::string::npos)
+	{
+		lSplit = pLine.find_first_of(" ");
+		if (lSplit != std::string::npos && Trim(pLine.substr(lSplit)).find(' ') != std::string::npos)
+			return false;	// more than two space separated fields
+	}
+
+	if (lSplit == std::string::npos)
+	{
+		pJob.mInput = pLine;
+		pJob.mOutput = DefaultOutputName(pLine);
+	}
+	else
+	{
+		pJob.mInput = Trim(pLine.substr(0, lSplit));
+		pJob.mOutput = Trim(pLine.substr(lSplit + 1));
+	}
+	return !pJob.mInput.empty() && !pJob.mOutput.empty();
+}
+
+bool ReadBatchManifest(const std::string& pPath, std::vector<ConversionJob>& pJobs)
+{
+	std::ifstream lFile;
+	if (pPath != "-")
+	{
+		lFile.open(pPath.c_str());
+		if (!lFile)
+		{
+			printf("Error: Unable to read batch manifest '%s'\n", pPath.c_str());
+			return false;
+		}
+	}
+	std::istream& lStream = pPath == "-" ? std::cin : lFile;
+
+	std::string lLine;
+	int lLineNumber = 0;
+	while (std::getline(lStream, lLine))
+	{
+		lLineNumber++;
+		lLine = Trim(lLine);
+		if (lLine.empty() || lLine[0] == '#')
+			continue;
+
+		ConversionJob lJob;
+		if (!ParseManifestLine(lLine, lJob))
+		{
+			printf("Error: Batch manifest line %d: expected '<input> [<output>]'\n", lLineNumber);
+			return false;
+		}
+		pJobs.push_back(lJob);
+	}
+
+	return true;
+}
+
+void PrintJobResult(size_t pIndex, size_t pCount, const ConversionJob& pJob, const JobResult& pResult)
+{
+	if (!pResult.mSucceeded)
+	{
+		printf("[%llu/%llu] %s: failed\n", (unsigned long long)(pIndex + 1), (unsigned long long)pCount, pJob.mInput.c_str());
+		return;
+	}
+
+	double lMegabytes = double(pResult.mInputBytes) / (1024.0 * 1024.0);
+	if (pResult.mStats.mCacheHits)
+	{
+		printf("[%llu/%llu] %s -> %s: %.1f MB, cached output in %.3f s\n",
+			(unsigned long long)(pIndex + 1), (unsigned long long)pCount, pJob.mInput.c_str(), pJob.mOutput.c_str(),
+			lMegabytes, pResult.mSeconds);
+		return;
+	}
+
+	printf("[%llu/%llu] %s -> %s: %.1f MB, %llu poses in %.3f s (%.1f MB/s)\n",
+		(unsigned long long)(pIndex + 1), (unsigned long long)pCount, pJob.mInput.c_str(), pJob.mOutput.c_str(),
+		lMegabytes, (unsigned long long)pResult.mPoseCount, pResult.mSeconds,
+		pResult.mSeconds > 0.0 ? lMegabytes / pResult.mSeconds : 0.0);
+}
+
+void PrintBatchSummary(const std::vector<JobResult>& pResults, unsigned pWorkerCount,
+	double pSetupSeconds, double pTotalSeconds)
+{
+	size_t lFailed = 0;
+	size_t lBytes = 0;
+	size_t lPoses = 0;
+	for (size_t i = 0; i < pResults.size(); i++)
+	{
+		if (!pResults[i].mSucceeded)
+		{
+			lFailed++;
+			continue;
+		}
+		lBytes += pResults[i].mInputBytes;
+		lPoses += pResults[i].mPoseCount;
+	}
+
+	double lMegabytes = double(lBytes) / (1024.0 * 1024.0);
+	printf("Batch: %llu jobs (%llu failed) on %u workers, %.1f MB, %llu poses in %.3f s, setup %.3f s\n",
+		(unsigned long long)pResults.size(), (unsigned long long)lFailed, pWorkerCount, lMegabytes,
+		(unsigned long long)lPoses, pTotalSeconds, pSetupSeconds);
+	if (pTotalSeconds > 0.0)
+		printf("Batch throughput: %.2f jobs/s, %.1f MB/s, %.0f poses/s\n",
+			double(pResults.size()) / pTotalSeconds, lMegabytes / pTotalSeconds, double(lPoses) / pTotalSeconds);
+}
@@ -0,0 +1,49 @@
+#ifndef _BATCH_JOBS_H
+#define _BATCH_JOBS_H
+
+#include "ConversionStats.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// One recording to convert in batch mode.
+struct ConversionJob
+{
+	std::string mInput;
+	std::string mOutput;
+};
+
+// What converting one recording took.
+struct JobResult
+{
+	bool mSucceeded;
+	size_t mInputBytes;
+	size_t mPoseCount;
+	double mSeconds;
+	ConversionStats mStats;
+
+	JobResult();
+};
+
+// Read the jobs of a batch manifest, "-" for stdin. Every line holds
+// "<input> <output>" (separated by a tab if the paths contain spaces) or
+// just "<input>", which is written next to the input with an .fbx extension.
+// Blank lines and lines starting with '#' are skipped.
+bool ReadBatchManifest(const std::string& pPath, std::vector<ConversionJob>& pJobs);
+
+// Output file name used when a manifest line only names the input.
+std::string DefaultOutputName(const std::string& pInput);
+
+// Size of a file in bytes, 0 if it cannot be opened.
+uint64_t GetFileSize(const std::string& pPath);
+
+void PrintJobResult(size_t pIndex, size_t pCount, const ConversionJob& pJob, const JobResult& pResult);
+
+// Aggregate throughput of a batch run by pWorkerCount threads; pSetupSeconds
+// is the one-time SDK setup of all workers together.
+void PrintBatchSummary(const std::vector<JobResult>& pResults, unsigned pWorkerCount,
+	double pSetupSeconds, double pTotalSeconds);
+
+#endif // #ifndef _BATCH_JOBS_H
@@ -0,0 +1,258 @@
+#include "BinaryRecording.h"
+#include "FastNumber.h"
+
+#include <stdint.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace
+{
+	const char kMagic[8] = { 'M', '2', 'F', 'B', '\r', '\n', '\x1a', '\n' };
+	const uint32_t kByteOrderMark = 0x01020304;
+	const uint64_t kArrayAlignment = 64;
+	const size_t kArrayCount = 7;
+
+	struct Header
+	{
+		char mMagic[8];
+		uint32_t mVersion;
+		uint32_t mByteOrder;
+		uint64_t mFileSize;
+		uint64_t mTrackCount;
+		uint64_t mTrackTableOffset;
+		uint8_t mReserved[24];
+	};
+
+	struct TrackEntry
+	{
+		uint64_t mPoseCount;
+		double mFrameRate;
+		uint64_t mNameOffset;
+		uint64_t mNameLength;
+		uint64_t mArrayOffset[kArrayCount];	// timestamp, position x, y, z, rotation x, y, z
+		uint64_t mReserved;
+	};
+
+	static_assert(sizeof(Header) == 64, "the .m2fb header is 64 bytes");
+	static_assert(sizeof(TrackEntry) == 96, "a .m2fb track entry is 96 bytes");
+
+	// Element size of array i of a track.
+	inline uint64_t ArrayElementSize(size_t i)
+	{
+		return i == 0 ? sizeof(int64_t) : sizeof(float);
+	}
+
+	inline uint64_t Align(uint64_t pOffset)
+	{
+		return (pOffset + kArrayAlignment - 1) & ~(kArrayAlignment - 1);
+	}
+
+	void GetArrays(const PoseTrack& pTrack, const void* pArrays[kArrayCount])
+	{
+		pArrays[0] = pTrack.mTimestamp.data();
+		pArrays[1] = pTrack.mPositionX.data();
+		pArrays[2] = pTrack.mPositionY.data();
+		pArrays[3] = pTrack.mPositionZ.data();
+		pArrays[4] = pTrack.mRotationX.data();
+		pArrays[5] = pTrack.mRotationY.data();
+		pArrays[6] = pTrack.mRotationZ.data();
+	}
+
+	// True if [pOffset, pOffset + pCount * pElementSize) lies within pSize bytes.
+	bool InFile(uint64_t pOffset, uint64_t pCount, uint64_t pElementSize, uint64_t pSize)
+	{
+		if (pOffset > pSize)
+			return false;
+		return pCount <= (pSize - pOffset) / pElementSize;
+	}
+
+	template <typename T>
+	void CopyArray(const char* pData, uint64_t pOffset, size_t pCount, std::vector<T>& pArray)
+	{
+		// the file keeps the arrays aligned, but a buffer need not be
+		pArray.resize(pCount);
+		if (pCount)
+			memcpy(&pArray[0], pData + pOffset, pCount * sizeof(T));
+	}
+}
+
+bool IsBinaryRecordingPath(const std::string& pPath)
+{
+	const char* lExtension = ".m2fb";
+	size_t lLength = strlen(lExtension);
+	if (pPath.size() < lLength)
+		return false;
+
+	for (size_t i = 0; i < lLength; i++)
+	{
+		char c = pPath[pPath.size() - lLength + i];
+		if (c >= 'A' && c <= 'Z')
+			c = char(c - 'A' + 'a');
+		if (c != lExtension[i])
+			return false;
+	}
+	return true;
+}
+
+bool IsBinaryRecording(const char* pData, size_t pSize)
+{
+	return pSize >= sizeof(kMagic) && memcmp(pData, kMagic, sizeof(kMagic)) == 0;
+}
+
+bool WriteBinaryRecording(std::ostream& pStream, const PoseRecording& pRecording)
+{
+	const size_t lTrackCount = pRecording.mTracks.size();
+
+	// lay out the file: header, track table, names, then the aligned arrays
+	Header lHeader;
+	memset(&lHeader, 0, sizeof(lHeader));
+	memcpy(lHeader.mMagic, kMagic, sizeof(kMagic));
+	lHeader.mVersion = kBinaryRecordingVersion;
+	lHeader.mByteOrder = kByteOrderMark;
+	lHeader.mTrackCount = lTrackCount;
+	lHeader.mTrackTableOffset = sizeof(Header);
+
+	std::vector<TrackEntry> lEntries(lTrackCount);
+	uint64_t lOffset = sizeof(Header) + lTrackCount * sizeof(TrackEntry);
+	for (size_t t = 0; t < lTrackCount; t++)
+	{
+		const PoseTrack& lTrack = pRecording.mTracks[t];
+		TrackEntry& lEntry = lEntries[t];
+		memset(&lEntry, 0, sizeof(lEntry));
+		lEntry.mPoseCount = lTrack.Size();
+		lEntry.mFrameRate = lTrack.mFrameRate;
+		lEntry.mNameOffset = lOffset;
+		lEntry.mNameLength = lTrack.mName.size();
+		lOffset += lTrack.mName.size();
+	}
+	uint64_t lWritten = lOffset;
+	for (size_t t = 0; t < lTrackCount; t++)
+	{
+		TrackEntry& lEntry = lEntries[t];
+		for (size_t i = 0; i < kArrayCount; i++)
+		{
+			lOffset = Align(lOffset);
+			lEntry.mArrayOffset[i] = lOffset;
+			lOffset += lEntry.mPoseCount * ArrayElementSize(i);
+		}
+	}
+	lHeader.mFileSize = lOffset;
+
+	pStream.write(reinterpret_cast<const char*>(&lHeader), sizeof(lHeader));
+	if (lTrackCount)
+		pStream.write(reinterpret_cast<const char*>(&lEntries[0]), lTrackCount * sizeof(TrackEntry));
+	for (size_t t = 0; t < lTrackCount; t++)
+		pStream.write(pRecording.mTracks[t].mName.data(), pRecording.mTracks[t].mName.size());
+
+	static const char kPadding[kArrayAlignment] = {};
+	for (size_t t = 0; t < lTrackCount; t++)
+	{
+		const void* lArrays[kArrayCount];
+		GetArrays(pRecording.mTracks[t], lArrays);
+		for (size_t i = 0; i < kArrayCount; i++)
+		{
+			const TrackEntry& lEntry = lEntries[t];
+			pStream.write(kPadding, std::streamsize(lEntry.mArrayOffset[i] - lWritten));
+			uint64_t lBytes = lEntry.mPoseCount * ArrayElementSize(i);
+			pStream.write(static_cast<const char*>(lArrays[i]), std::streamsize(lBytes));
+			lWritten = lEntry.mArrayOffset[i] + lBytes;
+		}
+	}
+
+	pStream.flush();
+	return bool(pStream);
+}
+
+bool SaveBinaryRecording(const char* pFilename, const PoseRecording& pRecording)
+{
+	std::ofstream lStream(pFilename, std::ios::binary | std::ios::trunc);
+	if (!lStream)
+	{
+		printf("Error: Unable to create output file '%s'\n", pFilename);
+		return false;
+	}
+
+	if (!WriteBinaryRecording(lStream, pRecording))
+	{
+		printf("Error: Unable to write output file '%s'\n", pFilename);
+		return false;
+	}
+
+	return true;
+}
+
+bool ReadBinaryRecording(const char* pData, size_t pSize, PoseRecording& pRecording)
+{
+	Header lHeader;
+	if (pSize < sizeof(lHeader) || !IsBinaryRecording(pData, pSize))
+	{
+		printf("Error: Not a .m2fb recording\n");
+		return false;
+	}
+	memcpy(&lHeader, pData, sizeof(lHeader));
+
+	if (lHeader.mByteOrder != kByteOrderMark)
+	{
+		printf("Error: The .m2fb recording was written on a machine with another byte order\n");
+		return false;
+	}
+	if (lHeader.mVersion != kBinaryRecordingVersion && lHeader.mVersion != kMillisecondRecordingVersion)
+	{
+		printf("Error: The .m2fb recording has version %u, this converter reads versions %u and %u\n",
+			unsigned(lHeader.mVersion), kMillisecondRecordingVersion, kBinaryRecordingVersion);
+		return false;
+	}
+	if (lHeader.mFileSize != pSize
+		|| !InFile(lHeader.mTrackTableOffset, lHeader.mTrackCount, sizeof(TrackEntry), pSize))
+	{
+		printf("Error: The .m2fb recording is truncated or damaged\n");
+		return false;
+	}
+
+	pRecording.mTracks.clear();
+	pRecording.mTracks.resize(size_t(lHeader.mTrackCount));
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+	{
+		TrackEntry lEntry;
+		memcpy(&lEntry, pData + lHeader.mTrackTableOffset + t * sizeof(TrackEntry), sizeof(lEntry));
+
+		bool lValid = InFile(lEntry.mNameOffset, lEntry.mNameLength, 1, pSize);
+		for (size_t i = 0; lValid && i < kArrayCount; i++)
+			lValid = InFile(lEntry.mArrayOffset[i], lEntry.mPoseCount, ArrayElementSize(i), pSize);
+		if (!lValid)
+		{
+			printf("Error: The .m2fb recording is truncated or damaged\n");
+			pRecording.mTracks.clear();
+			return false;
+		}
+
+		PoseTrack& lTrack = pRecording.mTracks[t];
+		size_t lCount = size_t(lEntry.mPoseCount);
+		lTrack.mName.assign(pData + lEntry.mNameOffset, size_t(lEntry.mNameLength));
+		lTrack.mFrameRate = lEntry.mFrameRate;
+		CopyArray(pData, lEntry.mArrayOffset[0], lCount, lTrack.mTimestamp);
+		CopyArray(pData, lEntry.mArrayOffset[1], lCount, lTrack.mPositionX);
+		CopyArray(pData, lEntry.mArrayOffset[2], lCount, lTrack.mPositionY);
+		CopyArray(pData, lEntry.mArrayOffset[3], lCount, lTrack.mPositionZ);
+		CopyArray(pData, lEntry.mArrayOffset[4], lCount, lTrack.mRotationX);
+		CopyArray(pData, lEntry.mArrayOffset[5], lCount, lTrack.mRotationY);
+		CopyArray(pData, lEntry.mArrayOffset[6], lCount, lTrack.mRotationZ);
+
+		if (lHeader.mVersion == kMillisecondRecordingVersion)
+		{
+			for (size_t i = 0; i < lCount; i++)
+			{
+				if (!MillisecondsToMicroseconds(lTrack.mTimestamp[i], lTrack.mTimestamp[i]))
+				{
+					printf("Error: The .m2fb recording is truncated or damaged\n");
+					pRecording.mTracks.clear();
+					return false;
+				}
+			}
+		}
+	}
+
+	return true;
+}
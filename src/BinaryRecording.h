@@ -0,0 +1,44 @@
+#ifndef _BINARY_RECORDING_H
+#define _BINARY_RECORDING_H
+
+#include "PoseBuffer.h"
+
+#include <stddef.h>
+#include <ostream>
+#include <string>
+
+// .m2fb: the pose buffers of a recording as they are in memory, so a
+// recording that is converted again (other rate, reduction or format) is
+// loaded with a few copies instead of a JSON parse. Version 2 layout, in
+// the byte order of the machine that wrote it (checked when reading):
+//
+//	header			64 bytes: magic "M2FB\r\n\x1a\n", version, byte order mark,
+//					file size, track count, offset of the track table
+//	track table		96 bytes per track: pose count, frame rate, offset and
+//					length of the name, offsets of the seven arrays
+//	track names		UTF-8, not terminated
+//	arrays			per track: int64 timestamps in microseconds, float32 position x, y, z and
+//					rotation x, y, z, each starting at a 64 byte aligned offset
+//
+// Resampled tracks keep their frame rate. Version 1 is the same layout with
+// millisecond timestamps; it is still read.
+const unsigned kBinaryRecordingVersion = 2;
+const unsigned kMillisecondRecordingVersion = 1;
+
+// True if pPath has the .m2fb extension (any case).
+bool IsBinaryRecordingPath(const std::string& pPath);
+
+// True if pData starts with the .m2fb magic.
+bool IsBinaryRecording(const char* pData, size_t pSize);
+
+// Write pRecording as .m2fb. The layout is computed up front, so pStream
+// does not need to be seekable.
+bool WriteBinaryRecording(std::ostream& pStream, const PoseRecording& pRecording);
+bool SaveBinaryRecording(const char* pFilename, const PoseRecording& pRecording);
+
+// Load a .m2fb file (typically a mapped InputFile) into pRecording. Every
+// offset is checked against pSize; return false if the file is damaged or
+// of another version or byte order.
+bool ReadBinaryRecording(const char* pData, size_t pSize, PoseRecording& pRecording);
+
+#endif // #ifndef _BINARY_RECORDING_H
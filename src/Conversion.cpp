@@ -0,0 +1,542 @@
+#include "Conversion.h"
+#ifndef MOTION2FBX_NO_FBXSDK
+	#include "../Common/Common.h"
+	#include "KeyReduction.h"
+	#include "SceneBuilder.h"
+#endif
+#include "BinaryRecording.h"
+#include "FbxBinaryWriter.h"
+#include "InputFile.h"
+#include "InputStream.h"
+#include "KeyTime.h"
+#include "MarkerTopology.h"
+#include "MemoryOutput.h"
+#include "NativeExport.h"
+#include "OutputCache.h"
+#include "ParallelIngest.h"
+#include "Resample.h"
+#include "Trace.h"
+
+#include <chrono>
+#include <cstdio>
+#include <istream>
+#include <ostream>
+
+typedef std::chrono::steady_clock Clock;
+
+static double SecondsSince(Clock::time_point pStart)
+{
+	return std::chrono::duration<double>(Clock::now() - pStart).count();
+}
+
+static bool ConvertInputFile(const std::string& pInput, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, JobResult& pResult);
+static bool ConvertInputBuffer(const char* pData, size_t pSize, const ConversionOutput& pOutput,
+	const ConversionOptions& pOptions, SdkContext& pSdk, JobResult& pResult);
+static bool ConvertNative(const PoseRecording& pRecording, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	ConversionStats& pStats);
+static void PrintReductionStats(const KeyReductionStats& pStats);
+static bool CollapseDevices(PoseRecording& pRecording, const ConversionOptions& pOptions, ConversionStats& pStats);
+static bool ReadStreamedRecording(InputStreamBuffer& pInput, PoseRecording& pRecording);
+static bool ReadRecording(const char* pData, size_t pSize, const ConversionOptions& pOptions, PoseRecording& pRecording);
+static bool ConvertToBinaryRecording(const PoseRecording& pRecording, const ConversionOutput& pOutput, ConversionStats& pStats);
+static bool FetchFromCache(const char* pData, size_t pSize, const ConversionOutput& pOutput,
+	const ConversionOptions& pOptions, JobResult& pResult, std::string& pKey);
+static void StoreInCache(const std::string& pKey, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	ConversionStats& pStats);
+
+#ifndef MOTION2FBX_NO_FBXSDK
+static bool ConvertWithSdk(const PoseRecording& pRecording, const PoseRecording* pPairs, const ConversionOutput& pOutput,
+	const ConversionOptions& pOptions, SdkContext& pSdk, ConversionStats& pStats);
+static bool CheckEvaluatedTopology(FbxManager* pSdkManager, FbxScene* pScene, const PoseRecording& pPairs,
+	ConversionStats& pStats);
+static void ReduceSceneKeys(FbxScene* pScene, const ConversionOptions& pOptions);
+static void CountSceneKeys(FbxScene* pScene, ConversionStats& pStats);
+static void SetSceneFrameRate(FbxScene* pScene, double pFrameRate);
+#endif
+
+SdkContext::SdkContext()
+	: mSetupSeconds(0.0)
+{
+#ifndef MOTION2FBX_NO_FBXSDK
+	mManager = NULL;
+#endif
+}
+
+SdkContext::~SdkContext()
+{
+	Release(false);
+}
+
+void SdkContext::Release(bool pReport)
+{
+#ifndef MOTION2FBX_NO_FBXSDK
+	if (mManager)
+		DestroySdkObjects(mManager, pReport);
+	mManager = NULL;
+#else
+	(void)pReport;
+#endif
+}
+
+ConversionOutput::ConversionOutput(const std::string& pPath)
+	: mPath(pPath), mBuffer(NULL)
+{
+}
+
+ConversionOutput::ConversionOutput(std::vector<char>& pBuffer, const std::string& pName)
+	: mPath(pName), mBuffer(&pBuffer)
+{
+}
+
+bool ConvertToMemory(const char* pData, size_t pSize, const ConversionOptions& pOptions, std::vector<char>& pFbx)
+{
+	ConversionOptions lOptions = pOptions;
+#ifdef MOTION2FBX_NO_FBXSDK
+	lOptions.mNativeWriter = true;
+#endif
+
+	SdkContext lSdk;
+	JobResult lResult;
+	return ConvertBuffer(pData, pSize, ConversionOutput(pFbx, "memory"), lOptions, lSdk, lResult);
+}
+
+bool ConvertFile(const std::string& pInput, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, JobResult& pResult)
+{
+	TRACE_SPAN_DETAIL("ConvertFile", pInput);
+	Clock::time_point lStart = Clock::now();
+	pResult.mSucceeded = ConvertInputFile(pInput, pOutput, pOptions, pSdk, pResult);
+	pResult.mSeconds = SecondsSince(lStart);
+	return pResult.mSucceeded;
+}
+
+bool ConvertBuffer(const char* pData, size_t pSize, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, JobResult& pResult)
+{
+	TRACE_SPAN_DETAIL("ConvertBuffer", pOutput.mPath);
+	Clock::time_point lStart = Clock::now();
+	pResult.mSucceeded = ConvertInputBuffer(pData, pSize, pOutput, pOptions, pSdk, pResult);
+	pResult.mSeconds = SecondsSince(lStart);
+	return pResult.mSucceeded;
+}
+
+// ConvertFile() without the timing.
+static bool ConvertInputFile(const std::string& pInput, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, JobResult& pResult)
+{
+	// with --cache, an input converted before with the same options is only
+	// hashed; on a miss the mapped file is parsed without opening it again
+	InputFile lInput;
+	bool lMapped = false;
+	std::string lCacheKey;
+	if (pOptions.UseCache() && pInput != "-")
+	{
+		{
+			StageTimer lTimer(pResult.mStats, eStageRead);
+			if (!lInput.Open(pInput.c_str()))
+				return false;
+		}
+		if (FetchFromCache(lInput.GetData(), lInput.GetSize(), pOutput, pOptions, pResult, lCacheKey))
+			return true;
+		lMapped = true;
+	}
+
+	// stdin and compressed files are parsed as they are read (and decompressed),
+	// without ever holding the whole JSON text
+	InputStreamBuffer lStream;
+	{
+		StageTimer lTimer(pResult.mStats, eStageRead);
+		bool lOpened = lMapped ? lStream.Open(lInput.GetData(), lInput.GetSize()) : lStream.Open(pInput.c_str());
+		if (!lOpened)
+			return false;
+	}
+
+	PoseRecording lRecording;
+	if (pInput == "-" || lStream.GetCompression() != eCompressionNone)
+	{
+		// reading and decompressing happen inside the parse
+		StageTimer lTimer(pResult.mStats, eStageParse);
+		if (!ReadStreamedRecording(lStream, lRecording))
+			return false;
+		pResult.mInputBytes = lStream.GetDecodedBytes();
+	}
+	else
+	{
+		// map the file and parse it straight into the pose buffers, one chunk
+		// of poses per core (or copy the arrays of a .m2fb file)
+		lStream.Close();
+		if (!lMapped)
+		{
+			StageTimer lTimer(pResult.mStats, eStageRead);
+			if (!lInput.Open(pInput.c_str()))
+				return false;
+		}
+		{
+			StageTimer lTimer(pResult.mStats, eStageParse);
+			if (!ReadRecording(lInput.GetData(), lInput.GetSize(), pOptions, lRecording))
+				return false;
+		}
+		pResult.mInputBytes = lInput.GetSize();
+	}
+	pResult.mPoseCount = lRecording.PoseCount();
+	lStream.Close();
+
+	if (!ConvertRecording(lRecording, pOutput, pOptions, pSdk, pResult.mStats))
+		return false;
+	if (!lCacheKey.empty())
+		StoreInCache(lCacheKey, pOutput, pOptions, pResult.mStats);
+	return true;
+}
+
+// ConvertBuffer() without the timing.
+static bool ConvertInputBuffer(const char* pData, size_t pSize, const ConversionOutput& pOutput,
+	const ConversionOptions& pOptions, SdkContext& pSdk, JobResult& pResult)
+{
+	std::string lCacheKey;
+	if (pOptions.UseCache() && FetchFromCache(pData, pSize, pOutput, pOptions, pResult, lCacheKey))
+		return true;
+
+	PoseRecording lRecording;
+	if (DetectCompression(pData, pSize) != eCompressionNone)
+	{
+		StageTimer lTimer(pResult.mStats, eStageParse);
+		InputStreamBuffer lStream;
+		if (!lStream.Open(pData, pSize) || !ReadStreamedRecording(lStream, lRecording))
+			return false;
+		pResult.mInputBytes = lStream.GetDecodedBytes();
+	}
+	else
+	{
+		StageTimer lTimer(pResult.mStats, eStageParse);
+		if (!ReadRecording(pData, pSize, pOptions, lRecording))
+			return false;
+		pResult.mInputBytes = pSize;
+	}
+	pResult.mPoseCount = lRecording.PoseCount();
+
+	if (!ConvertRecording(lRecording, pOutput, pOptions, pSdk, pResult.mStats))
+		return false;
+	if (!lCacheKey.empty())
+		StoreInCache(lCacheKey, pOutput, pOptions, pResult.mStats);
+	return true;
+}
+
+bool ConvertRecording(PoseRecording& pRecording, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, ConversionStats& pStats)
+{
+	// everything after this point expects increasing times
+	{
+		StageTimer lTimer(pStats, eStageTimeline);
+		SortPosesByTime(pRecording);
+	}
+
+	if (pOptions.Resample())
+	{
+		StageTimer lTimer(pStats, eStageResample);
+		if (!ResampleRecording(pRecording, pOptions.mFrameRate))
+			return false;
+	}
+
+#ifndef MOTION2FBX_NO_FBXSDK
+	// with the SDK, --verify-topology also evaluates the marker pairs, which
+	// need the rotations from before CollapseDevices
+	bool lComparePairs = pOptions.mVerifyTopology && !pOptions.mNativeWriter && !IsBinaryRecordingPath(pOutput.mPath);
+	PoseRecording lPairs;
+	if (lComparePairs)
+		lPairs = pRecording;
+#endif
+
+	// a .m2fb output keeps the pose buffers for later conversions
+	bool lResult;
+	if (IsBinaryRecordingPath(pOutput.mPath))
+		lResult = ConvertToBinaryRecording(pRecording, pOutput, pStats);
+	else if (pOptions.mTopology == eTopologySingleNode && !CollapseDevices(pRecording, pOptions, pStats))
+		lResult = false;
+	else
+	{
+		// one time origin and key time column for the curves of every device
+		{
+			StageTimer lTimer(pStats, eStageTimeline);
+			BuildTimeline(pRecording);
+#ifndef MOTION2FBX_NO_FBXSDK
+			if (lComparePairs)
+				BuildTimeline(lPairs);
+#endif
+		}
+
+#ifdef MOTION2FBX_NO_FBXSDK
+		lResult = ConvertNative(pRecording, pOutput, pOptions, pStats);
+		(void)pSdk;
+#else
+		if (pOptions.mNativeWriter)
+			lResult = ConvertNative(pRecording, pOutput, pOptions, pStats);
+		else
+			lResult = ConvertWithSdk(pRecording, lComparePairs ? &lPairs : NULL, pOutput, pOptions, pSdk, pStats);
+#endif
+	}
+
+	if (lResult)
+		pStats.mBytesWritten = pOutput.mBuffer ? pOutput.mBuffer->size() : GetFileSize(pOutput.mPath);
+	return lResult;
+}
+
+static bool ReadStreamedRecording(InputStreamBuffer& pInput, PoseRecording& pRecording)
+{
+	// the SAX parse pulls the text through the fixed size buffers of pInput;
+	// a read or decompression error has been reported and shows up as an
+	// early end of the JSON
+	std::istream lStream(&pInput);
+	bool lParsed = ReadPoseRecording(lStream, pRecording);
+	return lParsed && !pInput.Failed();
+}
+
+static bool ReadRecording(const char* pData, size_t pSize, const ConversionOptions& pOptions, PoseRecording& pRecording)
+{
+	if (IsBinaryRecording(pData, pSize))
+		return ReadBinaryRecording(pData, pSize, pRecording);
+	return ReadPoseRecordingParallel(pData, pSize, pRecording, pOptions.mIngestThreads);
+}
+
+// Store the pose buffers as .m2fb instead of writing an FBX file.
+static bool ConvertToBinaryRecording(const PoseRecording& pRecording, const ConversionOutput& pOutput, ConversionStats& pStats)
+{
+	StageTimer lTimer(pStats, eStageSave);
+	if (pOutput.mBuffer)
+	{
+		MemoryStreamBuffer lBuffer(*pOutput.mBuffer);
+		std::ostream lStream(&lBuffer);
+		return WriteBinaryRecording(lStream, pRecording);
+	}
+	return SaveBinaryRecording(pOutput.mPath.c_str(), pRecording);
+}
+
+// Look pData up in the output cache. On a hit the cached output has been
+// written to pOutput; on a miss pKey is what to store the new output under.
+static bool FetchFromCache(const char* pData, size_t pSize, const ConversionOutput& pOutput,
+	const ConversionOptions& pOptions, JobResult& pResult, std::string& pKey)
+{
+	StageTimer lTimer(pResult.mStats, eStageCache);
+	pKey = GetCacheKey(pData, pSize, pOptions, pOutput.mPath);
+
+	uint64_t lBytes;
+	if (!FetchCachedOutput(pOptions, pKey, pOutput.mPath, pOutput.mBuffer, lBytes))
+		return false;
+
+	pResult.mInputBytes = pSize;
+	pResult.mStats.mBytesWritten = lBytes;
+	pResult.mStats.mCacheHits++;
+	return true;
+}
+
+static void StoreInCache(const std::string& pKey, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	ConversionStats& pStats)
+{
+	StageTimer lTimer(pStats, eStageCache);
+	StoreCachedOutput(pOptions, pKey, pOutput.mPath, pOutput.mBuffer);
+}
+
+// Write the scene with the built-in binary FBX writer.
+static bool ConvertNative(const PoseRecording& pRecording, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	ConversionStats& pStats)
+{
+	if (pOptions.mFileFormat != 0)
+	{
+		printf("Error: The native writer only writes binary FBX (format 0)\n");
+		return false;
+	}
+	if (pOptions.mCompressArrays && !FbxBinaryWriter::SupportsCompression())
+		printf("Warning: Built without zlib, arrays are written uncompressed\n");
+
+	KeyReductionStats lReduction;
+	{
+		StageTimer lTimer(pStats, eStageSave);
+		bool lWritten;
+		if (pOutput.mBuffer)
+		{
+			MemoryStreamBuffer lBuffer(*pOutput.mBuffer);
+			std::ostream lStream(&lBuffer);
+			lWritten = WriteNativeScene(lStream, pRecording, pOptions, lReduction, pStats);
+		}
+		else
+		{
+			lWritten = SaveNativeScene(pOutput.mPath.c_str(), pRecording, pOptions, lReduction, pStats);
+		}
+		if (!lWritten)
+			return false;
+	}
+
+	if (pOptions.ReduceKeys())
+		PrintReductionStats(lReduction);
+	return true;
+}
+
+// Bake the fixed marker rotations into the rotations of the recording for
+// one node per device, and check the result if asked to.
+static bool CollapseDevices(PoseRecording& pRecording, const ConversionOptions& pOptions, ConversionStats& pStats)
+{
+	StageTimer lTimer(pStats, eStageTopology);
+	TopologyCheck lCheck;
+	CollapseMarkerRotations(pRecording, pOptions.mVerifyTopology ? &lCheck : NULL);
+	if (!pOptions.mVerifyTopology)
+		return true;
+
+	printf("Topology check: %d devices with baked marker rotations, %llu poses, world rotations within %.6f deg\n",
+		lCheck.mDevices, (unsigned long long)lCheck.mPoses, lCheck.mMaxRotationError);
+	if (lCheck.mMaxRotationError > kTopologyTolerance)
+	{
+		printf("Error: The single node rotations differ from the marker pairs by more than %g deg\n", kTopologyTolerance);
+		return false;
+	}
+	return true;
+}
+
+static void PrintReductionStats(const KeyReductionStats& pStats)
+{
+	printf("Key reduction: %d curves, %llu -> %llu keys (%.1fx), max error %.4f cm / %.4f deg\n",
+		pStats.mCurves, (unsigned long long)pStats.mKeysBefore, (unsigned long long)pStats.mKeysAfter,
+		pStats.Ratio(), pStats.mMaxTranslationError, pStats.mMaxRotationError);
+}
+
+#ifndef MOTION2FBX_NO_FBXSDK
+
+void InitializeSdk(SdkContext& pSdk)
+{
+	if (pSdk.mManager)
+		return;
+
+	Clock::time_point lStart = Clock::now();
+	InitializeSdkManager(pSdk.mManager);
+	pSdk.mSetupSeconds += SecondsSince(lStart);
+}
+
+// Build the scene with the FBX SDK and save it with FbxExporter. Only the
+// scene is created and destroyed here, the manager is kept for the next job.
+// If pPairs is not NULL (--verify-topology), the single node scene is
+// checked against the marker pairs of it before saving.
+static bool ConvertWithSdk(const PoseRecording& pRecording, const PoseRecording* pPairs, const ConversionOutput& pOutput,
+	const ConversionOptions& pOptions, SdkContext& pSdk, ConversionStats& pStats)
+{
+	{
+		StageTimer lTimer(pStats, eStageSdkSetup);
+		InitializeSdk(pSdk);
+	}
+	FbxManager* lSdkManager = pSdk.mManager;
+
+	FbxScene* lScene;
+	{
+		StageTimer lTimer(pStats, eStageScene);
+
+		lScene = FbxScene::Create(lSdkManager, "My Scene");
+		if (!lScene)
+		{
+			FBXSDK_printf("Error: Unable to create FBX scene!\n");
+			return false;
+		}
+
+		if (pOptions.Resample())
+			SetSceneFrameRate(lScene, pOptions.mFrameRate);
+
+		// Create the scene.
+		if( !CreateScene(lSdkManager, lScene, pRecording, pStats, pOptions.mAnimationOnly, pOptions.mTopology) )
+		{
+			FBXSDK_printf("\n\nAn error occurred while creating the scene...\n");
+			lScene->Destroy();
+			return false;
+		}
+	}
+
+	if (pPairs && !CheckEvaluatedTopology(lSdkManager, lScene, *pPairs, pStats))
+	{
+		lScene->Destroy();
+		return false;
+	}
+
+	if (pOptions.ReduceKeys())
+	{
+		StageTimer lTimer(pStats, eStageReduce);
+		ReduceSceneKeys(lScene, pOptions);
+	}
+
+	CountSceneKeys(lScene, pStats);
+
+	bool lResult;
+	{
+		StageTimer lTimer(pStats, eStageSave);
+		if (pOutput.mBuffer)
+		{
+			FbxMemoryStream lStream(*pOutput.mBuffer, GetExportFormat(lSdkManager, pOptions.mFileFormat));
+			lResult = SaveScene(lSdkManager, lScene, &lStream, pOptions.mFileFormat, false, !pOptions.mAnimationOnly);
+		}
+		else
+		{
+			lResult = SaveScene(lSdkManager, lScene, pOutput.mPath.c_str(), pOptions.mFileFormat, false, !pOptions.mAnimationOnly);
+		}
+	}
+
+	// destroys every object created in the scene as well
+	lScene->Destroy();
+    return lResult;
+}
+
+// Compare the evaluated world transforms of the single nodes of pScene with
+// those of the marker pairs of pPairs (--verify-topology with the FBX SDK).
+static bool CheckEvaluatedTopology(FbxManager* pSdkManager, FbxScene* pScene, const PoseRecording& pPairs,
+	ConversionStats& pStats)
+{
+	StageTimer lTimer(pStats, eStageTopology);
+	TopologyCheck lCheck;
+	if (!CompareTopologies(pSdkManager, pScene, pPairs, lCheck))
+		return false;
+
+	printf("Topology check (FBX SDK): %d devices, %llu keys, evaluated world rotations within %.6f deg\n",
+		lCheck.mDevices, (unsigned long long)lCheck.mPoses, lCheck.mMaxRotationError);
+	if (lCheck.mMaxRotationError > kTopologyTolerance)
+	{
+		printf("Error: The evaluated single node rotations differ from the marker pairs by more than %g deg\n",
+			kTopologyTolerance);
+		return false;
+	}
+	return true;
+}
+
+// Add the curves of the scene and their keys to the counters.
+static void CountSceneKeys(FbxScene* pScene, ConversionStats& pStats)
+{
+	int lCurveCount = pScene->GetSrcObjectCount<FbxAnimCurve>();
+	for (int i = 0; i < lCurveCount; i++)
+		pStats.mKeysWritten += pScene->GetSrcObject<FbxAnimCurve>(i)->KeyGetCount();
+	pStats.mCurvesCreated += lCurveCount;
+}
+
+// Make the scene frame rate match the resampled keys so they land on whole frames.
+static void SetSceneFrameRate(FbxScene* pScene, double pFrameRate)
+{
+	FbxGlobalSettings& lSettings = pScene->GetGlobalSettings();
+	FbxTime::EMode lTimeMode = FbxTime::ConvertFrameRateToTimeMode(pFrameRate);
+	if (lTimeMode == FbxTime::eDefaultMode)
+	{
+		lSettings.SetTimeMode(FbxTime::eCustom);
+		lSettings.SetCustomFrameRate(pFrameRate);
+	}
+	else
+	{
+		lSettings.SetTimeMode(lTimeMode);
+	}
+}
+
+// Drop the keys that linear interpolation reproduces within the tolerances.
+static void ReduceSceneKeys(FbxScene* pScene, const ConversionOptions& pOptions)
+{
+	FbxAnimStack* lAnimStack = pScene->GetSrcObject<FbxAnimStack>(0);
+	FbxAnimLayer* lAnimLayer = lAnimStack ? lAnimStack->GetMember<FbxAnimLayer>(0) : NULL;
+	if (!lAnimLayer)
+		return;
+
+	KeyReductionStats lStats;
+	ReduceKeys(pScene->GetRootNode(), lAnimLayer, pOptions.mTranslationTolerance, pOptions.mRotationTolerance, lStats);
+
+	PrintReductionStats(lStats);
+}
+
+#endif // #ifndef MOTION2FBX_NO_FBXSDK
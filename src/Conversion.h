@@ -0,0 +1,72 @@
+#ifndef _CONVERSION_H
+#define _CONVERSION_H
+
+#include "BatchJobs.h"
+#include "ConversionOptions.h"
+#include "ConversionStats.h"
+#include "PoseBuffer.h"
+
+#include <stddef.h>
+#include <string>
+#include <vector>
+
+#ifndef MOTION2FBX_NO_FBXSDK
+	#include <fbxsdk.h>
+#endif
+
+// FBX SDK objects of one converting thread: SDK objects are never shared
+// between threads, so every batch or server worker owns one of these. The manager is
+// created by the first conversion that goes through the SDK and reused by
+// all later ones.
+struct SdkContext
+{
+#ifndef MOTION2FBX_NO_FBXSDK
+	FbxManager* mManager;
+#endif
+	double mSetupSeconds;
+
+	SdkContext();
+	~SdkContext();
+
+	// Destroy the manager, printing the SDK sample's success message if pReport.
+	void Release(bool pReport);
+};
+
+// Where a conversion writes the FBX file: the file mPath, or mBuffer if it
+// is set (mPath then only names the output in messages).
+struct ConversionOutput
+{
+	std::string mPath;
+	std::vector<char>* mBuffer;
+
+	explicit ConversionOutput(const std::string& pPath);
+	ConversionOutput(std::vector<char>& pBuffer, const std::string& pName);
+};
+
+// Convert one recording file with the writer selected in pOptions.
+bool ConvertFile(const std::string& pInput, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, JobResult& pResult);
+
+// Convert a JSON recording that is already in memory.
+bool ConvertBuffer(const char* pData, size_t pSize, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, JobResult& pResult);
+
+// Resample if requested and write the parsed recording.
+bool ConvertRecording(PoseRecording& pRecording, const ConversionOutput& pOutput, const ConversionOptions& pOptions,
+	SdkContext& pSdk, ConversionStats& pStats);
+
+// Library entry point: convert the JSON recording pData into the bytes of an
+// FBX file, without touching the file system (except for the --cache
+// directory, if one is set). Only the conversion options of pOptions are
+// used (format, --native, --compress, --reduce, --resample, --animation-only,
+// --topology, --verify-topology, --cache, --cache-size). Sets up the FBX SDK
+// per call; keep an SdkContext and call ConvertBuffer with a
+// ConversionOutput on a buffer to convert many recordings.
+bool ConvertToMemory(const char* pData, size_t pSize, const ConversionOptions& pOptions, std::vector<char>& pFbx);
+
+#ifndef MOTION2FBX_NO_FBXSDK
+// Create the FbxManager (IO settings, plugins) of pSdk if needed.
+void InitializeSdk(SdkContext& pSdk);
+#endif
+
+#endif // #ifndef _CONVERSION_H
@@ -0,0 +1,290 @@
+#include "ConversionOptions.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+ConversionOptions::ConversionOptions()
+	: mFileFormat(0), mTranslationTolerance(0.0), mRotationTolerance(0.0), mFrameRate(0.0),
+	mNativeWriter(false), mCompressArrays(false), mAnimationOnly(false),
+	mTopology(eTopologyMarkerPairs), mVerifyTopology(false), mCacheMaxBytes(uint64_t(1024) << 20), mWorkerCount(0), mIngestThreads(0)
+{
+}
+
+void PrintUsage(const char* pProgram)
+{
+	printf("usage: %s <json input> <fbx output> [<format>] [options]\n", pProgram);
+	printf("       %s <json input> -o <fbx output> [<format>] [options]\n", pProgram);
+	printf("       %s --batch <manifest> [options]\n", pProgram);
+	printf("       %s --serve <socket> [options]\n", pProgram);
+	printf("  <json input>              JSON file (plain, gzip or zstd), .m2fb file or '-'\n");
+	printf("                            for JSON on stdin\n");
+	printf("  <fbx output>              FBX file, or a .m2fb file that keeps the poses\n");
+	printf("                            for quick later conversions\n");
+	printf("  <format>                  0 for binary (default), -1 for ASCII\n");
+	printf("  -o <fbx output>           same as the <fbx output> argument; '-' writes the\n");
+	printf("                            file to stdout and the messages to stderr\n");
+	printf("  --reduce <cm> <degrees>   drop keys that linear interpolation reproduces\n");
+	printf("                            within the given translation/rotation error\n");
+	printf("  --resample <fps>          interpolate the poses onto a uniform frame grid\n");
+	printf("  --native                  write binary FBX without the FBX SDK\n");
+	printf("  --compress                zlib compress the arrays (with --native)\n");
+	printf("  --animation-only          write the animated markers without the meshes,\n");
+	printf("                            materials and camera\n");
+	printf("  --topology <pairs|single> a position and a rotation marker per device\n");
+	printf("                            (default), or one node with both curves\n");
+	printf("  --verify-topology         check that the single nodes have the world\n");
+	printf("                            rotations of the marker pairs at every key\n");
+	printf("                            (with --topology single; times between keys\n");
+	printf("                            are not checked)\n");
+	printf("  --batch <manifest>        convert every '<input> [<output>]' line of the\n");
+	printf("                            manifest ('-' for stdin) with one SDK setup\n");
+	printf("  --serve <socket>          convert the requests sent to a Unix domain socket,\n");
+	printf("                            with the given options as defaults\n");
+	printf("  --connect <socket>        let the server on the socket do this conversion\n");
+	printf("  --jobs <count>            batch or server worker threads (default: hardware\n");
+	printf("                            threads)\n");
+	printf("  --stats <file>            write stage times and counters as JSON\n");
+	printf("  --trace <file>            write a Chrome trace of the conversion stages\n");
+	printf("  --cache <directory>       reuse the earlier output of the same input and\n");
+	printf("                            options, and keep this one there\n");
+	printf("  --cache-size <megabytes>  evict the least recently used outputs above this\n");
+	printf("                            size (default 1024)\n");
+	printf("  --format <format>         same as the <format> argument\n");
+}
+
+// Largest --cache-size, 2^40 MB (an exabyte): far above any disk, and its
+// byte count fits uint64_t.
+static const double kMaxCacheMegabytes = 1024.0 * 1024.0 * 1024.0 * 1024.0;
+
+static bool ParseNumber(const char* pText, double& pValue)
+{
+	char* lEnd;
+	pValue = strtod(pText, &lEnd);
+	return lEnd != pText && *lEnd == '\0';
+}
+
+bool ParseConversionOptions(int argc, char** argv, ConversionOptions& pOptions)
+{
+	int lPositional = 0;
+	bool lOutputOption = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		const char* lArg = argv[i];
+
+		if (strcmp(lArg, "--reduce") == 0)
+		{
+			if (i + 2 >= argc
+				|| !ParseNumber(argv[i + 1], pOptions.mTranslationTolerance)
+				|| !ParseNumber(argv[i + 2], pOptions.mRotationTolerance)
+				|| pOptions.mTranslationTolerance < 0.0 || pOptions.mRotationTolerance < 0.0)
+			{
+				printf("Error: --reduce expects two non-negative tolerances (cm, degrees)\n");
+				return false;
+			}
+			i += 2;
+		}
+		else if (strcmp(lArg, "--resample") == 0)
+		{
+			if (i + 1 >= argc || !ParseNumber(argv[i + 1], pOptions.mFrameRate)
+				|| !(pOptions.mFrameRate > 0.0) || !std::isfinite(pOptions.mFrameRate))
+			{
+				printf("Error: --resample expects a positive frame rate\n");
+				return false;
+			}
+			i += 1;
+		}
+		else if (strcmp(lArg, "--native") == 0)
+		{
+			pOptions.mNativeWriter = true;
+		}
+		else if (strcmp(lArg, "--compress") == 0)
+		{
+			pOptions.mCompressArrays = true;
+		}
+		else if (strcmp(lArg, "--animation-only") == 0)
+		{
+			pOptions.mAnimationOnly = true;
+		}
+		else if (strcmp(lArg, "--topology") == 0)
+		{
+			if (i + 1 < argc && strcmp(argv[i + 1], "pairs") == 0)
+				pOptions.mTopology = eTopologyMarkerPairs;
+			else if (i + 1 < argc && strcmp(argv[i + 1], "single") == 0)
+				pOptions.mTopology = eTopologySingleNode;
+			else
+			{
+				printf("Error: --topology expects 'pairs' or 'single'\n");
+				return false;
+			}
+			i += 1;
+		}
+		else if (strcmp(lArg, "--verify-topology") == 0)
+		{
+			pOptions.mVerifyTopology = true;
+		}
+		else if (strcmp(lArg, "--batch") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				printf("Error: --batch expects a manifest file or '-'\n");
+				return false;
+			}
+			pOptions.mBatchManifest = argv[++i];
+		}
+		else if (strcmp(lArg, "--serve") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				printf("Error: --serve expects a socket path\n");
+				return false;
+			}
+			pOptions.mServeSocket = argv[++i];
+		}
+		else if (strcmp(lArg, "--connect") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				printf("Error: --connect expects a socket path\n");
+				return false;
+			}
+			pOptions.mConnectSocket = argv[++i];
+		}
+		else if (strcmp(lArg, "--jobs") == 0)
+		{
+			double lCount;
+			if (i + 1 >= argc || !ParseNumber(argv[i + 1], lCount) || lCount < 0.0 || lCount != floor(lCount))
+			{
+				printf("Error: --jobs expects a number of threads (0 for one per hardware thread)\n");
+				return false;
+			}
+			pOptions.mWorkerCount = unsigned(lCount);
+			i += 1;
+		}
+		else if (strcmp(lArg, "--stats") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				printf("Error: --stats expects a report file\n");
+				return false;
+			}
+			pOptions.mStatsFile = argv[++i];
+		}
+		else if (strcmp(lArg, "--trace") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				printf("Error: --trace expects a trace file\n");
+				return false;
+			}
+			pOptions.mTraceFile = argv[++i];
+		}
+		else if (strcmp(lArg, "--cache") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				printf("Error: --cache expects a directory\n");
+				return false;
+			}
+			pOptions.mCacheDirectory = argv[++i];
+		}
+		else if (strcmp(lArg, "--cache-size") == 0)
+		{
+			double lMegabytes;
+			if (i + 1 >= argc || !ParseNumber(argv[i + 1], lMegabytes)
+				|| !std::isfinite(lMegabytes) || !(lMegabytes >= 0.0 && lMegabytes <= kMaxCacheMegabytes))
+			{
+				printf("Error: --cache-size expects a size in megabytes (0 to %.0f)\n", kMaxCacheMegabytes);
+				return false;
+			}
+			pOptions.mCacheMaxBytes = uint64_t(lMegabytes * 1024.0 * 1024.0);
+			i += 1;
+		}
+		else if (strcmp(lArg, "--format") == 0)
+		{
+			if (i + 1 >= argc)
+			{
+				printf("Error: --format expects 0 (binary) or -1 (ASCII)\n");
+				return false;
+			}
+			pOptions.mFileFormat = atoi(argv[++i]);
+		}
+		else if (strcmp(lArg, "-o") == 0)
+		{
+			if (i + 1 >= argc || lOutputOption || lPositional > 1)
+			{
+				printf("Error: -o expects one output file or '-' (and no <fbx output> argument)\n");
+				return false;
+			}
+			pOptions.mOutput = argv[++i];
+			lOutputOption = true;
+		}
+		else if (strncmp(lArg, "--", 2) == 0)
+		{
+			printf("Error: Unknown option '%s'\n", lArg);
+			return false;
+		}
+		else if (lPositional == 0)
+		{
+			pOptions.mInput = lArg;
+			lPositional++;
+		}
+		else if (lPositional == 1 && !lOutputOption)
+		{
+			pOptions.mOutput = lArg;
+			lPositional++;
+		}
+		else if (lPositional == 2 || (lPositional == 1 && lOutputOption))
+		{
+			pOptions.mFileFormat = atoi(lArg);
+			lPositional = 3;
+		}
+		else
+		{
+			printf("Error: Unexpected argument '%s'\n", lArg);
+			return false;
+		}
+	}
+
+	if (int(pOptions.Batch()) + int(pOptions.Serve()) + int(pOptions.Connect()) > 1)
+	{
+		printf("Error: --batch, --serve and --connect exclude each other\n");
+		return false;
+	}
+
+	if (pOptions.mVerifyTopology && pOptions.mTopology != eTopologySingleNode)
+	{
+		printf("Error: --verify-topology checks the nodes of --topology single\n");
+		return false;
+	}
+
+	if (pOptions.Batch())
+	{
+		if (lPositional > 0 || lOutputOption)
+		{
+			printf("Error: Input and output files come from the manifest in batch mode\n");
+			return false;
+		}
+		return true;
+	}
+
+	if (pOptions.Serve())
+	{
+		if (lPositional > 0 || lOutputOption)
+		{
+			printf("Error: Input and output files come from the requests in server mode\n");
+			return false;
+		}
+		return true;
+	}
+
+	if (lPositional < 1 || pOptions.mOutput.empty())
+	{
+		PrintUsage(argv[0]);
+		return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,85 @@
+#ifndef _CONVERSION_OPTIONS_H
+#define _CONVERSION_OPTIONS_H
+
+#include <stdint.h>
+#include <string>
+
+// Nodes carrying the curves of a device.
+enum EDeviceTopology
+{
+	eTopologyMarkerPairs,	// a position marker and a rotation marker below it
+	eTopologySingleNode		// one node with both, the fixed marker rotation baked in
+};
+
+// Everything that controls one conversion, as given on the command line.
+struct ConversionOptions
+{
+	std::string mInput;
+	std::string mOutput;		// "-" for stdout
+
+	// FBX writer format index, -1 for ASCII (see SaveScene)
+	int mFileFormat;
+
+	// Key reduction tolerances in centimeters and degrees, 0 to keep every key
+	double mTranslationTolerance;
+	double mRotationTolerance;
+
+	// Frame rate of the uniform grid the poses are resampled to, 0 to keep the recorded times
+	double mFrameRate;
+
+	// Write the file with the built-in FBX writer instead of the FBX SDK exporter
+	bool mNativeWriter;
+	bool mCompressArrays;
+
+	// Write only the marker hierarchy and the animation, without the pyramid
+	// meshes, their materials and the camera
+	bool mAnimationOnly;
+
+	// Device nodes, and whether to check that a single node reproduces the
+	// world transforms of the marker pairs
+	EDeviceTopology mTopology;
+	bool mVerifyTopology;
+
+	// Manifest of input/output pairs ("-" for stdin) to convert in one run
+	std::string mBatchManifest;
+
+	// Socket to accept conversion requests on (--serve) or to send this one to (--connect)
+	std::string mServeSocket;
+	std::string mConnectSocket;
+
+	// JSON report of stage times and counters, written after the conversion (or batch)
+	std::string mStatsFile;
+
+	// Chrome trace of the conversion spans (build with MOTION2FBX_TRACE)
+	std::string mTraceFile;
+
+	// Directory of previous outputs to reuse for unchanged inputs, empty for
+	// no cache, and the size it is trimmed to
+	std::string mCacheDirectory;
+	uint64_t mCacheMaxBytes;
+
+	// Batch or server worker threads, 0 for one per hardware thread
+	unsigned mWorkerCount;
+
+	// Threads parsing one recording, 0 for one per hardware thread
+	unsigned mIngestThreads;
+
+	ConversionOptions();
+
+	bool ReduceKeys() const { return mTranslationTolerance > 0.0 || mRotationTolerance > 0.0; }
+	bool Resample() const { return mFrameRate > 0.0; }
+	bool Batch() const { return !mBatchManifest.empty(); }
+	bool Serve() const { return !mServeSocket.empty(); }
+	bool Connect() const { return !mConnectSocket.empty(); }
+	bool UseCache() const { return !mCacheDirectory.empty(); }
+};
+
+void PrintUsage(const char* pProgram);
+
+// Parse "<json input> <fbx output> [<format>] [options]" (the output may also be given as
+// "-o <fbx output>", "-" for stdout), "--batch <manifest> [options]" or
+// "--serve <socket> [options]". Return false, after printing the reason, if the arguments are
+// incomplete or invalid.
+bool ParseConversionOptions(int argc, char** argv, ConversionOptions& pOptions);
+
+#endif // #ifndef _CONVERSION_OPTIONS_H
@@ -0,0 +1,474 @@
+#include "ConversionServer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+	#include <condition_variable>
+	#include <deque>
+	#include <mutex>
+	#include <thread>
+	#include <vector>
+
+	#include <errno.h>
+	#include <poll.h>
+	#include <signal.h>
+	#include <sys/socket.h>
+	#include <sys/stat.h>
+	#include <sys/un.h>
+	#include <unistd.h>
+#endif
+
+ServeRequest::ServeRequest()
+	: mData(NULL), mSize(0)
+{
+}
+
+#ifdef _WIN32
+
+bool RunConversionServer(const std::string& pSocketPath, unsigned pWorkerCount,
+	const ConversionOptions& pDefaults, const ServeHandler& pHandler)
+{
+	printf("Error: --serve needs Unix domain sockets, which this build does not support\n");
+	return false;
+}
+
+bool RunConversionClient(const ConversionOptions& pOptions, int argc, char** argv)
+{
+	printf("Error: --connect needs Unix domain sockets, which this build does not support\n");
+	return false;
+}
+
+#else
+
+namespace
+{
+	const uint32_t kMaxFields = 256;
+	const uint32_t kMaxArgumentBytes = 64 * 1024;
+	const uint32_t kMaxInlineBytes = 1024u * 1024u * 1024u;
+
+	// accepted connections waiting for a worker, per worker
+	const size_t kQueuedPerWorker = 4;
+
+	// how often blocked calls look at gStop
+	const int kPollMilliseconds = 250;
+
+	volatile sig_atomic_t gStop = 0;
+
+	void OnStopSignal(int)
+	{
+		gStop = 1;
+	}
+
+	// Receive exactly pSize bytes. Fails on end of stream, errors and once
+	// the server is stopping.
+	bool ReceiveAll(int pSocket, void* pData, size_t pSize)
+	{
+		char* lData = static_cast<char*>(pData);
+		while (pSize > 0)
+		{
+			ssize_t lCount = recv(pSocket, lData, pSize, 0);
+			if (lCount > 0)
+			{
+				lData += lCount;
+				pSize -= size_t(lCount);
+			}
+			else if (lCount == 0 || (errno != EINTR && errno != EAGAIN && errno != EWOULDBLOCK) || gStop)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool SendAll(int pSocket, const void* pData, size_t pSize)
+	{
+		const char* lData = static_cast<const char*>(pData);
+		while (pSize > 0)
+		{
+			ssize_t lCount = send(pSocket, lData, pSize, 0);
+			if (lCount > 0)
+			{
+				lData += lCount;
+				pSize -= size_t(lCount);
+			}
+			else if (lCount < 0 && errno != EINTR)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	bool ReceiveU32(int pSocket, uint32_t& pValue)
+	{
+		return ReceiveAll(pSocket, &pValue, 4);
+	}
+
+	bool SendU32(int pSocket, uint32_t pValue)
+	{
+		return SendAll(pSocket, &pValue, 4);
+	}
+
+	bool ReceiveField(int pSocket, uint32_t pMaxSize, std::string& pField)
+	{
+		uint32_t lSize;
+		if (!ReceiveU32(pSocket, lSize) || lSize > pMaxSize)
+			return false;
+		pField.resize(lSize);
+		return lSize == 0 || ReceiveAll(pSocket, &pField[0], lSize);
+	}
+
+	bool SendField(int pSocket, const char* pData, size_t pSize)
+	{
+		return SendU32(pSocket, uint32_t(pSize)) && SendAll(pSocket, pData, pSize);
+	}
+
+	bool SendField(int pSocket, const std::string& pField)
+	{
+		return SendField(pSocket, pField.data(), pField.size());
+	}
+
+	bool FillSocketAddress(const std::string& pPath, sockaddr_un& pAddress)
+	{
+		memset(&pAddress, 0, sizeof(pAddress));
+		pAddress.sun_family = AF_UNIX;
+		if (pPath.empty() || pPath.size() >= sizeof(pAddress.sun_path))
+		{
+			printf("Error: Invalid socket path '%s'\n", pPath.c_str());
+			return false;
+		}
+		memcpy(pAddress.sun_path, pPath.c_str(), pPath.size() + 1);
+		return true;
+	}
+
+	int Connect(const std::string& pPath)
+	{
+		sockaddr_un lAddress;
+		if (!FillSocketAddress(pPath, lAddress))
+			return -1;
+
+		int lSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (lSocket < 0)
+			return -1;
+		if (connect(lSocket, reinterpret_cast<sockaddr*>(&lAddress), sizeof(lAddress)) != 0)
+		{
+			close(lSocket);
+			return -1;
+		}
+		return lSocket;
+	}
+
+	std::string ResolvePath(const std::string& pDirectory, const std::string& pPath)
+	{
+		if (pPath.empty() || pPath == "-" || pPath[0] == '/' || pDirectory.empty())
+			return pPath;
+		return pDirectory + "/" + pPath;
+	}
+
+	// Accepted sockets waiting for a worker. Push blocks while the queue is full.
+	class ConnectionQueue
+	{
+	public:
+		explicit ConnectionQueue(size_t pCapacity) : mCapacity(pCapacity), mClosed(false) {}
+
+		void Push(int pSocket)
+		{
+			std::unique_lock<std::mutex> lLock(mMutex);
+			mNotFull.wait(lLock, [this] { return mSockets.size() < mCapacity; });
+			mSockets.push_back(pSocket);
+			mNotEmpty.notify_one();
+		}
+
+		// Return false once the queue is closed and drained.
+		bool Pop(int& pSocket)
+		{
+			std::unique_lock<std::mutex> lLock(mMutex);
+			mNotEmpty.wait(lLock, [this] { return !mSockets.empty() || mClosed; });
+			if (mSockets.empty())
+				return false;
+			pSocket = mSockets.front();
+			mSockets.pop_front();
+			mNotFull.notify_one();
+			return true;
+		}
+
+		void Close()
+		{
+			std::lock_guard<std::mutex> lLock(mMutex);
+			mClosed = true;
+			mNotEmpty.notify_all();
+		}
+
+	private:
+		std::mutex mMutex;
+		std::condition_variable mNotEmpty;
+		std::condition_variable mNotFull;
+		std::deque<int> mSockets;
+		size_t mCapacity;
+		bool mClosed;
+	};
+
+	// Turn the received fields into a request. Return false, with the reason
+	// in pError, if they are not a valid conversion command line.
+	bool ParseRequest(const std::vector<std::string>& pFields, const ConversionOptions& pDefaults,
+		ServeRequest& pRequest, std::string& pError)
+	{
+		if (pFields.size() < 2)
+		{
+			pError = "expected a working directory and arguments";
+			return false;
+		}
+
+		std::vector<char*> lArguments;
+		lArguments.push_back(const_cast<char*>("motion2fbx"));
+		for (size_t i = 1; i < pFields.size(); i++)
+			lArguments.push_back(const_cast<char*>(pFields[i].c_str()));
+
+		pRequest.mOptions = pDefaults;
+		if (!ParseConversionOptions(int(lArguments.size()), &lArguments[0], pRequest.mOptions))
+		{
+			pError = "invalid arguments";
+			return false;
+		}
+
+		ConversionOptions& lOptions = pRequest.mOptions;
+		if (lOptions.Batch() || lOptions.Serve() || lOptions.Connect() || !lOptions.mTraceFile.empty())
+		{
+			pError = "--batch, --serve, --connect and --trace are not accepted in requests";
+			return false;
+		}
+
+		if (lOptions.mOutput == "-")
+		{
+			pError = "the server cannot write to the client's stdout, give an output file";
+			return false;
+		}
+
+		lOptions.mInput = ResolvePath(pFields[0], lOptions.mInput);
+		lOptions.mOutput = ResolvePath(pFields[0], lOptions.mOutput);
+		lOptions.mStatsFile = ResolvePath(pFields[0], lOptions.mStatsFile);
+		if (lOptions.mCacheDirectory != pDefaults.mCacheDirectory)
+			lOptions.mCacheDirectory = ResolvePath(pFields[0], lOptions.mCacheDirectory);
+		return true;
+	}
+
+	// Answer the requests of one connection until the client closes it.
+	void ServeConnection(int pSocket, unsigned pWorker, const ConversionOptions& pDefaults, const ServeHandler& pHandler)
+	{
+		for (;;)
+		{
+			uint32_t lFieldCount;
+			if (!ReceiveU32(pSocket, lFieldCount) || lFieldCount > kMaxFields)
+				return;
+
+			std::vector<std::string> lFields(lFieldCount);
+			for (uint32_t i = 0; i < lFieldCount; i++)
+			{
+				if (!ReceiveField(pSocket, kMaxArgumentBytes, lFields[i]))
+					return;
+			}
+
+			ServeRequest lRequest;
+			std::string lError;
+			std::string lData;
+			bool lValid = ParseRequest(lFields, pDefaults, lRequest, lError);
+			if (lValid && lRequest.mOptions.mInput == "-")
+			{
+				if (!ReceiveField(pSocket, kMaxInlineBytes, lData))
+					return;
+				lRequest.mData = lData.data();
+				lRequest.mSize = lData.size();
+			}
+
+			char lReply[256];
+			JobResult lResult;
+			if (!lValid)
+			{
+				snprintf(lReply, sizeof(lReply), "error %s", lError.c_str());
+			}
+			else if (!pHandler(lRequest, pWorker, lResult))
+			{
+				snprintf(lReply, sizeof(lReply), "error conversion failed, see the server output");
+			}
+			else
+			{
+				snprintf(lReply, sizeof(lReply), "ok %llu %llu %.6f", (unsigned long long)lResult.mInputBytes,
+					(unsigned long long)lResult.mPoseCount, lResult.mSeconds);
+			}
+
+			printf("[worker %u] %s -> %s: %s\n", pWorker, lRequest.mOptions.mInput.c_str(),
+				lRequest.mOptions.mOutput.c_str(), lReply);
+			fflush(stdout);
+
+			// after an invalid request it is unknown whether an inline recording follows
+			if (!SendField(pSocket, lReply, strlen(lReply)) || !lValid)
+				return;
+		}
+	}
+
+	// Bind pPath, replacing a socket file left behind by a server that is gone.
+	int Listen(const std::string& pPath)
+	{
+		sockaddr_un lAddress;
+		if (!FillSocketAddress(pPath, lAddress))
+			return -1;
+
+		struct stat lStat;
+		if (stat(pPath.c_str(), &lStat) == 0 && S_ISSOCK(lStat.st_mode))
+		{
+			int lRunning = Connect(pPath);
+			if (lRunning >= 0)
+			{
+				close(lRunning);
+				printf("Error: A server is already listening on '%s'\n", pPath.c_str());
+				return -1;
+			}
+			unlink(pPath.c_str());
+		}
+
+		int lSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (lSocket < 0
+			|| bind(lSocket, reinterpret_cast<sockaddr*>(&lAddress), sizeof(lAddress)) != 0
+			|| listen(lSocket, SOMAXCONN) != 0)
+		{
+			printf("Error: Unable to listen on '%s': %s\n", pPath.c_str(), strerror(errno));
+			if (lSocket >= 0)
+				close(lSocket);
+			return -1;
+		}
+		return lSocket;
+	}
+}
+
+bool RunConversionServer(const std::string& pSocketPath, unsigned pWorkerCount,
+	const ConversionOptions& pDefaults, const ServeHandler& pHandler)
+{
+	int lListener = Listen(pSocketPath);
+	if (lListener < 0)
+		return false;
+
+	// replies to clients that went away must not kill the server
+	signal(SIGPIPE, SIG_IGN);
+
+	struct sigaction lStop;
+	memset(&lStop, 0, sizeof(lStop));
+	lStop.sa_handler = OnStopSignal;
+	sigaction(SIGINT, &lStop, NULL);
+	sigaction(SIGTERM, &lStop, NULL);
+
+	if (pWorkerCount == 0)
+		pWorkerCount = 1;
+
+	ConnectionQueue lQueue(pWorkerCount * kQueuedPerWorker);
+	std::vector<std::thread> lWorkers;
+	for (unsigned w = 0; w < pWorkerCount; w++)
+	{
+		lWorkers.push_back(std::thread([&, w]
+		{
+			int lSocket;
+			while (lQueue.Pop(lSocket))
+			{
+				ServeConnection(lSocket, w, pDefaults, pHandler);
+				close(lSocket);
+			}
+		}));
+	}
+
+	printf("Serving on '%s' with %u workers\n", pSocketPath.c_str(), pWorkerCount);
+	fflush(stdout);
+
+	while (!gStop)
+	{
+		pollfd lPoll = { lListener, POLLIN, 0 };
+		if (poll(&lPoll, 1, kPollMilliseconds) <= 0)
+			continue;
+
+		int lSocket = accept(lListener, NULL, NULL);
+		if (lSocket < 0)
+			continue;
+
+		// lets idle connections notice a stop request
+		timeval lTimeout = { 0, kPollMilliseconds * 1000 };
+		setsockopt(lSocket, SOL_SOCKET, SO_RCVTIMEO, &lTimeout, sizeof(lTimeout));
+		lQueue.Push(lSocket);
+	}
+
+	lQueue.Close();
+	for (size_t w = 0; w < lWorkers.size(); w++)
+		lWorkers[w].join();
+
+	close(lListener);
+	unlink(pSocketPath.c_str());
+	printf("Server stopped\n");
+	return true;
+}
+
+bool RunConversionClient(const ConversionOptions& pOptions, int argc, char** argv)
+{
+	std::vector<std::string> lFields;
+
+	char lDirectory[4096];
+	lFields.push_back(getcwd(lDirectory, sizeof(lDirectory)) ? lDirectory : "");
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--connect") == 0)
+			i++;
+		else
+			lFields.push_back(argv[i]);
+	}
+
+	std::string lData;
+	if (pOptions.mInput == "-")
+	{
+		char lChunk[1 << 16];
+		size_t lCount;
+		while ((lCount = fread(lChunk, 1, sizeof(lChunk), stdin)) > 0)
+			lData.append(lChunk, lCount);
+	}
+
+	std::chrono::steady_clock::time_point lStart = std::chrono::steady_clock::now();
+
+	int lSocket = Connect(pOptions.mConnectSocket);
+	if (lSocket < 0)
+	{
+		printf("Error: Unable to connect to '%s'\n", pOptions.mConnectSocket.c_str());
+		return false;
+	}
+	signal(SIGPIPE, SIG_IGN);
+
+	bool lSent = SendU32(lSocket, uint32_t(lFields.size()));
+	for (size_t i = 0; lSent && i < lFields.size(); i++)
+		lSent = SendField(lSocket, lFields[i]);
+	if (lSent && pOptions.mInput == "-")
+		lSent = SendField(lSocket, lData);
+
+	std::string lReply;
+	bool lReceived = lSent && ReceiveField(lSocket, kMaxArgumentBytes, lReply);
+	close(lSocket);
+
+	double lRoundTrip = std::chrono::duration<double>(std::chrono::steady_clock::now() - lStart).count();
+
+	if (!lReceived)
+	{
+		printf("Error: No reply from the server\n");
+		return false;
+	}
+
+	unsigned long long lBytes, lPoses;
+	double lSeconds;
+	if (sscanf(lReply.c_str(), "ok %llu %llu %lf", &lBytes, &lPoses, &lSeconds) == 3)
+	{
+		printf("%s -> %s: %.1f MB, %llu poses converted in %.3f s (%.3f s round trip)\n",
+			pOptions.mInput.c_str(), pOptions.mOutput.c_str(), double(lBytes) / (1024.0 * 1024.0),
+			lPoses, lSeconds, lRoundTrip);
+		return true;
+	}
+
+	printf("Error: Server replied '%s'\n", lReply.c_str());
+	return false;
+}
+
+#endif // #ifdef _WIN32
@@ -0,0 +1,49 @@
+#ifndef _CONVERSION_SERVER_H
+#define _CONVERSION_SERVER_H
+
+#include "BatchJobs.h"
+#include "ConversionOptions.h"
+
+#include <functional>
+#include <string>
+
+// Conversion daemon protocol (--serve / --connect), over a Unix domain
+// socket. A field is a little endian uint32 byte count followed by the bytes.
+//
+//	request:	uint32 field count, then the fields: the client's working
+//				directory and the command line arguments of the conversion
+//				("<json input> <fbx output> [<format>] [options]"). If the
+//				input is "-", one more field holds the JSON recording.
+//	reply:		one field, "ok <input bytes> <poses> <seconds>" or
+//				"error <reason>".
+//
+// A connection can carry any number of requests, answered in order.
+
+// One conversion received by the server. Relative paths are already
+// resolved against the client's working directory.
+struct ServeRequest
+{
+	ConversionOptions mOptions;
+
+	// JSON recording sent with the request, NULL if mOptions.mInput names a file
+	const char* mData;
+	size_t mSize;
+
+	ServeRequest();
+};
+
+// Convert pRequest on worker thread pWorker (0 to worker count - 1).
+typedef std::function<bool(const ServeRequest& pRequest, unsigned pWorker, JobResult& pResult)> ServeHandler;
+
+// Listen on pSocketPath and hand every connection to one of pWorkerCount
+// worker threads; connections wait in a bounded queue while all are busy.
+// Request options start from pDefaults. Runs until SIGINT or SIGTERM.
+bool RunConversionServer(const std::string& pSocketPath, unsigned pWorkerCount,
+	const ConversionOptions& pDefaults, const ServeHandler& pHandler);
+
+// Send the conversion given by the command line (minus --connect) to the
+// server listening on pOptions.mConnectSocket and print its reply. An input
+// of "-" is read from stdin and sent with the request.
+bool RunConversionClient(const ConversionOptions& pOptions, int argc, char** argv);
+
+#endif // #ifndef _CONVERSION_SERVER_H
@@ -0,0 +1,159 @@
+#include "ConversionStats.h"
+#include "BatchJobs.h"
+#include "nlohmann/json.hpp"
+
+#include <cstdio>
+#include <fstream>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <psapi.h>
+	#pragma comment(lib, "psapi.lib")
+#else
+	#include <sys/resource.h>
+#endif
+
+using json = nlohmann::json;
+
+const char* GetStageName(EConversionStage pStage)
+{
+	static const char* lNames[eStageCount] = { "read", "parse", "resample", "topology", "timeline", "sdk_setup", "scene", "curves", "reduce", "save", "cache" };
+	return lNames[pStage];
+}
+
+ConversionStats::ConversionStats()
+	: mCurvesCreated(0), mKeysWritten(0), mBytesWritten(0), mCacheHits(0), mActiveTimer(NULL)
+{
+	for (int i = 0; i < eStageCount; i++)
+		mStageSeconds[i] = 0.0;
+}
+
+void ConversionStats::Add(const ConversionStats& pOther)
+{
+	for (int i = 0; i < eStageCount; i++)
+		mStageSeconds[i] += pOther.mStageSeconds[i];
+	mCurvesCreated += pOther.mCurvesCreated;
+	mKeysWritten += pOther.mKeysWritten;
+	mBytesWritten += pOther.mBytesWritten;
+	mCacheHits += pOther.mCacheHits;
+}
+
+double ConversionStats::TotalSeconds() const
+{
+	double lTotal = 0.0;
+	for (int i = 0; i < eStageCount; i++)
+		lTotal += mStageSeconds[i];
+	return lTotal;
+}
+
+StageTimer::StageTimer(ConversionStats& pStats, EConversionStage pStage)
+	: mStats(pStats), mStage(pStage), mOuter(pStats.mActiveTimer), mStart(Clock::now())
+#ifdef MOTION2FBX_TRACE
+	, mSpan(GetStageName(pStage))
+#endif
+{
+	if (mOuter)
+		mOuter->Pause(mStart);
+	mStats.mActiveTimer = this;
+}
+
+StageTimer::~StageTimer()
+{
+	Clock::time_point lNow = Clock::now();
+	Pause(lNow);
+	mStats.mActiveTimer = mOuter;
+	if (mOuter)
+		mOuter->Resume(lNow);
+}
+
+void StageTimer::Pause(Clock::time_point pNow)
+{
+	mStats.mStageSeconds[mStage] += std::chrono::duration<double>(pNow - mStart).count();
+}
+
+void StageTimer::Resume(Clock::time_point pNow)
+{
+	mStart = pNow;
+}
+
+uint64_t GetPeakResidentBytes()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS lCounters;
+	if (!GetProcessMemoryInfo(GetCurrentProcess(), &lCounters, sizeof(lCounters)))
+		return 0;
+	return uint64_t(lCounters.PeakWorkingSetSize);
+#else
+	struct rusage lUsage;
+	if (getrusage(RUSAGE_SELF, &lUsage) != 0)
+		return 0;
+#ifdef __APPLE__
+	return uint64_t(lUsage.ru_maxrss);			// bytes
+#else
+	return uint64_t(lUsage.ru_maxrss) * 1024;	// kilobytes
+#endif
+#endif
+}
+
+static json StatsToJson(const ConversionStats& pStats, uint64_t pInputBytes, uint64_t pPoses)
+{
+	json lStages = json::object();
+	for (int i = 0; i < eStageCount; i++)
+		lStages[GetStageName(EConversionStage(i))] = pStats.mStageSeconds[i];
+
+	json lCounters = json::object();
+	lCounters["input_bytes"] = pInputBytes;
+	lCounters["poses_read"] = pPoses;
+	lCounters["curves_created"] = pStats.mCurvesCreated;
+	lCounters["keys_written"] = pStats.mKeysWritten;
+	lCounters["bytes_written"] = pStats.mBytesWritten;
+	lCounters["cache_hits"] = pStats.mCacheHits;
+
+	json lResult = json::object();
+	lResult["stage_seconds"] = lStages;
+	lResult["counters"] = lCounters;
+	return lResult;
+}
+
+bool WriteStatsReport(const std::string& pPath, const std::vector<ConversionJob>& pJobs,
+	const std::vector<JobResult>& pResults, double pTotalSeconds)
+{
+	ConversionStats lTotal;
+	uint64_t lInputBytes = 0;
+	uint64_t lPoses = 0;
+	size_t lFailed = 0;
+
+	json lJobs = json::array();
+	for (size_t i = 0; i < pResults.size(); i++)
+	{
+		const JobResult& lResult = pResults[i];
+		json lJob = StatsToJson(lResult.mStats, lResult.mInputBytes, lResult.mPoseCount);
+		lJob["input"] = pJobs[i].mInput;
+		lJob["output"] = pJobs[i].mOutput;
+		lJob["succeeded"] = lResult.mSucceeded;
+		lJob["seconds"] = lResult.mSeconds;
+		lJobs.push_back(lJob);
+
+		lTotal.Add(lResult.mStats);
+		lInputBytes += lResult.mInputBytes;
+		lPoses += lResult.mPoseCount;
+		if (!lResult.mSucceeded)
+			lFailed++;
+	}
+
+	json lReport = StatsToJson(lTotal, lInputBytes, lPoses);
+	lReport["jobs"] = lJobs;
+	lReport["job_count"] = pResults.size();
+	lReport["failed_count"] = lFailed;
+	lReport["seconds"] = pTotalSeconds;
+	lReport["peak_rss_bytes"] = GetPeakResidentBytes();
+
+	std::ofstream lFile(pPath.c_str());
+	lFile << lReport.dump(2) << "\n";
+	if (!lFile)
+	{
+		printf("Error: Unable to write stats report '%s'\n", pPath.c_str());
+		return false;
+	}
+	return true;
+}
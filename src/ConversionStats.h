@@ -0,0 +1,92 @@
+#ifndef _CONVERSION_STATS_H
+#define _CONVERSION_STATS_H
+
+#include "Trace.h"
+
+#include <stdint.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+// Stages a conversion is timed in. The native writer builds and reduces its
+// curves while the file is written, so with --native only scene, reduce and
+// save are measured.
+enum EConversionStage
+{
+	eStageRead,			// open/map the input
+	eStageParse,		// JSON to pose buffers
+	eStageResample,
+	eStageTopology,		// bake the marker rotations (--topology single)
+	eStageTimeline,		// session time origin and key times (BuildTimeline)
+	eStageSdkSetup,		// FbxManager of the worker, first SDK conversion only
+	eStageScene,		// markers, meshes, camera, animation stack (CreateScene)
+	eStageCurves,		// AnimateTrack
+	eStageReduce,
+	eStageSave,			// FbxExporter or the native writer
+	eStageCache,		// hash the input, fetch or store the output (--cache)
+	eStageCount
+};
+
+const char* GetStageName(EConversionStage pStage);
+
+class StageTimer;
+struct ConversionJob;
+struct JobResult;
+
+// Stage times and counters of one conversion, or the sum of several. Input
+// bytes and poses read are in JobResult.
+struct ConversionStats
+{
+	double mStageSeconds[eStageCount];
+
+	uint64_t mCurvesCreated;
+	uint64_t mKeysWritten;
+	uint64_t mBytesWritten;
+	uint64_t mCacheHits;
+
+	// innermost running timer, paused while a nested one runs
+	StageTimer* mActiveTimer;
+
+	ConversionStats();
+
+	void Add(const ConversionStats& pOther);
+	double TotalSeconds() const;
+};
+
+// Adds the time between construction and destruction to a stage. A timer
+// started while another one runs on the same stats pauses the outer one,
+// so stage times never overlap and add up to the measured total. The stage
+// is also a trace span.
+class StageTimer
+{
+public:
+	StageTimer(ConversionStats& pStats, EConversionStage pStage);
+	~StageTimer();
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	StageTimer(const StageTimer&);
+	StageTimer& operator=(const StageTimer&);
+
+	void Pause(Clock::time_point pNow);
+	void Resume(Clock::time_point pNow);
+
+	ConversionStats& mStats;
+	EConversionStage mStage;
+	StageTimer* mOuter;
+	Clock::time_point mStart;
+#ifdef MOTION2FBX_TRACE
+	TraceSpan mSpan;
+#endif
+};
+
+// Largest resident set of this process so far, 0 if unknown.
+uint64_t GetPeakResidentBytes();
+
+// Write the stage times and counters of every job, their sum and the peak
+// RSS as JSON to pPath.
+bool WriteStatsReport(const std::string& pPath, const std::vector<ConversionJob>& pJobs,
+	const std::vector<JobResult>& pResults, double pTotalSeconds);
+
+#endif // #ifndef _CONVERSION_STATS_H
@@ -0,0 +1,68 @@
+#include "CurveSimplify.h"
+
+#include <cmath>
+#include <utility>
+
+KeyReductionStats::KeyReductionStats()
+	: mCurves(0), mKeysBefore(0), mKeysAfter(0), mMaxTranslationError(0.0), mMaxRotationError(0.0)
+{
+}
+
+size_t SimplifyLinear(const double* pTimes, const float* pValues, size_t pCount,
+	double pTolerance, std::vector<char>& pKeep, double& pMaxError)
+{
+	pKeep.assign(pCount, 0);
+	pMaxError = 0.0;
+	if (pCount <= 2)
+	{
+		pKeep.assign(pCount, 1);
+		return pCount;
+	}
+
+	pKeep[0] = 1;
+	pKeep[pCount - 1] = 1;
+	size_t lKept = 2;
+
+	// explicit stack of segments still to check, tracks can be very long
+	std::vector<std::pair<size_t, size_t> > lSegments;
+	lSegments.push_back(std::make_pair(size_t(0), pCount - 1));
+
+	while (!lSegments.empty())
+	{
+		size_t a = lSegments.back().first;
+		size_t b = lSegments.back().second;
+		lSegments.pop_back();
+
+		double lSpan = pTimes[b] - pTimes[a];
+		double lSlope = lSpan > 0.0 ? (double(pValues[b]) - pValues[a]) / lSpan : 0.0;
+
+		size_t lWorst = a;
+		double lWorstError = 0.0;
+		for (size_t i = a + 1; i < b; i++)
+		{
+			double lInterpolated = pValues[a] + lSlope * (pTimes[i] - pTimes[a]);
+			double lError = fabs(pValues[i] - lInterpolated);
+			if (lError > lWorstError)
+			{
+				lWorstError = lError;
+				lWorst = i;
+			}
+		}
+
+		if (lWorstError > pTolerance)
+		{
+			pKeep[lWorst] = 1;
+			lKept++;
+			if (lWorst - a > 1)
+				lSegments.push_back(std::make_pair(a, lWorst));
+			if (b - lWorst > 1)
+				lSegments.push_back(std::make_pair(lWorst, b));
+		}
+		else if (lWorstError > pMaxError)
+		{
+			pMaxError = lWorstError;
+		}
+	}
+
+	return lKept;
+}
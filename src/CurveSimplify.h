@@ -0,0 +1,30 @@
+#ifndef _CURVE_SIMPLIFY_H
+#define _CURVE_SIMPLIFY_H
+
+#include <stddef.h>
+#include <vector>
+
+struct KeyReductionStats
+{
+	int mCurves;
+	size_t mKeysBefore;
+	size_t mKeysAfter;
+
+	// largest difference between a removed key and the reduced curve
+	double mMaxTranslationError;	// centimeters
+	double mMaxRotationError;		// degrees
+
+	KeyReductionStats();
+
+	double Ratio() const { return mKeysAfter ? double(mKeysBefore) / double(mKeysAfter) : 0.0; }
+};
+
+// Ramer-Douglas-Peucker for linearly interpolated samples: mark in pKeep the
+// samples needed so that interpolating between kept samples reproduces every
+// sample within pTolerance (measured along the value axis). The first and
+// last samples are always kept. Return the number of kept samples and store
+// the largest error of a dropped sample in pMaxError.
+size_t SimplifyLinear(const double* pTimes, const float* pValues, size_t pCount,
+	double pTolerance, std::vector<char>& pKeep, double& pMaxError);
+
+#endif // #ifndef _CURVE_SIMPLIFY_H
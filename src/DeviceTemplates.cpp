@@ -0,0 +1,92 @@
+#include "DeviceTemplates.h"
+
+#include <cstdio>
+
+namespace
+{
+	const double CAMERA_MESH_HEIGHT = 20;
+	const double CAMERA_MESH_SIDE = 10;
+	const double HAND_MESH_HEIGHT = 10;
+	const double HAND_MESH_SIDE = 2;
+
+	// the fixed devices first, in scene order, then the generic tracker
+	const DeviceTemplate kTemplates[] = {
+		{ "camera", { 0, 0, 0 }, CAMERA_MESH_SIDE, CAMERA_MESH_HEIGHT, false, { 0, 0, -CAMERA_MESH_HEIGHT }, { 90, 0, 0 }, true },
+		{ "left", { -160, 180, 90 }, HAND_MESH_SIDE, HAND_MESH_HEIGHT, false, { 0, 0, 0 }, { -60, 0, 90 }, false },
+		{ "right", { 325, -180, -90 }, HAND_MESH_SIDE, HAND_MESH_HEIGHT, true, { 0, 0, 0 }, { -60, 0, 90 }, false },
+		{ NULL, { 0, 0, 0 }, HAND_MESH_SIDE, HAND_MESH_HEIGHT, false, { 0, 0, 0 }, { 0, 0, 0 }, false }
+	};
+	const size_t kFixedDevices = sizeof(kTemplates) / sizeof(kTemplates[0]) - 1;
+
+	// "left" -> "Left"
+	std::string NodeName(const std::string& pTrack)
+	{
+		std::string lName(pTrack);
+		if (!lName.empty() && lName[0] >= 'a' && lName[0] <= 'z')
+			lName[0] = char(lName[0] - 'a' + 'A');
+		return lName;
+	}
+
+	// NodeName(pTrack), with "_<number>" appended if a device of pDevices
+	// already has that name ("Camera" for a track named "Camera" next to
+	// "camera" becomes "Camera_2"), so every device gets its own nodes.
+	std::string UniqueNodeName(const std::string& pTrack, const std::vector<SceneDevice>& pDevices)
+	{
+		std::string lBase = NodeName(pTrack);
+		std::string lName = lBase;
+		for (int lSuffix = 2; ; lSuffix++)
+		{
+			bool lTaken = false;
+			for (size_t d = 0; d < pDevices.size() && !lTaken; d++)
+				lTaken = pDevices[d].mName == lName;
+			if (!lTaken)
+				return lName;
+
+			char lNumber[16];
+			snprintf(lNumber, sizeof(lNumber), "_%d", lSuffix);
+			lName = lBase + lNumber;
+		}
+	}
+}
+
+const DeviceTemplate& GetDeviceTemplate(const std::string& pTrack)
+{
+	for (size_t t = 0; t < kFixedDevices; t++)
+	{
+		if (pTrack == kTemplates[t].mTrack)
+			return kTemplates[t];
+	}
+	return kTemplates[kFixedDevices];
+}
+
+void GetSceneDevices(const PoseRecording& pRecording, std::vector<SceneDevice>& pDevices)
+{
+	static const PoseTrack lEmptyTrack;
+
+	pDevices.clear();
+	pDevices.reserve(kFixedDevices + pRecording.mTracks.size());
+
+	for (size_t t = 0; t < kFixedDevices; t++)
+	{
+		SceneDevice lDevice;
+		lDevice.mTemplate = &kTemplates[t];
+		lDevice.mName = NodeName(kTemplates[t].mTrack);
+		lDevice.mTrack = pRecording.FindTrack(kTemplates[t].mTrack);
+		if (!lDevice.mTrack)
+			lDevice.mTrack = &lEmptyTrack;
+		pDevices.push_back(lDevice);
+	}
+
+	for (size_t i = 0; i < pRecording.mTracks.size(); i++)
+	{
+		const PoseTrack& lTrack = pRecording.mTracks[i];
+		if (GetDeviceTemplate(lTrack.mName).mTrack)
+			continue;
+
+		SceneDevice lDevice;
+		lDevice.mTemplate = &kTemplates[kFixedDevices];
+		lDevice.mName = UniqueNodeName(lTrack.mName, pDevices);
+		lDevice.mTrack = &lTrack;
+		pDevices.push_back(lDevice);
+	}
+}
@@ -0,0 +1,44 @@
+#ifndef _DEVICE_TEMPLATES_H
+#define _DEVICE_TEMPLATES_H
+
+#include "PoseBuffer.h"
+
+#include <string>
+#include <vector>
+
+// How a type of tracked device is shown in the scene: a position marker
+// carrying the translation curves, a rotation marker below it carrying the
+// rotation curves and a pyramid mesh below that (plus the scene camera for
+// the head).
+struct DeviceTemplate
+{
+	const char* mTrack;				// track the template is for, NULL for any other device
+	double mMarkerRotation[3];		// default rotation of the position marker
+	double mMeshSide;
+	double mMeshHeight;
+	bool mMeshApexDown;
+	double mMeshTranslation[3];
+	double mMeshRotation[3];
+	bool mCamera;					// the scene camera is attached to this device
+};
+
+// A device of the scene. Its nodes are named <mName>PositionAnimation,
+// <mName>RotationAnimation and Mesh<mName>.
+struct SceneDevice
+{
+	const DeviceTemplate* mTemplate;
+	std::string mName;
+	const PoseTrack* mTrack;		// an empty track if the recording has none
+};
+
+// Template of the device recorded in the track pTrack: its own for "camera",
+// "left" and "right", the generic tracker one otherwise.
+const DeviceTemplate& GetDeviceTemplate(const std::string& pTrack);
+
+// The devices of the scene of pRecording: "camera", "left" and "right"
+// always (without curves if the recording lacks their track), then every
+// other track in recording order with the generic tracker template. Names
+// that would repeat another device's get a number appended.
+void GetSceneDevices(const PoseRecording& pRecording, std::vector<SceneDevice>& pDevices);
+
+#endif // #ifndef _DEVICE_TEMPLATES_H
@@ -0,0 +1,35 @@
+#ifndef _FAST_NUMBER_H
+#define _FAST_NUMBER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Number parsing for the fields of a pose record. All functions parse the
+// JSON number starting exactly at p and never read at or past pEnd. They
+// return the position after the number, or NULL if the text is not a valid
+// JSON number or does not fit the result.
+
+// Correctly rounded, like strtod(). Short numbers take the exact
+// floating point fast path, longer ones (up to 19 significant digits) the
+// Eisel-Lemire algorithm; only the rare remaining cases go to strtod().
+const char* ParseJsonNumber(const char* p, const char* pEnd, double& pValue);
+
+// The double result narrowed to float, which is what json's get<float>()
+// produced, so position and rotation values are bit-identical to before.
+const char* ParseJsonNumber(const char* p, const char* pEnd, float& pValue);
+
+// Millisecond timestamp to integer microseconds (see PoseTrack::mTimestamp).
+// Integers are exact, their digits read eight at a time (SWAR). Other
+// numbers go through the double value and MillisecondsToMicroseconds(), as
+// in ReadPoseRecording, so both parsers give the same microseconds.
+const char* ParseJsonTimestamp(const char* p, const char* pEnd, int64_t& pValue);
+
+// The rounding of fractional timestamps shared by both parsers: the double
+// value times 1000, rounded to the nearest microsecond. 16772.5925 is stored
+// as 16772.59249.. and gives 16772592. Return false if out of range.
+bool MillisecondsToMicroseconds(double pMilliseconds, int64_t& pMicroseconds);
+
+// Same for integer timestamps, which convert exactly.
+bool MillisecondsToMicroseconds(int64_t pMilliseconds, int64_t& pMicroseconds);
+
+#endif // #ifndef _FAST_NUMBER_H
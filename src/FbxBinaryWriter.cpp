@@ -0,0 +1,343 @@
+#include "FbxBinaryWriter.h"
+
+#include <cstring>
+
+#ifdef MOTION2FBX_ZLIB
+	#include <zlib.h>
+#endif
+
+namespace
+{
+	const char kHeaderMagic[] = "Kaydara FBX Binary  \0\x1a\0";
+	const size_t kHeaderMagicLength = 23;
+
+	// footer constants as found in files written by the SDK; readers check
+	// them against FileId/CreationTime, which the scene writer sets to match
+	const unsigned char kFooterId[16] = { 0xfa, 0xbc, 0xab, 0x09, 0xd0, 0xc8, 0xd4, 0x66, 0xb1, 0x76, 0xfb, 0x83, 0x1c, 0xf7, 0x26, 0x7e };
+	const unsigned char kFooterMagic[16] = { 0xf8, 0x5a, 0x8c, 0x6a, 0xde, 0xf5, 0xd9, 0x7e, 0xec, 0xe9, 0x0c, 0xe3, 0x75, 0x8f, 0x29, 0x0b };
+
+	// end offset, property count and property list length, 8 bytes each, and the name length
+	const size_t kNullRecordLength = 25;
+
+	// small arrays are not worth the zlib header
+	const size_t kMinCompressedBytes = 128;
+
+	size_t ElementSize(char pType)
+	{
+		return pType == 'i' || pType == 'f' ? 4 : 8;
+	}
+}
+
+FbxBinaryWriter::FbxBinaryWriter(std::ostream& pStream, bool pCompressArrays)
+	: mStream(pStream), mOffset(0), mCompress(pCompressArrays && SupportsCompression()),
+	mArrayStart(0), mArrayBytes(0), mArrayWritten(0), mArrayDeflate(false), mDeflate(NULL)
+{
+	Write(kHeaderMagic, kHeaderMagicLength);
+	WriteU32(kVersion);
+}
+
+FbxBinaryWriter::~FbxBinaryWriter()
+{
+#ifdef MOTION2FBX_ZLIB
+	if (mDeflate)
+	{
+		deflateEnd(static_cast<z_stream*>(mDeflate));
+		delete static_cast<z_stream*>(mDeflate);
+	}
+#endif
+}
+
+bool FbxBinaryWriter::SupportsCompression()
+{
+#ifdef MOTION2FBX_ZLIB
+	return true;
+#else
+	return false;
+#endif
+}
+
+// FBX is little endian, like every platform this is built for.
+void FbxBinaryWriter::Write(const void* pData, size_t pSize)
+{
+	mStream.write(static_cast<const char*>(pData), std::streamsize(pSize));
+	mOffset += int64_t(pSize);
+}
+
+void FbxBinaryWriter::WriteU8(uint8_t pValue)
+{
+	Write(&pValue, 1);
+}
+
+void FbxBinaryWriter::WriteU32(uint32_t pValue)
+{
+	Write(&pValue, 4);
+}
+
+void FbxBinaryWriter::WriteU64(uint64_t pValue)
+{
+	Write(&pValue, 8);
+}
+
+void FbxBinaryWriter::PatchU32(int64_t pOffset, uint32_t pValue)
+{
+	mStream.seekp(std::streamoff(pOffset));
+	mStream.write(reinterpret_cast<const char*>(&pValue), 4);
+	mStream.seekp(std::streamoff(mOffset));
+}
+
+void FbxBinaryWriter::PatchU64(int64_t pOffset, uint64_t pValue)
+{
+	mStream.seekp(std::streamoff(pOffset));
+	mStream.write(reinterpret_cast<const char*>(&pValue), 8);
+	mStream.seekp(std::streamoff(mOffset));
+}
+
+void FbxBinaryWriter::WriteNullRecord()
+{
+	static const char lZeros[kNullRecordLength] = { 0 };
+	Write(lZeros, kNullRecordLength);
+}
+
+void FbxBinaryWriter::BeginNode(const char* pName)
+{
+	if (!mNodes.empty())
+	{
+		OpenNode& lParent = mNodes.back();
+		if (!lParent.mHasChildren)
+		{
+			CloseProperties(lParent);
+			lParent.mHasChildren = true;
+		}
+	}
+
+	size_t lNameLength = strlen(pName);
+
+	OpenNode lNode;
+	lNode.mStart = mOffset;
+	lNode.mPropertyCount = 0;
+	lNode.mHasChildren = false;
+	// the SDK expects these to carry a (possibly empty) child list
+	lNode.mAlwaysNested = strcmp(pName, "AnimationStack") == 0 || strcmp(pName, "AnimationLayer") == 0;
+
+	WriteU64(0);	// end offset
+	WriteU64(0);	// property count
+	WriteU64(0);	// property list length
+	WriteU8(uint8_t(lNameLength));
+	Write(pName, lNameLength);
+
+	lNode.mPropertiesStart = mOffset;
+	mNodes.push_back(lNode);
+}
+
+void FbxBinaryWriter::CloseProperties(OpenNode& pNode)
+{
+	PatchU64(pNode.mStart + 8, pNode.mPropertyCount);
+	PatchU64(pNode.mStart + 16, uint64_t(mOffset - pNode.mPropertiesStart));
+}
+
+void FbxBinaryWriter::EndNode()
+{
+	OpenNode& lNode = mNodes.back();
+	if (!lNode.mHasChildren)
+		CloseProperties(lNode);
+
+	if (lNode.mHasChildren || lNode.mPropertyCount == 0 || lNode.mAlwaysNested)
+		WriteNullRecord();
+
+	PatchU64(lNode.mStart, uint64_t(mOffset));
+	mNodes.pop_back();
+}
+
+void FbxBinaryWriter::AddBool(bool pValue)
+{
+	WriteU8('C');
+	WriteU8(pValue ? 1 : 0);
+	mNodes.back().mPropertyCount++;
+}
+
+void FbxBinaryWriter::AddInt32(int32_t pValue)
+{
+	WriteU8('I');
+	Write(&pValue, 4);
+	mNodes.back().mPropertyCount++;
+}
+
+void FbxBinaryWriter::AddInt64(int64_t pValue)
+{
+	WriteU8('L');
+	Write(&pValue, 8);
+	mNodes.back().mPropertyCount++;
+}
+
+void FbxBinaryWriter::AddDouble(double pValue)
+{
+	WriteU8('D');
+	Write(&pValue, 8);
+	mNodes.back().mPropertyCount++;
+}
+
+void FbxBinaryWriter::AddString(const char* pValue)
+{
+	size_t lLength = strlen(pValue);
+	WriteU8('S');
+	WriteU32(uint32_t(lLength));
+	Write(pValue, lLength);
+	mNodes.back().mPropertyCount++;
+}
+
+// Object names contain "\0\1" (name, separator, class), hence the std::string overload.
+void FbxBinaryWriter::AddString(const std::string& pValue)
+{
+	WriteU8('S');
+	WriteU32(uint32_t(pValue.size()));
+	Write(pValue.data(), pValue.size());
+	mNodes.back().mPropertyCount++;
+}
+
+void FbxBinaryWriter::AddRaw(const void* pData, size_t pSize)
+{
+	WriteU8('R');
+	WriteU32(uint32_t(pSize));
+	Write(pData, pSize);
+	mNodes.back().mPropertyCount++;
+}
+
+void FbxBinaryWriter::AddArray(const int32_t* pValues, size_t pCount)
+{
+	BeginArray('i', pCount);
+	AppendArray(pValues, pCount * 4);
+	EndArray();
+}
+
+void FbxBinaryWriter::AddArray(const int64_t* pValues, size_t pCount)
+{
+	BeginArray('l', pCount);
+	AppendArray(pValues, pCount * 8);
+	EndArray();
+}
+
+void FbxBinaryWriter::AddArray(const float* pValues, size_t pCount)
+{
+	BeginArray('f', pCount);
+	AppendArray(pValues, pCount * 4);
+	EndArray();
+}
+
+void FbxBinaryWriter::AddArray(const double* pValues, size_t pCount)
+{
+	BeginArray('d', pCount);
+	AppendArray(pValues, pCount * 8);
+	EndArray();
+}
+
+void FbxBinaryWriter::BeginArray(char pType, size_t pCount)
+{
+	mArrayBytes = pCount * ElementSize(pType);
+	mArrayWritten = 0;
+	mArrayDeflate = mCompress && mArrayBytes >= kMinCompressedBytes;
+
+	WriteU8(uint8_t(pType));
+	WriteU32(uint32_t(pCount));
+	WriteU32(mArrayDeflate ? 1 : 0);	// encoding
+	mArrayStart = mOffset;
+	WriteU32(uint32_t(mArrayBytes));	// stored length, patched when deflating
+
+#ifdef MOTION2FBX_ZLIB
+	if (mArrayDeflate)
+	{
+		if (!mDeflate)
+		{
+			z_stream* lStream = new z_stream;
+			memset(lStream, 0, sizeof(z_stream));
+			// pose curves are noisy floats, higher levels cost 2x the time for 1% smaller files
+			deflateInit(lStream, Z_BEST_SPEED);
+			mDeflate = lStream;
+			mDeflateBuffer.resize(1 << 16);
+		}
+		else
+		{
+			deflateReset(static_cast<z_stream*>(mDeflate));
+		}
+	}
+#endif
+}
+
+void FbxBinaryWriter::AppendArray(const void* pData, size_t pSize)
+{
+	mArrayWritten += pSize;
+
+#ifdef MOTION2FBX_ZLIB
+	if (mArrayDeflate)
+	{
+		z_stream* lStream = static_cast<z_stream*>(mDeflate);
+		lStream->next_in = static_cast<Bytef*>(const_cast<void*>(pData));
+		lStream->avail_in = uInt(pSize);
+		FlushDeflate(false);
+		return;
+	}
+#endif
+
+	Write(pData, pSize);
+}
+
+// Run deflate until all pending input (and, when finishing, all output) is written.
+void FbxBinaryWriter::FlushDeflate(bool pFinish)
+{
+#ifdef MOTION2FBX_ZLIB
+	z_stream* lStream = static_cast<z_stream*>(mDeflate);
+	for (;;)
+	{
+		lStream->next_out = &mDeflateBuffer[0];
+		lStream->avail_out = uInt(mDeflateBuffer.size());
+		int lResult = deflate(lStream, pFinish ? Z_FINISH : Z_NO_FLUSH);
+		Write(&mDeflateBuffer[0], mDeflateBuffer.size() - lStream->avail_out);
+
+		if (pFinish ? lResult == Z_STREAM_END : lStream->avail_out != 0)
+			break;
+		if (lResult == Z_STREAM_ERROR)
+		{
+			mStream.setstate(std::ios::failbit);
+			break;
+		}
+	}
+#else
+	(void)pFinish;
+#endif
+}
+
+void FbxBinaryWriter::EndArray()
+{
+	if (mArrayWritten != mArrayBytes)
+		mStream.setstate(std::ios::failbit);
+
+	if (mArrayDeflate)
+	{
+		FlushDeflate(true);
+		PatchU32(mArrayStart, uint32_t(mOffset - mArrayStart - 4));
+	}
+
+	mNodes.back().mPropertyCount++;
+}
+
+bool FbxBinaryWriter::Finish()
+{
+	while (!mNodes.empty())
+		EndNode();
+
+	WriteNullRecord();
+
+	Write(kFooterId, sizeof(kFooterId));
+	WriteU32(0);
+
+	// pad to a multiple of 16, never with nothing
+	static const char lZeros[128] = { 0 };
+	size_t lPadding = size_t(((mOffset + 15) & ~int64_t(15)) - mOffset);
+	Write(lZeros, lPadding ? lPadding : 16);
+
+	WriteU32(kVersion);
+	Write(lZeros, 120);
+	Write(kFooterMagic, sizeof(kFooterMagic));
+
+	mStream.flush();
+	return !mStream.fail();
+}
@@ -0,0 +1,101 @@
+#ifndef _FBX_BINARY_WRITER_H
+#define _FBX_BINARY_WRITER_H
+
+#include <stdint.h>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// Low level writer for the FBX 7.5 binary format (no FBX SDK involved).
+//
+// A file is a tree of named records. Each record carries a list of typed
+// properties followed by its child records:
+//
+//	lWriter.BeginNode("Model");
+//	lWriter.AddInt64(lId);
+//	lWriter.AddString(...);
+//	lWriter.BeginNode("Version");		// properties of "Model" end here
+//	lWriter.AddInt32(232);
+//	lWriter.EndNode();
+//	lWriter.EndNode();
+//
+// Record sizes are patched in when a record ends, so large arrays can be
+// streamed with BeginArray/AppendArray/EndArray instead of being built in
+// memory first. Arrays are zlib compressed if requested and the writer was
+// built with MOTION2FBX_ZLIB.
+class FbxBinaryWriter
+{
+public:
+	// 64 bit record offsets, read by FBX SDK 2016 and later
+	static const uint32_t kVersion = 7500;
+
+	FbxBinaryWriter(std::ostream& pStream, bool pCompressArrays);
+	~FbxBinaryWriter();
+
+	// True if arrays can be compressed in this build.
+	static bool SupportsCompression();
+
+	void BeginNode(const char* pName);
+	void EndNode();
+
+	void AddBool(bool pValue);
+	void AddInt32(int32_t pValue);
+	void AddInt64(int64_t pValue);
+	void AddDouble(double pValue);
+	void AddString(const char* pValue);
+	void AddString(const std::string& pValue);
+	void AddRaw(const void* pData, size_t pSize);
+
+	void AddArray(const int32_t* pValues, size_t pCount);
+	void AddArray(const int64_t* pValues, size_t pCount);
+	void AddArray(const float* pValues, size_t pCount);
+	void AddArray(const double* pValues, size_t pCount);
+
+	// Array property whose pCount elements of type pType ('i', 'l', 'f' or
+	// 'd') are passed in pieces to AppendArray.
+	void BeginArray(char pType, size_t pCount);
+	void AppendArray(const void* pData, size_t pSize);
+	void EndArray();
+
+	// Close the top level and write the footer. Return false if anything
+	// could not be written.
+	bool Finish();
+
+private:
+	FbxBinaryWriter(const FbxBinaryWriter&);
+	FbxBinaryWriter& operator=(const FbxBinaryWriter&);
+
+	struct OpenNode
+	{
+		int64_t mStart;
+		int64_t mPropertiesStart;
+		uint64_t mPropertyCount;
+		bool mHasChildren;
+		bool mAlwaysNested;
+	};
+
+	void Write(const void* pData, size_t pSize);
+	void WriteU8(uint8_t pValue);
+	void WriteU32(uint32_t pValue);
+	void WriteU64(uint64_t pValue);
+	void PatchU32(int64_t pOffset, uint32_t pValue);
+	void PatchU64(int64_t pOffset, uint64_t pValue);
+	void WriteNullRecord();
+	void CloseProperties(OpenNode& pNode);
+	void FlushDeflate(bool pFinish);
+
+	std::ostream& mStream;
+	int64_t mOffset;
+	bool mCompress;
+	std::vector<OpenNode> mNodes;
+
+	// array in progress
+	int64_t mArrayStart;
+	size_t mArrayBytes;
+	size_t mArrayWritten;
+	bool mArrayDeflate;
+	void* mDeflate;
+	std::vector<unsigned char> mDeflateBuffer;
+};
+
+#endif // #ifndef _FBX_BINARY_WRITER_H
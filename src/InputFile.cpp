@@ -0,0 +1,198 @@
+#include "InputFile.h"
+
+#include <cstdio>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <fcntl.h>
+	#include <io.h>
+#else
+	#include <errno.h>
+	#include <fcntl.h>
+	#include <sys/mman.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+#endif
+
+InputFile::InputFile()
+	: mData(NULL), mSize(0), mMapped(false)
+{
+}
+
+InputFile::~InputFile()
+{
+	Close();
+}
+
+bool InputFile::Open(const char* pFilename)
+{
+	Close();
+
+	if (Map(pFilename))
+		return true;
+
+	// not a regular file (pipe, FIFO, device...), read it in chunks
+	if (ReadAll(pFilename))
+		return true;
+
+	printf("Error: Unable to read input file '%s'\n", pFilename);
+	return false;
+}
+
+void InputFile::Close()
+{
+	if (mMapped && mData)
+	{
+#ifdef _WIN32
+		UnmapViewOfFile(mData);
+#else
+		munmap(const_cast<char*>(mData), mSize);
+#endif
+	}
+
+	std::vector<char>().swap(mBuffer);
+	mData = NULL;
+	mSize = 0;
+	mMapped = false;
+}
+
+#ifdef _WIN32
+
+bool InputFile::Map(const char* pFilename)
+{
+	HANDLE lFile = CreateFileA(pFilename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+		FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (lFile == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER lSize;
+	if (GetFileType(lFile) != FILE_TYPE_DISK || !GetFileSizeEx(lFile, &lSize))
+	{
+		CloseHandle(lFile);
+		return false;
+	}
+
+	if (lSize.QuadPart == 0)
+	{
+		// an empty file cannot be mapped, but it is still a valid (empty) input
+		CloseHandle(lFile);
+		mData = "";
+		return true;
+	}
+
+	HANDLE lMapping = CreateFileMappingA(lFile, NULL, PAGE_READONLY, 0, 0, NULL);
+	CloseHandle(lFile);
+	if (!lMapping)
+		return false;
+
+	const void* lView = MapViewOfFile(lMapping, FILE_MAP_READ, 0, 0, 0);
+	CloseHandle(lMapping);
+	if (!lView)
+		return false;
+
+	mData = static_cast<const char*>(lView);
+	mSize = size_t(lSize.QuadPart);
+	mMapped = true;
+	return true;
+}
+
+bool InputFile::ReadAll(const char* pFilename)
+{
+	int lFd = _open(pFilename, _O_RDONLY | _O_BINARY);
+	if (lFd < 0)
+		return false;
+
+	const size_t lChunk = 1 << 20;
+	size_t lUsed = 0;
+	for (;;)
+	{
+		mBuffer.resize(lUsed + lChunk);
+		int lRead = _read(lFd, &mBuffer[lUsed], unsigned(lChunk));
+		if (lRead < 0)
+		{
+			_close(lFd);
+			std::vector<char>().swap(mBuffer);
+			return false;
+		}
+		if (lRead == 0)
+			break;
+		lUsed += size_t(lRead);
+	}
+	_close(lFd);
+
+	mBuffer.resize(lUsed);
+	mData = mBuffer.empty() ? "" : &mBuffer[0];
+	mSize = lUsed;
+	return true;
+}
+
+#else
+
+bool InputFile::Map(const char* pFilename)
+{
+	int lFd = open(pFilename, O_RDONLY);
+	if (lFd < 0)
+		return false;
+
+	struct stat lStat;
+	if (fstat(lFd, &lStat) != 0 || !S_ISREG(lStat.st_mode))
+	{
+		close(lFd);
+		return false;
+	}
+
+	if (lStat.st_size == 0)
+	{
+		// an empty file cannot be mapped, but it is still a valid (empty) input
+		close(lFd);
+		mData = "";
+		return true;
+	}
+
+	void* lView = mmap(NULL, size_t(lStat.st_size), PROT_READ, MAP_PRIVATE, lFd, 0);
+	close(lFd);
+	if (lView == MAP_FAILED)
+		return false;
+
+	// the parser reads front to back exactly once
+	madvise(lView, size_t(lStat.st_size), MADV_SEQUENTIAL);
+
+	mData = static_cast<const char*>(lView);
+	mSize = size_t(lStat.st_size);
+	mMapped = true;
+	return true;
+}
+
+bool InputFile::ReadAll(const char* pFilename)
+{
+	int lFd = open(pFilename, O_RDONLY);
+	if (lFd < 0)
+		return false;
+
+	const size_t lChunk = 1 << 20;
+	size_t lUsed = 0;
+	for (;;)
+	{
+		mBuffer.resize(lUsed + lChunk);
+		ssize_t lRead = read(lFd, &mBuffer[lUsed], lChunk);
+		if (lRead < 0 && errno == EINTR)
+			continue;
+		if (lRead < 0)
+		{
+			close(lFd);
+			std::vector<char>().swap(mBuffer);
+			return false;
+		}
+		if (lRead == 0)
+			break;
+		lUsed += size_t(lRead);
+	}
+	close(lFd);
+
+	mBuffer.resize(lUsed);
+	mData = mBuffer.empty() ? "" : &mBuffer[0];
+	mSize = lUsed;
+	return true;
+}
+
+#endif
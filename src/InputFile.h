@@ -0,0 +1,38 @@
+#ifndef _INPUT_FILE_H
+#define _INPUT_FILE_H
+
+#include <stddef.h>
+#include <vector>
+
+// Read-only view of a whole input file as one contiguous block of memory.
+// Regular files are memory mapped; anything that cannot be mapped (pipes,
+// character devices) is read into an owned buffer instead.
+class InputFile
+{
+public:
+	InputFile();
+	~InputFile();
+
+	bool Open(const char* pFilename);
+	void Close();
+
+	const char* GetData() const { return mData; }
+	size_t GetSize() const { return mSize; }
+
+	// True if the data is a mapping of the file rather than a copy of it.
+	bool IsMapped() const { return mMapped; }
+
+private:
+	InputFile(const InputFile&);
+	InputFile& operator=(const InputFile&);
+
+	bool Map(const char* pFilename);
+	bool ReadAll(const char* pFilename);
+
+	const char* mData;
+	size_t mSize;
+	bool mMapped;
+	std::vector<char> mBuffer;
+};
+
+#endif // #ifndef _INPUT_FILE_H
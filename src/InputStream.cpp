@@ -0,0 +1,360 @@
+#include "InputStream.h"
+
+#include <cstring>
+
+#ifdef _WIN32
+	#include <fcntl.h>
+	#include <io.h>
+#endif
+
+#ifdef MOTION2FBX_ZLIB
+	#include <zlib.h>
+#endif
+
+#ifdef MOTION2FBX_ZSTD
+	#include <zstd.h>
+#endif
+
+namespace
+{
+	// size of the read buffer and of the decompressed buffer the parser reads from
+	const size_t kBufferBytes = 256 * 1024;
+
+	// most zlib takes in one call, for memory sources larger than a uInt
+	const size_t kMaxZlibInput = size_t(1) << 30;
+}
+
+struct InputStreamBuffer::Decoder
+{
+#ifdef MOTION2FBX_ZLIB
+	z_stream mZlib;
+	bool mZlibReady;
+	bool mMemberEnded;		// a gzip member is complete, another one may follow
+#endif
+#ifdef MOTION2FBX_ZSTD
+	ZSTD_DStream* mZstd;
+	bool mFrameOpen;		// a zstd frame has started and not ended
+#endif
+	bool mPending;			// the last call filled the output, more may be buffered
+
+	Decoder()
+	{
+#ifdef MOTION2FBX_ZLIB
+		memset(&mZlib, 0, sizeof(mZlib));
+		mZlibReady = false;
+		mMemberEnded = false;
+#endif
+#ifdef MOTION2FBX_ZSTD
+		mZstd = NULL;
+		mFrameOpen = false;
+#endif
+		mPending = false;
+	}
+
+	~Decoder()
+	{
+#ifdef MOTION2FBX_ZLIB
+		if (mZlibReady)
+			inflateEnd(&mZlib);
+#endif
+#ifdef MOTION2FBX_ZSTD
+		if (mZstd)
+			ZSTD_freeDStream(mZstd);
+#endif
+	}
+};
+
+ECompression DetectCompression(const char* pData, size_t pSize)
+{
+	const unsigned char* lData = reinterpret_cast<const unsigned char*>(pData);
+	if (pSize >= 2 && lData[0] == 0x1f && lData[1] == 0x8b)
+		return eCompressionGzip;
+	if (pSize >= 4 && lData[0] == 0x28 && lData[1] == 0xb5 && lData[2] == 0x2f && lData[3] == 0xfd)
+		return eCompressionZstd;
+	return eCompressionNone;
+}
+
+const char* GetCompressionName(ECompression pCompression)
+{
+	switch (pCompression)
+	{
+	case eCompressionGzip:
+		return "gzip";
+	case eCompressionZstd:
+		return "zstd";
+	default:
+		return "none";
+	}
+}
+
+InputStreamBuffer::InputStreamBuffer()
+	: mFile(NULL), mOwnsFile(false), mSourceDone(true), mNext(NULL), mEnd(NULL), mDecoder(NULL),
+	mCompression(eCompressionNone), mSourceBytes(0), mDecodedBytes(0), mFailed(false)
+{
+}
+
+InputStreamBuffer::~InputStreamBuffer()
+{
+	Close();
+}
+
+bool InputStreamBuffer::Open(const char* pFilename)
+{
+	Close();
+
+	if (strcmp(pFilename, "-") == 0)
+	{
+#ifdef _WIN32
+		_setmode(_fileno(stdin), _O_BINARY);
+#endif
+		mFile = stdin;
+		mOwnsFile = false;
+	}
+	else
+	{
+		mFile = fopen(pFilename, "rb");
+		if (!mFile)
+		{
+			printf("Error: Unable to read input file '%s'\n", pFilename);
+			return false;
+		}
+		mOwnsFile = true;
+	}
+
+	// the first read brings in the magic bytes
+	mSource.resize(kBufferBytes);
+	mSourceDone = false;
+	FillSource();
+	if (mFailed)
+		return false;
+
+	mCompression = DetectCompression(mNext, size_t(mEnd - mNext));
+	return StartDecoder(pFilename);
+}
+
+bool InputStreamBuffer::Open(const char* pData, size_t pSize)
+{
+	Close();
+
+	mNext = pData;
+	mEnd = pData + pSize;
+	mSourceBytes = pSize;
+	mCompression = DetectCompression(pData, pSize);
+	return StartDecoder("The input");
+}
+
+void InputStreamBuffer::Close()
+{
+	delete mDecoder;
+	mDecoder = NULL;
+
+	if (mFile && mOwnsFile)
+		fclose(mFile);
+	mFile = NULL;
+	mOwnsFile = false;
+	mSourceDone = true;
+
+	mNext = NULL;
+	mEnd = NULL;
+	std::vector<char>().swap(mSource);
+	std::vector<char>().swap(mDecoded);
+	setg(NULL, NULL, NULL);
+
+	mCompression = eCompressionNone;
+	mSourceBytes = 0;
+	mDecodedBytes = 0;
+	mFailed = false;
+}
+
+bool InputStreamBuffer::StartDecoder(const char* pName)
+{
+	if (mCompression == eCompressionNone)
+		return true;
+
+	mDecoder = new Decoder;
+	mDecoded.resize(kBufferBytes);
+
+#ifdef MOTION2FBX_ZLIB
+	if (mCompression == eCompressionGzip)
+	{
+		// 16 + window bits: expect a gzip header rather than a zlib one
+		if (inflateInit2(&mDecoder->mZlib, 16 + MAX_WBITS) != Z_OK)
+		{
+			printf("Error: Unable to start the gzip decompression\n");
+			return false;
+		}
+		mDecoder->mZlibReady = true;
+		return true;
+	}
+#endif
+#ifdef MOTION2FBX_ZSTD
+	if (mCompression == eCompressionZstd)
+	{
+		mDecoder->mZstd = ZSTD_createDStream();
+		if (!mDecoder->mZstd || ZSTD_isError(ZSTD_initDStream(mDecoder->mZstd)))
+		{
+			printf("Error: Unable to start the zstd decompression\n");
+			return false;
+		}
+		return true;
+	}
+#endif
+
+	printf("Error: %s is %s compressed, which this build cannot read (see MOTION2FBX_ZLIB and MOTION2FBX_ZSTD)\n",
+		pName, GetCompressionName(mCompression));
+	return false;
+}
+
+bool InputStreamBuffer::FillSource()
+{
+	if (mNext != mEnd)
+		return true;
+	if (!mFile || mSourceDone)
+		return false;
+
+	size_t lRead = fread(&mSource[0], 1, mSource.size(), mFile);
+	if (lRead == 0)
+	{
+		if (ferror(mFile))
+		{
+			printf("Error: Unable to read the input\n");
+			mFailed = true;
+		}
+		mSourceDone = true;
+		return false;
+	}
+
+	mNext = &mSource[0];
+	mEnd = mNext + lRead;
+	mSourceBytes += lRead;
+	return true;
+}
+
+size_t InputStreamBuffer::Decode(char* pTarget, size_t pSize)
+{
+	if (!mDecoder || mFailed)
+		return 0;
+
+	size_t lProduced = 0;
+	while (lProduced == 0)
+	{
+		// a decoder that filled the output may hold more without needing input
+		if (!FillSource() && !mDecoder->mPending)
+		{
+			bool lComplete = true;
+#ifdef MOTION2FBX_ZLIB
+			if (mCompression == eCompressionGzip)
+				lComplete = mDecoder->mMemberEnded;
+#endif
+#ifdef MOTION2FBX_ZSTD
+			if (mCompression == eCompressionZstd)
+				lComplete = !mDecoder->mFrameOpen;
+#endif
+			if (!lComplete)
+			{
+				printf("Error: The %s data is truncated\n", GetCompressionName(mCompression));
+				mFailed = true;
+			}
+			return 0;
+		}
+
+#ifdef MOTION2FBX_ZLIB
+		if (mCompression == eCompressionGzip)
+		{
+			z_stream& lZlib = mDecoder->mZlib;
+			if (mDecoder->mMemberEnded)
+			{
+				// concatenated gzip members decompress to the concatenation of their data
+				inflateReset(&lZlib);
+				mDecoder->mMemberEnded = false;
+			}
+
+			size_t lAvailable = size_t(mEnd - mNext);
+			if (lAvailable > kMaxZlibInput)
+				lAvailable = kMaxZlibInput;
+			lZlib.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(mNext));
+			lZlib.avail_in = uInt(lAvailable);
+			lZlib.next_out = reinterpret_cast<Bytef*>(pTarget);
+			lZlib.avail_out = uInt(pSize);
+
+			int lStatus = inflate(&lZlib, Z_NO_FLUSH);
+			mNext += lAvailable - lZlib.avail_in;
+			lProduced = pSize - lZlib.avail_out;
+
+			if (lStatus == Z_STREAM_END)
+			{
+				mDecoder->mMemberEnded = true;
+				mDecoder->mPending = false;
+			}
+			else if (lStatus == Z_OK || (lStatus == Z_BUF_ERROR && lProduced == 0))
+			{
+				// Z_BUF_ERROR: nothing buffered, more input is needed
+				mDecoder->mPending = lZlib.avail_out == 0;
+			}
+			else
+			{
+				printf("Error: Unable to decompress the gzip data: %s\n", lZlib.msg ? lZlib.msg : "corrupt data");
+				mFailed = true;
+				return 0;
+			}
+			continue;
+		}
+#endif
+#ifdef MOTION2FBX_ZSTD
+		if (mCompression == eCompressionZstd)
+		{
+			ZSTD_inBuffer lIn = { mNext, size_t(mEnd - mNext), 0 };
+			ZSTD_outBuffer lOut = { pTarget, pSize, 0 };
+			size_t lHint = ZSTD_decompressStream(mDecoder->mZstd, &lOut, &lIn);
+			if (ZSTD_isError(lHint))
+			{
+				printf("Error: Unable to decompress the zstd data: %s\n", ZSTD_getErrorName(lHint));
+				mFailed = true;
+				return 0;
+			}
+			mNext += lIn.pos;
+			lProduced = lOut.pos;
+
+			// the hint is nonzero until a frame is complete and flushed; the
+			// next frame starts on its own
+			mDecoder->mFrameOpen = lHint != 0;
+			mDecoder->mPending = lOut.pos == lOut.size;
+			continue;
+		}
+#endif
+#if !defined(MOTION2FBX_ZLIB) && !defined(MOTION2FBX_ZSTD)
+		(void)pTarget;
+		(void)pSize;
+#endif
+		return 0;
+	}
+	return lProduced;
+}
+
+InputStreamBuffer::int_type InputStreamBuffer::underflow()
+{
+	if (gptr() < egptr())
+		return traits_type::to_int_type(*gptr());
+
+	if (mCompression == eCompressionNone)
+	{
+		// plain data: hand out the read buffer (or the memory) directly
+		if (!FillSource())
+			return traits_type::eof();
+		char* lBegin = const_cast<char*>(mNext);
+		char* lEnd = const_cast<char*>(mEnd);
+		setg(lBegin, lBegin, lEnd);
+		mDecodedBytes += size_t(mEnd - mNext);
+		mNext = mEnd;
+	}
+	else
+	{
+		size_t lSize = Decode(&mDecoded[0], mDecoded.size());
+		if (lSize == 0)
+			return traits_type::eof();
+		setg(&mDecoded[0], &mDecoded[0], &mDecoded[0] + lSize);
+		mDecodedBytes += lSize;
+	}
+
+	return traits_type::to_int_type(*gptr());
+}
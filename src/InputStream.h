@@ -0,0 +1,84 @@
+#ifndef _INPUT_STREAM_H
+#define _INPUT_STREAM_H
+
+#include <stddef.h>
+#include <cstdio>
+#include <streambuf>
+#include <vector>
+
+enum ECompression
+{
+	eCompressionNone,
+	eCompressionGzip,
+	eCompressionZstd
+};
+
+// Recognize gzip and zstd data by the magic bytes at its start.
+ECompression DetectCompression(const char* pData, size_t pSize);
+
+// Name of a compression for messages ("gzip", "zstd", "none").
+const char* GetCompressionName(ECompression pCompression);
+
+// Sequential std::streambuf over a recording that is read once, front to
+// back: a file, stdin ("-") or a block of memory, decompressed on the fly
+// if it starts with a gzip or zstd header. Only one input buffer and one
+// output buffer of fixed size are held, so memory does not grow with the
+// size of the recording; the JSON parser pulls the decompressed bytes
+// straight out of the output buffer. gzip needs a build with
+// MOTION2FBX_ZLIB, zstd a build with MOTION2FBX_ZSTD.
+class InputStreamBuffer : public std::streambuf
+{
+public:
+	InputStreamBuffer();
+	~InputStreamBuffer();
+
+	// Open pFilename ("-" for stdin) and detect its compression.
+	bool Open(const char* pFilename);
+
+	// Read from pData instead of a file; the memory must outlive the reads.
+	bool Open(const char* pData, size_t pSize);
+
+	void Close();
+
+	ECompression GetCompression() const { return mCompression; }
+
+	// Bytes read from the source and bytes handed to the reader so far.
+	size_t GetSourceBytes() const { return mSourceBytes; }
+	size_t GetDecodedBytes() const { return mDecodedBytes; }
+
+	// True if the data ended early or did not decompress. The error has been
+	// printed; the reader only sees the end of the stream.
+	bool Failed() const { return mFailed; }
+
+protected:
+	int_type underflow();
+
+private:
+	struct Decoder;
+
+	InputStreamBuffer(const InputStreamBuffer&);
+	InputStreamBuffer& operator=(const InputStreamBuffer&);
+
+	bool StartDecoder(const char* pName);
+
+	// Make mNext..mEnd non-empty if the source has more bytes.
+	bool FillSource();
+
+	// Decode up to pSize bytes into pTarget. Return 0 at the end of the data.
+	size_t Decode(char* pTarget, size_t pSize);
+
+	FILE* mFile;
+	bool mOwnsFile;
+	bool mSourceDone;
+	const char* mNext;
+	const char* mEnd;
+	std::vector<char> mSource;
+	std::vector<char> mDecoded;
+	Decoder* mDecoder;
+	ECompression mCompression;
+	size_t mSourceBytes;
+	size_t mDecodedBytes;
+	bool mFailed;
+};
+
+#endif // #ifndef _INPUT_STREAM_H
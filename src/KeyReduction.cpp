@@ -0,0 +1,64 @@
+#include "KeyReduction.h"
+
+// Rebuild pCurve with only the keys SimplifyLinear() keeps.
+static void ReduceCurve(FbxAnimCurve* pCurve, double pTolerance, KeyReductionStats& pStats, double& pMaxError)
+{
+	if (!pCurve)
+		return;
+
+	int lCount = pCurve->KeyGetCount();
+	std::vector<FbxTime> lTimes(lCount);
+	std::vector<double> lSeconds(lCount);
+	std::vector<float> lValues(lCount);
+	for (int i = 0; i < lCount; i++)
+	{
+		lTimes[i] = pCurve->KeyGetTime(i);
+		lSeconds[i] = lTimes[i].GetSecondDouble();
+		lValues[i] = pCurve->KeyGetValue(i);
+	}
+
+	std::vector<char> lKeep;
+	double lError = 0.0;
+	size_t lKept = lCount ? SimplifyLinear(&lSeconds[0], &lValues[0], size_t(lCount), pTolerance, lKeep, lError) : 0;
+
+	pStats.mCurves++;
+	pStats.mKeysBefore += size_t(lCount);
+	pStats.mKeysAfter += lKept;
+	if (lError > pMaxError)
+		pMaxError = lError;
+
+	if (lKept == size_t(lCount))
+		return;
+
+	int lLast = 0;
+	pCurve->KeyModifyBegin();
+	pCurve->KeyClear();
+	pCurve->ResizeKeyBuffer(int(lKept));
+	for (int i = 0; i < lCount; i++)
+	{
+		if (!lKeep[i])
+			continue;
+		int lKeyIndex = pCurve->KeyAdd(lTimes[i], &lLast);
+		pCurve->KeySet(lKeyIndex, lTimes[i], lValues[i], FbxAnimCurveDef::eInterpolationLinear);
+	}
+	pCurve->KeyModifyEnd();
+}
+
+void ReduceKeys(FbxNode* pNode, FbxAnimLayer* pAnimLayer,
+	double pTranslationTolerance, double pRotationTolerance, KeyReductionStats& pStats)
+{
+	const char* lComponents[] = { FBXSDK_CURVENODE_COMPONENT_X, FBXSDK_CURVENODE_COMPONENT_Y, FBXSDK_CURVENODE_COMPONENT_Z };
+
+	for (int c = 0; c < 3; c++)
+	{
+		if (pTranslationTolerance > 0.0)
+			ReduceCurve(pNode->LclTranslation.GetCurve(pAnimLayer, lComponents[c]), pTranslationTolerance,
+				pStats, pStats.mMaxTranslationError);
+		if (pRotationTolerance > 0.0)
+			ReduceCurve(pNode->LclRotation.GetCurve(pAnimLayer, lComponents[c]), pRotationTolerance,
+				pStats, pStats.mMaxRotationError);
+	}
+
+	for (int i = 0; i < pNode->GetChildCount(); i++)
+		ReduceKeys(pNode->GetChild(i), pAnimLayer, pTranslationTolerance, pRotationTolerance, pStats);
+}
@@ -0,0 +1,13 @@
+#ifndef _KEY_REDUCTION_H
+#define _KEY_REDUCTION_H
+
+#include <fbxsdk.h>
+
+#include "CurveSimplify.h"
+
+// Reduce the linear translation and rotation curves of pNode and all of its
+// descendants in pAnimLayer. A tolerance of 0 leaves that kind of curve alone.
+void ReduceKeys(FbxNode* pNode, FbxAnimLayer* pAnimLayer,
+	double pTranslationTolerance, double pRotationTolerance, KeyReductionStats& pStats);
+
+#endif // #ifndef _KEY_REDUCTION_H
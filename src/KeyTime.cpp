@@ -0,0 +1,151 @@
+#include "KeyTime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace
+{
+	// Reorder pValues so that element i is the old element pOrder[i].
+	template <typename T>
+	void Permute(std::vector<T>& pValues, const std::vector<size_t>& pOrder)
+	{
+		std::vector<T> lSorted(pOrder.size());
+		for (size_t i = 0; i < pOrder.size(); i++)
+			lSorted[i] = pValues[pOrder[i]];
+		pValues.swap(lSorted);
+	}
+}
+
+int64_t GetTrackStart(const PoseTrack& pTrack)
+{
+	for (size_t i = 0; i < pTrack.Size(); i++)
+	{
+		if (pTrack.mTimestamp[i] != 0)
+			return pTrack.mTimestamp[i];
+	}
+	return 0;
+}
+
+int64_t GetSessionOrigin(const PoseRecording& pRecording)
+{
+	int64_t lOrigin = 0;
+	bool lFound = false;
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+	{
+		int64_t lStart = GetTrackStart(pRecording.mTracks[t]);
+		if (lStart != 0 && (!lFound || lStart < lOrigin))
+		{
+			lOrigin = lStart;
+			lFound = true;
+		}
+	}
+	return lOrigin;
+}
+
+int64_t MicrosecondsToTicks(int64_t pMicroseconds)
+{
+	// whole milliseconds and the rest separately, so long sessions cannot overflow
+	int64_t lMilliseconds = pMicroseconds / kMicrosecondsPerMillisecond;
+	int64_t lRest = pMicroseconds % kMicrosecondsPerMillisecond * kFbxTicksPerMillisecond;
+	int64_t lHalf = lRest < 0 ? -kMicrosecondsPerMillisecond / 2 : kMicrosecondsPerMillisecond / 2;
+	return lMilliseconds * kFbxTicksPerMillisecond + (lRest + lHalf) / kMicrosecondsPerMillisecond;
+}
+
+size_t SortPosesByTime(PoseRecording& pRecording)
+{
+	size_t lSortedTracks = 0;
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+	{
+		PoseTrack& lTrack = pRecording.mTracks[t];
+		const std::vector<int64_t>& lTimestamp = lTrack.mTimestamp;
+		size_t lPoseCount = lTrack.Size();
+
+		size_t lFirst = 0;
+		while (lFirst < lPoseCount && lTimestamp[lFirst] == 0)
+			lFirst++;
+		size_t i = lFirst + 1;
+		while (i < lPoseCount && lTimestamp[i - 1] <= lTimestamp[i])
+			i++;
+		if (i >= lPoseCount)
+			continue;
+
+		std::vector<size_t> lOrder(lPoseCount);
+		for (i = 0; i < lPoseCount; i++)
+			lOrder[i] = i;
+		std::stable_sort(lOrder.begin() + lFirst, lOrder.end(),
+			[&](size_t a, size_t b) { return lTimestamp[a] < lTimestamp[b]; });
+
+		Permute(lTrack.mTimestamp, lOrder);
+		Permute(lTrack.mPositionX, lOrder);
+		Permute(lTrack.mPositionY, lOrder);
+		Permute(lTrack.mPositionZ, lOrder);
+		Permute(lTrack.mRotationX, lOrder);
+		Permute(lTrack.mRotationY, lOrder);
+		Permute(lTrack.mRotationZ, lOrder);
+		lTrack.mKeyTime.clear();
+		lSortedTracks++;
+	}
+	return lSortedTracks;
+}
+
+void BuildKeyTimes(PoseTrack& pTrack, int64_t pOrigin)
+{
+	size_t lPoseCount = pTrack.Size();
+	pTrack.mKeyTime.resize(lPoseCount);
+	if (lPoseCount == 0)
+		return;
+
+	int64_t* lKeyTime = &pTrack.mKeyTime[0];
+	if (pTrack.mFrameRate > 0.0)
+	{
+		// the first frame of the track on the session grid
+		double lFrameRate = pTrack.mFrameRate;
+		double lFirstFrame = std::floor(double(pTrack.mTimestamp[0] - pOrigin) * lFrameRate / double(kMicrosecondsPerMillisecond * 1000) + 0.5);
+		for (size_t i = 0; i < lPoseCount; i++)
+			lKeyTime[i] = int64_t(std::floor((lFirstFrame + double(i)) * double(kFbxTicksPerSecond) / lFrameRate + 0.5));
+		return;
+	}
+
+	const int64_t* lTimestamp = &pTrack.mTimestamp[0];
+	size_t lFirst = 0;
+	while (lFirst + 1 < lPoseCount && lTimestamp[lFirst] == 0)
+		lFirst++;
+
+	// a track that was never stamped has all its keys at 0
+	int64_t lStart = lTimestamp[lFirst] != 0 ? MicrosecondsToTicks(lTimestamp[lFirst] - pOrigin) : 0;
+	for (size_t i = 0; i <= lFirst; i++)
+		lKeyTime[i] = lStart;
+	for (size_t i = lFirst + 1; i < lPoseCount; i++)
+		lKeyTime[i] = MicrosecondsToTicks(lTimestamp[i] - pOrigin);
+}
+
+int64_t BuildTimeline(PoseRecording& pRecording)
+{
+	int64_t lOrigin = GetSessionOrigin(pRecording);
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+		BuildKeyTimes(pRecording.mTracks[t], lOrigin);
+	return lOrigin;
+}
+
+bool CheckKeyTimes(const PoseRecording& pRecording)
+{
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+	{
+		const PoseTrack& lTrack = pRecording.mTracks[t];
+		if (lTrack.mKeyTime.size() != lTrack.Size())
+		{
+			printf("Error: The key times of track '%s' have not been built\n", lTrack.mName.c_str());
+			return false;
+		}
+		for (size_t i = 1; i < lTrack.mKeyTime.size(); i++)
+		{
+			if (lTrack.mKeyTime[i] < lTrack.mKeyTime[i - 1])
+			{
+				printf("Error: The poses of track '%s' are not in time order\n", lTrack.mName.c_str());
+				return false;
+			}
+		}
+	}
+	return true;
+}
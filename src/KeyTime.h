@@ -0,0 +1,45 @@
+#ifndef _KEY_TIME_H
+#define _KEY_TIME_H
+
+#include "PoseBuffer.h"
+
+// FBX time unit (FBXSDK_TC_MILLISECOND / FBXSDK_TC_SECOND), kept here so
+// code that writes FBX without the SDK computes identical key times.
+const int64_t kFbxTicksPerMillisecond = 46186158LL;
+const int64_t kFbxTicksPerSecond = kFbxTicksPerMillisecond * 1000;
+
+// First non-zero timestamp of pTrack (poses that were never stamped read 0),
+// or 0 if it has none.
+int64_t GetTrackStart(const PoseTrack& pTrack);
+
+// Time 0 of the scene: the earliest GetTrackStart() of all tracks, so
+// devices that started late keep their offset to the others.
+int64_t GetSessionOrigin(const PoseRecording& pRecording);
+
+// Microseconds since the origin to FBX ticks, rounded to the nearest tick.
+// Whole milliseconds give exactly FbxTime::SetMilliSeconds().
+int64_t MicrosecondsToTicks(int64_t pMicroseconds);
+
+// Put the poses of every track of pRecording in time order where they are
+// not, the way the FBX SDK inserts keys. The sort is stable, so poses with
+// the same timestamp keep their order, and poses before the first stamped
+// one stay in front. The native writer, SimplifyLinear() and ResampleTrack()
+// all expect increasing times. Return the number of tracks that were sorted.
+size_t SortPosesByTime(PoseRecording& pRecording);
+
+// Fill pTrack.mKeyTime relative to pOrigin. Recorded tracks use their
+// timestamps, poses before the first stamped one share its key. Resampled
+// tracks put their keys on the frames of the grid that starts at pOrigin
+// (see ResampleRecording), so every track lands on whole scene frames.
+void BuildKeyTimes(PoseTrack& pTrack, int64_t pOrigin);
+
+// The timeline stage: the session origin and the key times of every track,
+// computed once for all curve builders. Return the origin.
+int64_t BuildTimeline(PoseRecording& pRecording);
+
+// True if every track of pRecording has its key times (BuildTimeline() has
+// run since the poses last changed) in increasing order (SortPosesByTime()
+// has run before), otherwise print an error.
+bool CheckKeyTimes(const PoseRecording& pRecording);
+
+#endif // #ifndef _KEY_TIME_H
@@ -0,0 +1,193 @@
+#include "MarkerTopology.h"
+#include "DeviceTemplates.h"
+
+#include <cmath>
+
+namespace
+{
+	const double kPi = 3.14159265358979323846;
+	const double kDegrees = 180.0 / kPi;
+
+	struct Matrix3
+	{
+		double m[3][3];
+	};
+
+	Matrix3 Multiply(const Matrix3& a, const Matrix3& b)
+	{
+		Matrix3 r;
+		for (int i = 0; i < 3; i++)
+			for (int j = 0; j < 3; j++)
+				r.m[i][j] = a.m[i][0] * b.m[0][j] + a.m[i][1] * b.m[1][j] + a.m[i][2] * b.m[2][j];
+		return r;
+	}
+
+	// FbxNode::LclRotation with the default eEulerXYZ order: X is applied
+	// first, so the matrix is Rz * Ry * Rx.
+	Matrix3 EulerToMatrix(double pX, double pY, double pZ)
+	{
+		double cx = cos(pX / kDegrees), sx = sin(pX / kDegrees);
+		double cy = cos(pY / kDegrees), sy = sin(pY / kDegrees);
+		double cz = cos(pZ / kDegrees), sz = sin(pZ / kDegrees);
+
+		Matrix3 r;
+		r.m[0][0] = cy * cz;	r.m[0][1] = sx * sy * cz - cx * sz;	r.m[0][2] = cx * sy * cz + sx * sz;
+		r.m[1][0] = cy * sz;	r.m[1][1] = sx * sy * sz + cx * cz;	r.m[1][2] = cx * sy * sz - sx * cz;
+		r.m[2][0] = -sy;		r.m[2][1] = sx * cy;				r.m[2][2] = cx * cy;
+		return r;
+	}
+
+	void MatrixToEuler(const Matrix3& pMatrix, double pEuler[3])
+	{
+		const double (&m)[3][3] = pMatrix.m;
+		double lSinY = -m[2][0];
+		if (lSinY > 1.0)
+			lSinY = 1.0;
+		else if (lSinY < -1.0)
+			lSinY = -1.0;
+
+		pEuler[1] = asin(lSinY) * kDegrees;
+		if (fabs(lSinY) < 1.0 - 1e-9)
+		{
+			pEuler[0] = atan2(m[2][1], m[2][2]) * kDegrees;
+			pEuler[2] = atan2(m[1][0], m[0][0]) * kDegrees;
+		}
+		else
+		{
+			// gimbal lock: only x - z (or x + z) is defined, keep z at 0
+			pEuler[0] = atan2(lSinY * m[0][1], m[1][1]) * kDegrees;
+			pEuler[2] = 0.0;
+		}
+	}
+
+	struct Quaternion
+	{
+		double w, x, y, z;
+	};
+
+	Quaternion Multiply(const Quaternion& a, const Quaternion& b)
+	{
+		Quaternion r;
+		r.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+		r.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+		r.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+		r.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+		return r;
+	}
+
+	// Rotation of pDegrees about axis pAxis (0 = x, 1 = y, 2 = z).
+	Quaternion AxisRotation(double pDegrees, int pAxis)
+	{
+		double lHalf = 0.5 * pDegrees / kDegrees;
+		Quaternion r = { cos(lHalf), 0.0, 0.0, 0.0 };
+		(pAxis == 0 ? r.x : pAxis == 1 ? r.y : r.z) = sin(lHalf);
+		return r;
+	}
+
+	// The rotation of EulerToMatrix() composed from the three axis rotations
+	// instead, so the check does not share its formulas.
+	Quaternion EulerToQuaternion(double pX, double pY, double pZ)
+	{
+		return Multiply(AxisRotation(pZ, 2), Multiply(AxisRotation(pY, 1), AxisRotation(pX, 0)));
+	}
+
+	// Angle of the rotation between a and b, in degrees.
+	double AngleBetween(const Quaternion& a, const Quaternion& b)
+	{
+		Quaternion lConjugate = { a.w, -a.x, -a.y, -a.z };
+		Quaternion d = Multiply(lConjugate, b);
+		return 2.0 * atan2(sqrt(d.x * d.x + d.y * d.y + d.z * d.z), fabs(d.w)) * kDegrees;
+	}
+
+	// The value of pAngle plus a multiple of 360 closest to pNear.
+	double Unwrap(double pAngle, double pNear)
+	{
+		return pAngle + 360.0 * floor((pNear - pAngle) / 360.0 + 0.5);
+	}
+
+	// Of the two XYZ Euler triples of the same rotation, the one that, after
+	// unwrapping, is closest to pPrevious.
+	void ContinueEuler(const double pEuler[3], const double pPrevious[3], double pResult[3])
+	{
+		const double lAlternative[3] = { pEuler[0] + 180.0, 180.0 - pEuler[1], pEuler[2] + 180.0 };
+
+		double lOther[3];
+		double lDistance = 0.0;
+		double lOtherDistance = 0.0;
+		for (int i = 0; i < 3; i++)
+		{
+			pResult[i] = Unwrap(pEuler[i], pPrevious[i]);
+			lOther[i] = Unwrap(lAlternative[i], pPrevious[i]);
+			lDistance += fabs(pResult[i] - pPrevious[i]);
+			lOtherDistance += fabs(lOther[i] - pPrevious[i]);
+		}
+
+		if (lOtherDistance < lDistance)
+		{
+			for (int i = 0; i < 3; i++)
+				pResult[i] = lOther[i];
+		}
+	}
+
+	void CollapseTrack(PoseTrack& pTrack, const double pMarkerRotation[3], TopologyCheck* pCheck)
+	{
+		Matrix3 lMarker = EulerToMatrix(pMarkerRotation[0], pMarkerRotation[1], pMarkerRotation[2]);
+		Quaternion lMarkerQuaternion = EulerToQuaternion(pMarkerRotation[0], pMarkerRotation[1], pMarkerRotation[2]);
+
+		double lPrevious[3] = { 0.0, 0.0, 0.0 };
+		for (size_t i = 0; i < pTrack.Size(); i++)
+		{
+			double lRecorded[3] = { pTrack.mRotationX[i], pTrack.mRotationY[i], pTrack.mRotationZ[i] };
+			Matrix3 lWorld = Multiply(lMarker, EulerToMatrix(lRecorded[0], lRecorded[1], lRecorded[2]));
+
+			double lEuler[3];
+			double lCollapsed[3];
+			MatrixToEuler(lWorld, lEuler);
+			if (i == 0)
+			{
+				// start near the recorded angles, like the pair does
+				for (int c = 0; c < 3; c++)
+					lPrevious[c] = lRecorded[c];
+			}
+			ContinueEuler(lEuler, lPrevious, lCollapsed);
+
+			pTrack.mRotationX[i] = float(lCollapsed[0]);
+			pTrack.mRotationY[i] = float(lCollapsed[1]);
+			pTrack.mRotationZ[i] = float(lCollapsed[2]);
+			for (int c = 0; c < 3; c++)
+				lPrevious[c] = lCollapsed[c];
+
+			if (pCheck)
+			{
+				// marker pair: Rm * R(recorded), single node: R(stored)
+				Quaternion lPair = Multiply(lMarkerQuaternion, EulerToQuaternion(lRecorded[0], lRecorded[1], lRecorded[2]));
+				Quaternion lSingle = EulerToQuaternion(pTrack.mRotationX[i], pTrack.mRotationY[i], pTrack.mRotationZ[i]);
+				double lError = AngleBetween(lPair, lSingle);
+				if (lError > pCheck->mMaxRotationError)
+					pCheck->mMaxRotationError = lError;
+			}
+		}
+
+		if (pCheck)
+		{
+			pCheck->mPoses += pTrack.Size();
+			pCheck->mDevices++;
+		}
+	}
+}
+
+TopologyCheck::TopologyCheck()
+	: mPoses(0), mDevices(0), mMaxRotationError(0.0)
+{
+}
+
+void CollapseMarkerRotations(PoseRecording& pRecording, TopologyCheck* pCheck)
+{
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+	{
+		PoseTrack& lTrack = pRecording.mTracks[t];
+		const double* lRotation = GetDeviceTemplate(lTrack.mName).mMarkerRotation;
+		if (lRotation[0] != 0.0 || lRotation[1] != 0.0 || lRotation[2] != 0.0)
+			CollapseTrack(lTrack, lRotation, pCheck);
+	}
+}
@@ -0,0 +1,33 @@
+#ifndef _MARKER_TOPOLOGY_H
+#define _MARKER_TOPOLOGY_H
+
+#include "PoseBuffer.h"
+
+#include <stdint.h>
+
+// Result of checking the collapsed rotations against the marker pairs.
+struct TopologyCheck
+{
+	uint64_t mPoses;			// poses whose rotation was rewritten
+	int mDevices;
+	double mMaxRotationError;	// degrees between the world rotations of both topologies
+
+	TopologyCheck();
+};
+
+// Largest difference TopologyCheck accepts, in degrees: the float rounding
+// of the rewritten angles.
+const double kTopologyTolerance = 1e-3;
+
+// Prepare pRecording for eTopologySingleNode. A device whose position marker
+// has a fixed rotation Rm (see DeviceTemplate) ends up with the world
+// rotation Rm * R(pose) in the marker pairs; its rotations are rewritten as
+// that product in XYZ Euler degrees, each pose continuing the previous one
+// without 360 degree jumps, so a single node with the recorded translation
+// and the new rotation has the same world transform. Translations are not
+// touched. If pCheck is not NULL, the world rotation of every rewritten pose
+// is rebuilt from the stored (float) angles with quaternions, not with the
+// matrices that produced them, and compared with the pair.
+void CollapseMarkerRotations(PoseRecording& pRecording, TopologyCheck* pCheck);
+
+#endif // #ifndef _MARKER_TOPOLOGY_H
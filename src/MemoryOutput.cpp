@@ -0,0 +1,163 @@
+#include "MemoryOutput.h"
+
+#include <cstring>
+
+MemoryOutput::MemoryOutput(std::vector<char>& pBuffer)
+	: mBuffer(pBuffer), mPosition(0)
+{
+}
+
+void MemoryOutput::Write(const void* pData, size_t pSize)
+{
+	// a seek past the end leaves a gap of zeros, as in a file
+	if (mPosition > mBuffer.size())
+		mBuffer.resize(mPosition);
+
+	const char* lData = static_cast<const char*>(pData);
+	size_t lOverwrite = mBuffer.size() - mPosition;
+	if (lOverwrite > pSize)
+		lOverwrite = pSize;
+	if (lOverwrite)
+		memcpy(&mBuffer[mPosition], lData, lOverwrite);
+	mBuffer.insert(mBuffer.end(), lData + lOverwrite, lData + pSize);
+	mPosition += pSize;
+}
+
+void MemoryOutput::Reset()
+{
+	mBuffer.clear();
+	mPosition = 0;
+}
+
+MemoryStreamBuffer::MemoryStreamBuffer(std::vector<char>& pBuffer)
+	: mOutput(pBuffer)
+{
+	mOutput.Reset();
+}
+
+std::streamsize MemoryStreamBuffer::xsputn(const char* pData, std::streamsize pSize)
+{
+	mOutput.Write(pData, size_t(pSize));
+	return pSize;
+}
+
+MemoryStreamBuffer::int_type MemoryStreamBuffer::overflow(int_type pCharacter)
+{
+	if (!traits_type::eq_int_type(pCharacter, traits_type::eof()))
+	{
+		char lCharacter = traits_type::to_char_type(pCharacter);
+		mOutput.Write(&lCharacter, 1);
+	}
+	return traits_type::not_eof(pCharacter);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekoff(off_type pOffset, std::ios_base::seekdir pDirection,
+	std::ios_base::openmode pMode)
+{
+	if (!(pMode & std::ios_base::out))
+		return pos_type(off_type(-1));
+
+	off_type lBase = 0;
+	if (pDirection == std::ios_base::cur)
+		lBase = off_type(mOutput.GetPosition());
+	else if (pDirection == std::ios_base::end)
+		lBase = off_type(mOutput.GetSize());
+
+	off_type lPosition = lBase + pOffset;
+	if (lPosition < 0)
+		return pos_type(off_type(-1));
+	mOutput.SetPosition(size_t(lPosition));
+	return pos_type(lPosition);
+}
+
+MemoryStreamBuffer::pos_type MemoryStreamBuffer::seekpos(pos_type pPosition, std::ios_base::openmode pMode)
+{
+	return seekoff(off_type(pPosition), std::ios_base::beg, pMode);
+}
+
+#ifndef MOTION2FBX_NO_FBXSDK
+
+FbxMemoryStream::FbxMemoryStream(std::vector<char>& pBuffer, int pWriterId)
+	: mOutput(pBuffer), mWriterId(pWriterId), mOpen(false)
+{
+}
+
+FbxStream::EState FbxMemoryStream::GetState()
+{
+	return mOpen ? eOpen : eClosed;
+}
+
+bool FbxMemoryStream::Open(void*)
+{
+	// the exporter may open the stream more than once; every export starts over
+	mOutput.Reset();
+	mOpen = true;
+	return true;
+}
+
+bool FbxMemoryStream::Close()
+{
+	mOpen = false;
+	return true;
+}
+
+bool FbxMemoryStream::Flush()
+{
+	return true;
+}
+
+int FbxMemoryStream::Write(const void* pData, int pSize)
+{
+	if (!mOpen || pSize <= 0)
+		return 0;
+	mOutput.Write(pData, size_t(pSize));
+	return pSize;
+}
+
+int FbxMemoryStream::Read(void*, int) const
+{
+	return 0;
+}
+
+int FbxMemoryStream::GetReaderID() const
+{
+	return -1;
+}
+
+int FbxMemoryStream::GetWriterID() const
+{
+	return mWriterId;
+}
+
+void FbxMemoryStream::Seek(const FbxInt64& pOffset, const FbxFile::ESeekPos& pSeekPos)
+{
+	FbxInt64 lBase = 0;
+	if (pSeekPos == FbxFile::eCurrent)
+		lBase = FbxInt64(mOutput.GetPosition());
+	else if (pSeekPos == FbxFile::eEnd)
+		lBase = FbxInt64(mOutput.GetSize());
+
+	FbxInt64 lPosition = lBase + pOffset;
+	mOutput.SetPosition(lPosition > 0 ? size_t(lPosition) : 0);
+}
+
+long FbxMemoryStream::GetPosition() const
+{
+	return long(mOutput.GetPosition());
+}
+
+void FbxMemoryStream::SetPosition(long pPosition)
+{
+	mOutput.SetPosition(pPosition > 0 ? size_t(pPosition) : 0);
+}
+
+int FbxMemoryStream::GetError() const
+{
+	return 0;
+}
+
+void FbxMemoryStream::ClearError()
+{
+}
+
+#endif // #ifndef MOTION2FBX_NO_FBXSDK
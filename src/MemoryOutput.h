@@ -0,0 +1,83 @@
+#ifndef _MEMORY_OUTPUT_H
+#define _MEMORY_OUTPUT_H
+
+#include <stddef.h>
+#include <streambuf>
+#include <vector>
+
+#ifndef MOTION2FBX_NO_FBXSDK
+	#include <fbxsdk.h>
+#endif
+
+// Seekable writer into a growable byte buffer. Both FBX writers seek back to
+// patch record sizes, so writing past the end appends and writing before it
+// overwrites.
+class MemoryOutput
+{
+public:
+	explicit MemoryOutput(std::vector<char>& pBuffer);
+
+	void Write(const void* pData, size_t pSize);
+
+	size_t GetPosition() const { return mPosition; }
+	void SetPosition(size_t pPosition) { mPosition = pPosition; }
+	size_t GetSize() const { return mBuffer.size(); }
+
+	// Empty the buffer and start at the beginning.
+	void Reset();
+
+private:
+	std::vector<char>& mBuffer;
+	size_t mPosition;
+};
+
+// std::streambuf over a MemoryOutput, for the native writer (FbxBinaryWriter
+// takes a std::ostream).
+class MemoryStreamBuffer : public std::streambuf
+{
+public:
+	explicit MemoryStreamBuffer(std::vector<char>& pBuffer);
+
+protected:
+	std::streamsize xsputn(const char* pData, std::streamsize pSize);
+	int_type overflow(int_type pCharacter);
+	pos_type seekoff(off_type pOffset, std::ios_base::seekdir pDirection, std::ios_base::openmode pMode);
+	pos_type seekpos(pos_type pPosition, std::ios_base::openmode pMode);
+
+private:
+	MemoryOutput mOutput;
+};
+
+#ifndef MOTION2FBX_NO_FBXSDK
+
+// FbxStream over a MemoryOutput, for FbxExporter::Initialize(FbxStream*, ...).
+// pWriterId is the writer format the exporter is initialized with. Write
+// only: the stream cannot be imported from.
+class FbxMemoryStream : public FbxStream
+{
+public:
+	FbxMemoryStream(std::vector<char>& pBuffer, int pWriterId);
+
+	EState GetState();
+	bool Open(void* pStreamData);
+	bool Close();
+	bool Flush();
+	int Write(const void* pData, int pSize);
+	int Read(void* pData, int pSize) const;
+	int GetReaderID() const;
+	int GetWriterID() const;
+	void Seek(const FbxInt64& pOffset, const FbxFile::ESeekPos& pSeekPos);
+	long GetPosition() const;
+	void SetPosition(long pPosition);
+	int GetError() const;
+	void ClearError();
+
+private:
+	MemoryOutput mOutput;
+	int mWriterId;
+	bool mOpen;
+};
+
+#endif // #ifndef MOTION2FBX_NO_FBXSDK
+
+#endif // #ifndef _MEMORY_OUTPUT_H
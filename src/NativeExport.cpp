@@ -0,0 +1,929 @@
+#include "NativeExport.h"
+#include "ConversionOptions.h"
+#include "DeviceTemplates.h"
+#include "FbxBinaryWriter.h"
+#include "KeyTime.h"
+#include "Trace.h"
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+namespace
+{
+	// must match the footer written by FbxBinaryWriter
+	const unsigned char kFileId[16] = { 0x28, 0xb3, 0x2a, 0xeb, 0xb6, 0x24, 0xcc, 0xc2, 0xbf, 0xc8, 0xb0, 0x2a, 0xa9, 0x2b, 0xfc, 0xf1 };
+	const char kCreationTime[] = "1970-01-01 10:00:00:000";
+	// CreationTimeStamp, the same date as kCreationTime: the wall clock would
+	// make the same input give a different file on every run
+	const int kCreationYear = 1970;
+	const int kCreationMonth = 1;
+	const int kCreationDay = 1;
+	const int kCreationHour = 10;
+	const char kCreator[] = "motion2fbx";
+
+	const char kStackName[] = "Stack001";
+	const int64_t kRootId = 0;
+
+	// FbxTime::EMode
+	const int kTimeModeDefault = 0;
+	const int kTimeModeCustom = 14;
+
+	// FbxAnimCurveDef::eInterpolationLinear | eTangentAuto, and the key data
+	// KeySet() stores for it: no slopes, default weights (0.3333 each)
+	const int32_t kLinearKeyFlags = 0x00000104;
+	const uint32_t kDefaultKeyWeights = 0x0D050D05;
+
+	const char* kComponentNames[] = { "d|X", "d|Y", "d|Z" };
+
+	enum ENodeType
+	{
+		eMarker,
+		eMesh,
+		eCamera
+	};
+
+	struct Model
+	{
+		int64_t mId;
+		int64_t mParent;
+		int64_t mAttribute;
+		std::string mName;
+		ENodeType mType;
+		double mTranslation[3];
+		double mRotation[3];
+		double mScaling[3];
+	};
+
+	// Pyramid mesh shared by every mesh node of the same shape.
+	struct Geometry
+	{
+		int64_t mId;
+		std::string mName;
+		double mSide;
+		double mHeight;
+		bool mRightHand;
+	};
+
+	// Curve node holding the translation or rotation curves of a device.
+	struct CurveNode
+	{
+		int64_t mId;
+		size_t mModel;
+		bool mRotation;
+		const PoseTrack* mTrack;
+		int64_t mCurves[3];
+	};
+
+	// Name property of an object: name and class separated by "\0\1".
+	std::string ObjectName(const std::string& pName, const char* pClass)
+	{
+		std::string lName(pName);
+		lName += '\0';
+		lName += '\1';
+		lName += pClass;
+		return lName;
+	}
+
+	int TimeModeForFrameRate(double pFrameRate)
+	{
+		// FbxTime::EMode values of the standard rates
+		static const struct { double mRate; int mMode; } lModes[] = {
+			{ 120.0, 1 }, { 100.0, 2 }, { 60.0, 3 }, { 50.0, 4 }, { 48.0, 5 }, { 30.0, 6 },
+			{ 25.0, 10 }, { 24.0, 11 }, { 1000.0, 12 }, { 96.0, 15 }, { 72.0, 16 }, { 59.94, 17 }
+		};
+		for (size_t i = 0; i < sizeof(lModes) / sizeof(lModes[0]); i++)
+		{
+			if (fabs(lModes[i].mRate - pFrameRate) < 1e-6)
+				return lModes[i].mMode;
+		}
+		return kTimeModeCustom;
+	}
+
+	class NativeScene
+	{
+	public:
+		NativeScene(const PoseRecording& pRecording, const ConversionOptions& pOptions,
+			KeyReductionStats& pReduction, ConversionStats& pStats);
+
+		void Write(FbxBinaryWriter& pWriter);
+
+	private:
+		int64_t NewId() { return mNextId++; }
+
+		size_t AddModel(const char* pName, ENodeType pType, int64_t pParent);
+		size_t AddMarker(const char* pName, int64_t pParent, double pX, double pY, double pZ);
+		size_t AddPyramid(const char* pName, int64_t pParent, double pSide, double pHeight, bool pRightHand);
+		void AddCurves(size_t pPosition, size_t pRotation, const PoseTrack& pTrack);
+		void Move(size_t pModel, double pX, double pY, double pZ);
+		void Rotate(size_t pModel, double pX, double pY, double pZ);
+
+		void WriteHeader(FbxBinaryWriter& pWriter);
+		void WriteGlobalSettings(FbxBinaryWriter& pWriter);
+		void WriteDefinitions(FbxBinaryWriter& pWriter);
+		void WriteModel(FbxBinaryWriter& pWriter, const Model& pModel);
+		void WriteGeometry(FbxBinaryWriter& pWriter, const Geometry& pGeometry);
+		void WriteMaterials(FbxBinaryWriter& pWriter);
+		void WriteCurveNode(FbxBinaryWriter& pWriter, const CurveNode& pNode);
+		void WriteConnections(FbxBinaryWriter& pWriter);
+
+		const ConversionOptions& mOptions;
+		KeyReductionStats& mReduction;
+		ConversionStats& mStats;
+		int64_t mNextId;
+
+		std::vector<Model> mModels;
+		std::vector<Geometry> mGeometries;
+		int64_t mMaterials[5];		// shared by all mesh nodes, 0 until the first one
+		std::vector<CurveNode> mCurveNodes;
+		int64_t mStackId;
+		int64_t mLayerId;
+		int64_t mDocumentId;
+		int64_t mStop;
+		size_t mMeshCount;
+		size_t mCurveCount;
+		bool mHasCamera;
+	};
+
+	// Properties70 entries: name, type, label, flags and the value(s).
+	void BeginProperty(FbxBinaryWriter& pWriter, const char* pName, const char* pType, const char* pLabel, const char* pFlags)
+	{
+		pWriter.BeginNode("P");
+		pWriter.AddString(pName);
+		pWriter.AddString(pType);
+		pWriter.AddString(pLabel);
+		pWriter.AddString(pFlags);
+	}
+
+	void PropertyInt(FbxBinaryWriter& pWriter, const char* pName, const char* pType, int32_t pValue)
+	{
+		BeginProperty(pWriter, pName, pType, pType[0] == 'i' ? "Integer" : "", "");
+		pWriter.AddInt32(pValue);
+		pWriter.EndNode();
+	}
+
+	void PropertyDouble(FbxBinaryWriter& pWriter, const char* pName, const char* pType, const char* pLabel, const char* pFlags, double pValue)
+	{
+		BeginProperty(pWriter, pName, pType, pLabel, pFlags);
+		pWriter.AddDouble(pValue);
+		pWriter.EndNode();
+	}
+
+	void PropertyDouble3(FbxBinaryWriter& pWriter, const char* pName, const char* pType, const char* pLabel, const char* pFlags, const double* pValue)
+	{
+		BeginProperty(pWriter, pName, pType, pLabel, pFlags);
+		pWriter.AddDouble(pValue[0]);
+		pWriter.AddDouble(pValue[1]);
+		pWriter.AddDouble(pValue[2]);
+		pWriter.EndNode();
+	}
+
+	void PropertyTime(FbxBinaryWriter& pWriter, const char* pName, int64_t pValue)
+	{
+		BeginProperty(pWriter, pName, "KTime", "Time", "");
+		pWriter.AddInt64(pValue);
+		pWriter.EndNode();
+	}
+
+	void PropertyString(FbxBinaryWriter& pWriter, const char* pName, const char* pValue)
+	{
+		BeginProperty(pWriter, pName, "KString", "", "");
+		pWriter.AddString(pValue);
+		pWriter.EndNode();
+	}
+
+	void WriteInt32(FbxBinaryWriter& pWriter, const char* pName, int32_t pValue)
+	{
+		pWriter.BeginNode(pName);
+		pWriter.AddInt32(pValue);
+		pWriter.EndNode();
+	}
+
+	void WriteString(FbxBinaryWriter& pWriter, const char* pName, const char* pValue)
+	{
+		pWriter.BeginNode(pName);
+		pWriter.AddString(pValue);
+		pWriter.EndNode();
+	}
+
+	NativeScene::NativeScene(const PoseRecording& pRecording, const ConversionOptions& pOptions,
+		KeyReductionStats& pReduction, ConversionStats& pStats)
+		: mOptions(pOptions), mReduction(pReduction), mStats(pStats), mNextId(1000000), mStop(0), mMeshCount(0), mCurveCount(0), mHasCamera(false)
+	{
+		for (int m = 0; m < 5; m++)
+			mMaterials[m] = 0;
+
+		StageTimer lTimer(mStats, eStageScene);
+		std::vector<SceneDevice> lDevices;
+		GetSceneDevices(pRecording, lDevices);
+
+		// same hierarchy, names and default transforms as CreateScene()
+		size_t lRoot = AddMarker("Root", kRootId, 0, 0, 0);
+		int64_t lRootId = mModels[lRoot].mId;
+
+		std::vector<size_t> lPositions(lDevices.size());
+		std::vector<size_t> lRotations(lDevices.size());
+		for (size_t i = 0; i < lDevices.size(); i++)
+		{
+			const SceneDevice& lDevice = lDevices[i];
+			const DeviceTemplate& lTemplate = *lDevice.mTemplate;
+
+			const double* lMarker = lTemplate.mMarkerRotation;
+			size_t lPosition;
+			size_t lRotation;
+			if (mOptions.mTopology == eTopologySingleNode)
+			{
+				// the rotations have been through CollapseMarkerRotations()
+				lPosition = lRotation = AddMarker((lDevice.mName + "Animation").c_str(), lRootId, lMarker[0], lMarker[1], lMarker[2]);
+			}
+			else
+			{
+				lPosition = AddMarker((lDevice.mName + "PositionAnimation").c_str(), lRootId, lMarker[0], lMarker[1], lMarker[2]);
+				lRotation = AddMarker((lDevice.mName + "RotationAnimation").c_str(), mModels[lPosition].mId, 0, 0, 0);
+			}
+			lPositions[i] = lPosition;
+			lRotations[i] = lRotation;
+
+			if (mOptions.mAnimationOnly)
+				continue;
+
+			if (lTemplate.mCamera && !mHasCamera)
+			{
+				size_t lCamera = AddModel("Camera", eCamera, mModels[lRotation].mId);
+				Rotate(lCamera, 0, 90, 0);
+				mModels[lCamera].mScaling[0] = mModels[lCamera].mScaling[1] = mModels[lCamera].mScaling[2] = 100.0;
+				mHasCamera = true;
+			}
+
+			size_t lMesh = AddPyramid(("Mesh" + lDevice.mName).c_str(), mModels[lRotation].mId,
+				lTemplate.mMeshSide, lTemplate.mMeshHeight, lTemplate.mMeshApexDown);
+			Move(lMesh, lTemplate.mMeshTranslation[0], lTemplate.mMeshTranslation[1], lTemplate.mMeshTranslation[2]);
+			Rotate(lMesh, lTemplate.mMeshRotation[0], lTemplate.mMeshRotation[1], lTemplate.mMeshRotation[2]);
+		}
+
+		mDocumentId = NewId();
+		mStackId = NewId();
+		mLayerId = NewId();
+
+		for (size_t i = 0; i < lDevices.size(); i++)
+			AddCurves(lPositions[i], lRotations[i], *lDevices[i].mTrack);
+	}
+
+	size_t NativeScene::AddModel(const char* pName, ENodeType pType, int64_t pParent)
+	{
+		Model lModel;
+		lModel.mId = NewId();
+		lModel.mParent = pParent;
+		lModel.mAttribute = pType == eMesh ? 0 : NewId();
+		lModel.mName = pName;
+		lModel.mType = pType;
+		for (int c = 0; c < 3; c++)
+		{
+			lModel.mTranslation[c] = 0.0;
+			lModel.mRotation[c] = 0.0;
+			lModel.mScaling[c] = 1.0;
+		}
+
+		mModels.push_back(lModel);
+		return mModels.size() - 1;
+	}
+
+	// Markers are placed with SetMarkerDefaultPosition(), which sets the rotation.
+	size_t NativeScene::AddMarker(const char* pName, int64_t pParent, double pX, double pY, double pZ)
+	{
+		size_t lIndex = AddModel(pName, eMarker, pParent);
+		Rotate(lIndex, pX, pY, pZ);
+		return lIndex;
+	}
+
+	size_t NativeScene::AddPyramid(const char* pName, int64_t pParent, double pSide, double pHeight, bool pRightHand)
+	{
+		size_t lIndex = AddModel(pName, eMesh, pParent);
+		mMeshCount++;
+
+		// same instancing as MeshRegistry: one geometry per shape, named after
+		// its first node, and one set of materials
+		int64_t lGeometry = 0;
+		for (size_t i = 0; i < mGeometries.size() && !lGeometry; i++)
+		{
+			const Geometry& lShape = mGeometries[i];
+			if (lShape.mSide == pSide && lShape.mHeight == pHeight && lShape.mRightHand == pRightHand)
+				lGeometry = lShape.mId;
+		}
+		if (!lGeometry)
+		{
+			Geometry lShape;
+			lShape.mId = lGeometry = NewId();
+			lShape.mName = pName;
+			lShape.mSide = pSide;
+			lShape.mHeight = pHeight;
+			lShape.mRightHand = pRightHand;
+			mGeometries.push_back(lShape);
+		}
+		mModels[lIndex].mAttribute = lGeometry;
+
+		if (!mMaterials[0])
+			for (int m = 0; m < 5; m++)
+				mMaterials[m] = NewId();
+		return lIndex;
+	}
+
+	void NativeScene::Move(size_t pModel, double pX, double pY, double pZ)
+	{
+		mModels[pModel].mTranslation[0] = pX;
+		mModels[pModel].mTranslation[1] = pY;
+		mModels[pModel].mTranslation[2] = pZ;
+	}
+
+	void NativeScene::Rotate(size_t pModel, double pX, double pY, double pZ)
+	{
+		mModels[pModel].mRotation[0] = pX;
+		mModels[pModel].mRotation[1] = pY;
+		mModels[pModel].mRotation[2] = pZ;
+	}
+
+	void NativeScene::AddCurves(size_t pPosition, size_t pRotation, const PoseTrack& pTrack)
+	{
+		for (int r = 0; r < 2; r++)
+		{
+			CurveNode lNode;
+			lNode.mId = NewId();
+			lNode.mModel = r ? pRotation : pPosition;
+			lNode.mRotation = r != 0;
+			lNode.mTrack = &pTrack;
+			for (int c = 0; c < 3; c++)
+				lNode.mCurves[c] = pTrack.Size() ? NewId() : 0;
+			mCurveNodes.push_back(lNode);
+
+			// as in AnimateTrack(), an empty track leaves the curve node without curves
+			if (pTrack.Size())
+				mCurveCount += 3;
+		}
+
+		if (pTrack.Size() && pTrack.mKeyTime.back() > mStop)
+			mStop = pTrack.mKeyTime.back();
+	}
+
+	void NativeScene::Write(FbxBinaryWriter& pWriter)
+	{
+		WriteHeader(pWriter);
+		WriteGlobalSettings(pWriter);
+
+		pWriter.BeginNode("Documents");
+		WriteInt32(pWriter, "Count", 1);
+		pWriter.BeginNode("Document");
+		pWriter.AddInt64(mDocumentId);
+		pWriter.AddString("");
+		pWriter.AddString("Scene");
+		pWriter.BeginNode("Properties70");
+		BeginProperty(pWriter, "SourceObject", "object", "", "");
+		pWriter.EndNode();
+		PropertyString(pWriter, "ActiveAnimStackName", kStackName);
+		pWriter.EndNode();
+		pWriter.BeginNode("RootNode");
+		pWriter.AddInt64(kRootId);
+		pWriter.EndNode();
+		pWriter.EndNode();
+		pWriter.EndNode();
+
+		pWriter.BeginNode("References");
+		pWriter.EndNode();
+
+		WriteDefinitions(pWriter);
+
+		pWriter.BeginNode("Objects");
+		for (size_t i = 0; i < mGeometries.size(); i++)
+			WriteGeometry(pWriter, mGeometries[i]);
+		if (mMeshCount)
+			WriteMaterials(pWriter);
+		for (size_t i = 0; i < mModels.size(); i++)
+		{
+			const Model& lModel = mModels[i];
+			if (lModel.mType != eMesh)
+			{
+				pWriter.BeginNode("NodeAttribute");
+				pWriter.AddInt64(lModel.mAttribute);
+				pWriter.AddString(ObjectName(lModel.mName, "NodeAttribute"));
+				pWriter.AddString(lModel.mType == eCamera ? "Camera" : "Marker");
+				if (lModel.mType == eCamera)
+				{
+					// FbxCamera::SetFormat(FbxCamera::eHD)
+					pWriter.BeginNode("Properties70");
+					PropertyInt(pWriter, "AspectRatioMode", "enum", 2);
+					PropertyDouble(pWriter, "AspectWidth", "double", "Number", "", 1920.0);
+					PropertyDouble(pWriter, "AspectHeight", "double", "Number", "", 1080.0);
+					PropertyDouble(pWriter, "PixelAspectRatio", "double", "Number", "", 1.0);
+					pWriter.EndNode();
+					WriteString(pWriter, "TypeFlags", "Camera");
+					WriteInt32(pWriter, "GeometryVersion", 124);
+				}
+				else
+				{
+					WriteString(pWriter, "TypeFlags", "Marker");
+				}
+				pWriter.EndNode();
+			}
+			WriteModel(pWriter, lModel);
+		}
+
+		pWriter.BeginNode("AnimationStack");
+		pWriter.AddInt64(mStackId);
+		pWriter.AddString(ObjectName(kStackName, "AnimStack"));
+		pWriter.AddString("");
+		pWriter.BeginNode("Properties70");
+		PropertyString(pWriter, "Description", "This is the animation stack description field.");
+		PropertyTime(pWriter, "LocalStop", 3600 * kFbxTicksPerSecond);
+		pWriter.EndNode();
+		pWriter.EndNode();
+
+		pWriter.BeginNode("AnimationLayer");
+		pWriter.AddInt64(mLayerId);
+		pWriter.AddString(ObjectName("Base Layer", "AnimLayer"));
+		pWriter.AddString("");
+		pWriter.EndNode();
+
+		for (size_t i = 0; i < mCurveNodes.size(); i++)
+			WriteCurveNode(pWriter, mCurveNodes[i]);
+		pWriter.EndNode();
+
+		WriteConnections(pWriter);
+
+		pWriter.BeginNode("Takes");
+		WriteString(pWriter, "Current", kStackName);
+		pWriter.BeginNode("Take");
+		pWriter.AddString(kStackName);
+		WriteString(pWriter, "FileName", "Stack001.tak");
+		pWriter.BeginNode("LocalTime");
+		pWriter.AddInt64(0);
+		pWriter.AddInt64(mStop);
+		pWriter.EndNode();
+		pWriter.BeginNode("ReferenceTime");
+		pWriter.AddInt64(0);
+		pWriter.AddInt64(mStop);
+		pWriter.EndNode();
+		pWriter.EndNode();
+		pWriter.EndNode();
+	}
+
+	void NativeScene::WriteHeader(FbxBinaryWriter& pWriter)
+	{
+		pWriter.BeginNode("FBXHeaderExtension");
+		WriteInt32(pWriter, "FBXHeaderVersion", 1003);
+		WriteInt32(pWriter, "FBXVersion", int32_t(FbxBinaryWriter::kVersion));
+		WriteInt32(pWriter, "EncryptionType", 0);
+		pWriter.BeginNode("CreationTimeStamp");
+		WriteInt32(pWriter, "Version", 1000);
+		WriteInt32(pWriter, "Year", kCreationYear);
+		WriteInt32(pWriter, "Month", kCreationMonth);
+		WriteInt32(pWriter, "Day", kCreationDay);
+		WriteInt32(pWriter, "Hour", kCreationHour);
+		WriteInt32(pWriter, "Minute", 0);
+		WriteInt32(pWriter, "Second", 0);
+		WriteInt32(pWriter, "Millisecond", 0);
+		pWriter.EndNode();
+		WriteString(pWriter, "Creator", kCreator);
+		pWriter.EndNode();
+
+		pWriter.BeginNode("FileId");
+		pWriter.AddRaw(kFileId, sizeof(kFileId));
+		pWriter.EndNode();
+		WriteString(pWriter, "CreationTime", kCreationTime);
+		WriteString(pWriter, "Creator", kCreator);
+	}
+
+	// Y up, centimeters: the FbxScene defaults.
+	void NativeScene::WriteGlobalSettings(FbxBinaryWriter& pWriter)
+	{
+		const double lBlack[3] = { 0.0, 0.0, 0.0 };
+
+		pWriter.BeginNode("GlobalSettings");
+		WriteInt32(pWriter, "Version", 1000);
+		pWriter.BeginNode("Properties70");
+		PropertyInt(pWriter, "UpAxis", "int", 1);
+		PropertyInt(pWriter, "UpAxisSign", "int", 1);
+		PropertyInt(pWriter, "FrontAxis", "int", 2);
+		PropertyInt(pWriter, "FrontAxisSign", "int", 1);
+		PropertyInt(pWriter, "CoordAxis", "int", 0);
+		PropertyInt(pWriter, "CoordAxisSign", "int", 1);
+		PropertyInt(pWriter, "OriginalUpAxis", "int", 1);
+		PropertyInt(pWriter, "OriginalUpAxisSign", "int", 1);
+		PropertyDouble(pWriter, "UnitScaleFactor", "double", "Number", "", 1.0);
+		PropertyDouble(pWriter, "OriginalUnitScaleFactor", "double", "Number", "", 1.0);
+		PropertyDouble3(pWriter, "AmbientColor", "ColorRGB", "Color", "", lBlack);
+		PropertyString(pWriter, "DefaultCamera", mHasCamera ? "Camera" : "Producer Perspective");
+		if (mOptions.Resample())
+		{
+			int lTimeMode = TimeModeForFrameRate(mOptions.mFrameRate);
+			PropertyInt(pWriter, "TimeMode", "enum", lTimeMode);
+			if (lTimeMode == kTimeModeCustom)
+				PropertyDouble(pWriter, "CustomFrameRate", "double", "Number", "", mOptions.mFrameRate);
+		}
+		else
+		{
+			PropertyInt(pWriter, "TimeMode", "enum", kTimeModeDefault);
+		}
+		PropertyTime(pWriter, "TimeSpanStart", 0);
+		PropertyTime(pWriter, "TimeSpanStop", mStop);
+		pWriter.EndNode();
+		pWriter.EndNode();
+	}
+
+	void NativeScene::WriteDefinitions(FbxBinaryWriter& pWriter)
+	{
+		size_t lAttributes = mModels.size() - mMeshCount;
+		struct { const char* mType; size_t mCount; } lTypes[] = {
+			{ "GlobalSettings", 1 },
+			{ "Model", mModels.size() },
+			{ "NodeAttribute", lAttributes },
+			{ "Geometry", mGeometries.size() },
+			{ "Material", mMeshCount ? size_t(5) : size_t(0) },
+			{ "AnimationStack", 1 },
+			{ "AnimationLayer", 1 },
+			{ "AnimationCurveNode", mCurveNodes.size() },
+			{ "AnimationCurve", mCurveCount }
+		};
+
+		size_t lTotal = 0;
+		for (size_t i = 0; i < sizeof(lTypes) / sizeof(lTypes[0]); i++)
+			lTotal += lTypes[i].mCount;
+
+		pWriter.BeginNode("Definitions");
+		WriteInt32(pWriter, "Version", 100);
+		WriteInt32(pWriter, "Count", int32_t(lTotal));
+		for (size_t i = 0; i < sizeof(lTypes) / sizeof(lTypes[0]); i++)
+		{
+			if (lTypes[i].mCount == 0)
+				continue;
+			pWriter.BeginNode("ObjectType");
+			pWriter.AddString(lTypes[i].mType);
+			WriteInt32(pWriter, "Count", int32_t(lTypes[i].mCount));
+			pWriter.EndNode();
+		}
+		pWriter.EndNode();
+	}
+
+	void NativeScene::WriteModel(FbxBinaryWriter& pWriter, const Model& pModel)
+	{
+		const char* lTypes[] = { "Marker", "Mesh", "Camera" };
+
+		pWriter.BeginNode("Model");
+		pWriter.AddInt64(pModel.mId);
+		pWriter.AddString(ObjectName(pModel.mName, "Model"));
+		pWriter.AddString(lTypes[pModel.mType]);
+		WriteInt32(pWriter, "Version", 232);
+		pWriter.BeginNode("Properties70");
+		PropertyDouble3(pWriter, "Lcl Translation", "Lcl Translation", "", "A", pModel.mTranslation);
+		PropertyDouble3(pWriter, "Lcl Rotation", "Lcl Rotation", "", "A", pModel.mRotation);
+		PropertyDouble3(pWriter, "Lcl Scaling", "Lcl Scaling", "", "A", pModel.mScaling);
+		pWriter.EndNode();
+		pWriter.BeginNode("Shading");
+		pWriter.AddBool(true);
+		pWriter.EndNode();
+		WriteString(pWriter, "Culling", "CullingOff");
+		pWriter.EndNode();
+	}
+
+	// The pyramid of CreatePyramidMesh() (apex down for the right hand).
+	void NativeScene::WriteGeometry(FbxBinaryWriter& pWriter, const Geometry& pGeometry)
+	{
+		double lSide = pGeometry.mSide;
+		double lApex = pGeometry.mRightHand ? -pGeometry.mHeight : pGeometry.mHeight;
+		double lFlip = pGeometry.mRightHand ? -1.0 : 1.0;
+
+		const double lCorners[5][3] = {
+			{ -lSide, 0, lSide }, { lSide, 0, lSide }, { lSide, 0, -lSide }, { -lSide, 0, -lSide }, { 0, lApex, 0 }
+		};
+		const double lFaceNormals[5][3] = {
+			{ 0, lFlip, 0 }, { 0, 0.447 * lFlip, 0.894 }, { 0.894, 0.447 * lFlip, 0 }, { 0, 0.447 * lFlip, -0.894 }, { -0.894, 0.447 * lFlip, 0 }
+		};
+		const int lControlPoints[16] = { 0, 1, 2, 3, 0, 1, 4, 1, 2, 4, 2, 3, 4, 3, 0, 4 };
+		const int lNormalOfPoint[16] = { 0, 0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4 };
+
+		// the last index of every polygon is stored as -(index + 1)
+		const int32_t lPolygonVertices[16] = { 0, 3, 2, -2, 4, 5, -7, 7, 8, -10, 10, 11, -13, 13, 14, -16 };
+		const int32_t lMaterials[5] = { 0, 1, 2, 3, 4 };
+
+		double lVertices[48];
+		double lNormals[48];
+		for (int i = 0; i < 16; i++)
+		{
+			for (int c = 0; c < 3; c++)
+			{
+				lVertices[3 * i + c] = lCorners[lControlPoints[i]][c];
+				lNormals[3 * i + c] = lFaceNormals[lNormalOfPoint[i]][c];
+			}
+		}
+
+		pWriter.BeginNode("Geometry");
+		pWriter.AddInt64(pGeometry.mId);
+		pWriter.AddString(ObjectName(pGeometry.mName, "Geometry"));
+		pWriter.AddString("Mesh");
+
+		pWriter.BeginNode("Vertices");
+		pWriter.AddArray(lVertices, 48);
+		pWriter.EndNode();
+		pWriter.BeginNode("PolygonVertexIndex");
+		pWriter.AddArray(lPolygonVertices, 16);
+		pWriter.EndNode();
+		WriteInt32(pWriter, "GeometryVersion", 124);
+
+		pWriter.BeginNode("LayerElementNormal");
+		pWriter.AddInt32(0);
+		WriteInt32(pWriter, "Version", 101);
+		WriteString(pWriter, "Name", "");
+		WriteString(pWriter, "MappingInformationType", "ByVertice");
+		WriteString(pWriter, "ReferenceInformationType", "Direct");
+		pWriter.BeginNode("Normals");
+		pWriter.AddArray(lNormals, 48);
+		pWriter.EndNode();
+		pWriter.EndNode();
+
+		pWriter.BeginNode("LayerElementMaterial");
+		pWriter.AddInt32(0);
+		WriteInt32(pWriter, "Version", 101);
+		WriteString(pWriter, "Name", "");
+		WriteString(pWriter, "MappingInformationType", "ByPolygon");
+		WriteString(pWriter, "ReferenceInformationType", "IndexToDirect");
+		pWriter.BeginNode("Materials");
+		pWriter.AddArray(lMaterials, 5);
+		pWriter.EndNode();
+		pWriter.EndNode();
+
+		pWriter.BeginNode("Layer");
+		pWriter.AddInt32(0);
+		WriteInt32(pWriter, "Version", 100);
+		const char* lElements[] = { "LayerElementNormal", "LayerElementMaterial" };
+		for (int e = 0; e < 2; e++)
+		{
+			pWriter.BeginNode("LayerElement");
+			WriteString(pWriter, "Type", lElements[e]);
+			WriteInt32(pWriter, "TypedIndex", 0);
+			pWriter.EndNode();
+		}
+		pWriter.EndNode();
+
+		pWriter.EndNode();
+	}
+
+	// The five Phong materials of CreateMaterials().
+	void NativeScene::WriteMaterials(FbxBinaryWriter& pWriter)
+	{
+		const double lBlack[3] = { 0.0, 0.0, 0.0 };
+		const double lRed[3] = { 1.0, 0.0, 0.0 };
+
+		for (int i = 0; i < 5; i++)
+		{
+			char lName[24];
+			snprintf(lName, sizeof(lName), "material%d", i);
+			double lColor[3] = { i > 2 ? 1.0 : 0.0, i > 0 && i < 4 ? 1.0 : 0.0, i % 2 ? 0.0 : 1.0 };
+
+			pWriter.BeginNode("Material");
+			pWriter.AddInt64(mMaterials[i]);
+			pWriter.AddString(ObjectName(lName, "Material"));
+			pWriter.AddString("");
+			WriteInt32(pWriter, "Version", 102);
+			WriteString(pWriter, "ShadingModel", "Phong");
+			WriteInt32(pWriter, "MultiLayer", 0);
+			pWriter.BeginNode("Properties70");
+			PropertyDouble3(pWriter, "EmissiveColor", "Color", "", "A", lBlack);
+			PropertyDouble3(pWriter, "AmbientColor", "Color", "", "A", lRed);
+			PropertyDouble3(pWriter, "DiffuseColor", "Color", "", "A", lColor);
+			PropertyDouble(pWriter, "TransparencyFactor", "Number", "", "A", 0.0);
+			PropertyDouble(pWriter, "ShininessExponent", "Number", "", "A", 0.5);
+			pWriter.EndNode();
+			pWriter.EndNode();
+		}
+	}
+
+	// Curve node plus its three curves; key times and values are streamed
+	// from the pose buffers in blocks.
+	void NativeScene::WriteCurveNode(FbxBinaryWriter& pWriter, const CurveNode& pNode)
+	{
+		const Model& lModel = mModels[pNode.mModel];
+		TRACE_SPAN_DETAIL("WriteCurveNode", lModel.mName);
+		const double* lDefaults = pNode.mRotation ? lModel.mRotation : lModel.mTranslation;
+
+		pWriter.BeginNode("AnimationCurveNode");
+		pWriter.AddInt64(pNode.mId);
+		pWriter.AddString(ObjectName(pNode.mRotation ? "R" : "T", "AnimCurveNode"));
+		pWriter.AddString("");
+		pWriter.BeginNode("Properties70");
+		for (int c = 0; c < 3; c++)
+			PropertyDouble(pWriter, kComponentNames[c], "Number", "", "A", lDefaults[c]);
+		pWriter.EndNode();
+		pWriter.EndNode();
+
+		const PoseTrack& lTrack = *pNode.mTrack;
+		size_t lPoseCount = lTrack.Size();
+		if (lPoseCount == 0)
+			return;
+
+		// positions are recorded in meters, FBX uses centimeters
+		const std::vector<float>* lValues[3];
+		float lScale;
+		double lTolerance;
+		if (pNode.mRotation)
+		{
+			lValues[0] = &lTrack.mRotationX; lValues[1] = &lTrack.mRotationY; lValues[2] = &lTrack.mRotationZ;
+			lScale = 1.0f;
+			lTolerance = mOptions.mRotationTolerance;
+		}
+		else
+		{
+			lValues[0] = &lTrack.mPositionX; lValues[1] = &lTrack.mPositionY; lValues[2] = &lTrack.mPositionZ;
+			lScale = 100.0f;
+			lTolerance = mOptions.mTranslationTolerance;
+		}
+
+		const std::vector<int64_t>& lTimes = lTrack.mKeyTime;
+
+		std::vector<double> lSeconds;
+		std::vector<float> lScaled;
+		std::vector<char> lKeep;
+		if (lTolerance > 0.0)
+		{
+			lSeconds.resize(lPoseCount);
+			for (size_t i = 0; i < lPoseCount; i++)
+				lSeconds[i] = double(lTimes[i]) / double(kFbxTicksPerSecond);
+		}
+
+		const size_t kBlock = 4096;
+		int64_t lTimeBlock[kBlock];
+		float lValueBlock[kBlock];
+
+		for (int c = 0; c < 3; c++)
+		{
+			const float* lSource = &(*lValues[c])[0];
+			size_t lKeyCount = lPoseCount;
+
+			if (lTolerance > 0.0)
+			{
+				lScaled.resize(lPoseCount);
+				for (size_t i = 0; i < lPoseCount; i++)
+					lScaled[i] = lSource[i] * lScale;
+
+				StageTimer lTimer(mStats, eStageReduce);
+				double lError = 0.0;
+				lKeyCount = SimplifyLinear(&lSeconds[0], &lScaled[0], lPoseCount, lTolerance, lKeep, lError);
+
+				double& lMaxError = pNode.mRotation ? mReduction.mMaxRotationError : mReduction.mMaxTranslationError;
+				if (lError > lMaxError)
+					lMaxError = lError;
+				mReduction.mCurves++;
+				mReduction.mKeysBefore += lPoseCount;
+				mReduction.mKeysAfter += lKeyCount;
+			}
+			mStats.mCurvesCreated++;
+			mStats.mKeysWritten += lKeyCount;
+
+			pWriter.BeginNode("AnimationCurve");
+			pWriter.AddInt64(pNode.mCurves[c]);
+			pWriter.AddString(ObjectName("", "AnimCurve"));
+			pWriter.AddString("");
+			pWriter.BeginNode("Default");
+			pWriter.AddDouble(0.0);
+			pWriter.EndNode();
+			WriteInt32(pWriter, "KeyVer", 4009);
+
+			pWriter.BeginNode("KeyTime");
+			pWriter.BeginArray('l', lKeyCount);
+			size_t lBlockSize = 0;
+			for (size_t i = 0; i < lPoseCount; i++)
+			{
+				if (lTolerance > 0.0 && !lKeep[i])
+					continue;
+				lTimeBlock[lBlockSize++] = lTimes[i];
+				if (lBlockSize == kBlock)
+				{
+					pWriter.AppendArray(lTimeBlock, lBlockSize * sizeof(int64_t));
+					lBlockSize = 0;
+				}
+			}
+			pWriter.AppendArray(lTimeBlock, lBlockSize * sizeof(int64_t));
+			pWriter.EndArray();
+			pWriter.EndNode();
+
+			pWriter.BeginNode("KeyValueFloat");
+			pWriter.BeginArray('f', lKeyCount);
+			lBlockSize = 0;
+			for (size_t i = 0; i < lPoseCount; i++)
+			{
+				if (lTolerance > 0.0 && !lKeep[i])
+					continue;
+				lValueBlock[lBlockSize++] = lSource[i] * lScale;
+				if (lBlockSize == kBlock)
+				{
+					pWriter.AppendArray(lValueBlock, lBlockSize * sizeof(float));
+					lBlockSize = 0;
+				}
+			}
+			pWriter.AppendArray(lValueBlock, lBlockSize * sizeof(float));
+			pWriter.EndArray();
+			pWriter.EndNode();
+
+			// every key shares one set of attributes
+			float lAttributeData[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+			memcpy(&lAttributeData[2], &kDefaultKeyWeights, sizeof(float));
+			int32_t lReferenceCount = int32_t(lKeyCount);
+
+			pWriter.BeginNode("KeyAttrFlags");
+			pWriter.AddArray(&kLinearKeyFlags, 1);
+			pWriter.EndNode();
+			pWriter.BeginNode("KeyAttrDataFloat");
+			pWriter.AddArray(lAttributeData, 4);
+			pWriter.EndNode();
+			pWriter.BeginNode("KeyAttrRefCount");
+			pWriter.AddArray(&lReferenceCount, 1);
+			pWriter.EndNode();
+
+			pWriter.EndNode();
+		}
+	}
+
+	void NativeScene::WriteConnections(FbxBinaryWriter& pWriter)
+	{
+		struct Link
+		{
+			static void Objects(FbxBinaryWriter& pWriter, int64_t pChild, int64_t pParent)
+			{
+				pWriter.BeginNode("C");
+				pWriter.AddString("OO");
+				pWriter.AddInt64(pChild);
+				pWriter.AddInt64(pParent);
+				pWriter.EndNode();
+			}
+
+			static void Property(FbxBinaryWriter& pWriter, int64_t pChild, int64_t pParent, const char* pProperty)
+			{
+				pWriter.BeginNode("C");
+				pWriter.AddString("OP");
+				pWriter.AddInt64(pChild);
+				pWriter.AddInt64(pParent);
+				pWriter.AddString(pProperty);
+				pWriter.EndNode();
+			}
+		};
+
+		pWriter.BeginNode("Connections");
+
+		for (size_t i = 0; i < mModels.size(); i++)
+		{
+			const Model& lModel = mModels[i];
+			Link::Objects(pWriter, lModel.mId, lModel.mParent);
+			Link::Objects(pWriter, lModel.mAttribute, lModel.mId);
+
+			// the connection order gives the material indices
+			if (lModel.mType == eMesh)
+				for (int m = 0; m < 5; m++)
+					Link::Objects(pWriter, mMaterials[m], lModel.mId);
+		}
+
+		Link::Objects(pWriter, mLayerId, mStackId);
+
+		for (size_t i = 0; i < mCurveNodes.size(); i++)
+		{
+			const CurveNode& lNode = mCurveNodes[i];
+			Link::Objects(pWriter, lNode.mId, mLayerId);
+			Link::Property(pWriter, lNode.mId, mModels[lNode.mModel].mId, lNode.mRotation ? "Lcl Rotation" : "Lcl Translation");
+
+			if (lNode.mTrack->Size())
+				for (int c = 0; c < 3; c++)
+					Link::Property(pWriter, lNode.mCurves[c], lNode.mId, kComponentNames[c]);
+		}
+
+		pWriter.EndNode();
+	}
+}
+
+bool WriteNativeScene(std::ostream& pStream, const PoseRecording& pRecording,
+	const ConversionOptions& pOptions, KeyReductionStats& pReduction, ConversionStats& pStats)
+{
+	if (!CheckKeyTimes(pRecording))
+		return false;
+
+	NativeScene lScene(pRecording, pOptions, pReduction, pStats);
+
+	FbxBinaryWriter lWriter(pStream, pOptions.mCompressArrays);
+	lScene.Write(lWriter);
+	return lWriter.Finish();
+}
+
+bool SaveNativeScene(const char* pFilename, const PoseRecording& pRecording,
+	const ConversionOptions& pOptions, KeyReductionStats& pReduction, ConversionStats& pStats)
+{
+	std::ofstream lStream(pFilename, std::ios::binary | std::ios::trunc);
+	if (!lStream)
+	{
+		printf("Error: Unable to create output file '%s'\n", pFilename);
+		return false;
+	}
+
+	if (!WriteNativeScene(lStream, pRecording, pOptions, pReduction, pStats))
+	{
+		printf("Error: Unable to write output file '%s'\n", pFilename);
+		return false;
+	}
+
+	return true;
+}
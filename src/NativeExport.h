@@ -0,0 +1,27 @@
+#ifndef _NATIVE_EXPORT_H
+#define _NATIVE_EXPORT_H
+
+#include "ConversionStats.h"
+#include "CurveSimplify.h"
+#include "PoseBuffer.h"
+
+#include <ostream>
+
+struct ConversionOptions;
+
+// Write the scene CreateScene builds (marker hierarchy, pyramid meshes with
+// their materials, camera and the translation/rotation curves of every
+// device; only the markers and curves with pOptions.mAnimationOnly)
+// straight to a binary FBX file, without FbxManager or FbxExporter.
+// Curve arrays are streamed from the pose buffers. Key reduction and
+// resampled frame rates are applied as in the SDK path; reduction results
+// are added to pReduction. Building the scene and reducing curves are timed
+// in pStats, and the curves and keys written are counted there.
+bool SaveNativeScene(const char* pFilename, const PoseRecording& pRecording,
+	const ConversionOptions& pOptions, KeyReductionStats& pReduction, ConversionStats& pStats);
+
+// Same, written to pStream (which must be seekable). Return false if writing failed.
+bool WriteNativeScene(std::ostream& pStream, const PoseRecording& pRecording,
+	const ConversionOptions& pOptions, KeyReductionStats& pReduction, ConversionStats& pStats);
+
+#endif // #ifndef _NATIVE_EXPORT_H
@@ -0,0 +1,396 @@
+#include "OutputCache.h"
+#include "BatchJobs.h"
+#include "BinaryRecording.h"
+#include "FbxBinaryWriter.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+
+#ifdef _WIN32
+	#include <windows.h>
+	#include <direct.h>
+	#include <process.h>
+	#include <sys/utime.h>
+#else
+	#include <dirent.h>
+	#include <sys/stat.h>
+	#include <unistd.h>
+	#include <utime.h>
+#endif
+
+#ifndef MOTION2FBX_NO_FBXSDK
+	#include <fbxsdk.h>
+#endif
+
+const char* const kConverterVersion = "2.4";
+
+namespace
+{
+	const uint64_t kPrime1 = 11400714785074694791ULL;
+	const uint64_t kPrime2 = 14029467366897019727ULL;
+	const uint64_t kPrime3 = 1609587929392839161ULL;
+	const uint64_t kPrime4 = 9650029242287828579ULL;
+	const uint64_t kPrime5 = 2870177450012600261ULL;
+
+	const size_t kKeyLength = 32;
+	const size_t kCopyChunk = 1 << 20;
+
+	inline uint64_t RotateLeft(uint64_t pValue, int pBits)
+	{
+		return (pValue << pBits) | (pValue >> (64 - pBits));
+	}
+
+	inline uint64_t Read64(const unsigned char* p)
+	{
+		uint64_t lValue;
+		memcpy(&lValue, p, sizeof(lValue));
+		return lValue;
+	}
+
+	inline uint32_t Read32(const unsigned char* p)
+	{
+		uint32_t lValue;
+		memcpy(&lValue, p, sizeof(lValue));
+		return lValue;
+	}
+
+	inline uint64_t Round(uint64_t pAccumulator, uint64_t pInput)
+	{
+		pAccumulator += pInput * kPrime2;
+		pAccumulator = RotateLeft(pAccumulator, 31);
+		return pAccumulator * kPrime1;
+	}
+
+	inline uint64_t MergeRound(uint64_t pAccumulator, uint64_t pValue)
+	{
+		pAccumulator ^= Round(0, pValue);
+		return pAccumulator * kPrime1 + kPrime4;
+	}
+
+	// One cache file, for eviction.
+	struct CacheEntry
+	{
+		std::string mPath;
+		uint64_t mSize;
+		int64_t mTime;		// last use
+
+		bool operator<(const CacheEntry& pOther) const { return mTime < pOther.mTime; }
+	};
+
+	// Serializes eviction between the workers of this process.
+	std::mutex gEvictionMutex;
+	std::atomic<unsigned> gTemporaryCounter(0);
+
+	// True for "<32 hex digits>.fbx" and "<32 hex digits>.m2fb": only files the
+	// cache wrote are ever evicted.
+	bool IsEntryName(const char* pName)
+	{
+		for (size_t i = 0; i < kKeyLength; i++)
+		{
+			char c = pName[i];
+			if (!((c >= '0' && c <= '9') || (c >= 'a' && c <= 'f')))
+				return false;
+		}
+		return strcmp(pName + kKeyLength, ".fbx") == 0 || strcmp(pName + kKeyLength, ".m2fb") == 0;
+	}
+
+	std::string GetEntryPath(const std::string& pDirectory, const std::string& pKey, const std::string& pOutputPath)
+	{
+		return pDirectory + "/" + pKey + (IsBinaryRecordingPath(pOutputPath) ? ".m2fb" : ".fbx");
+	}
+
+	bool CopyWholeFile(const std::string& pFrom, const std::string& pTo)
+	{
+		FILE* lFrom = fopen(pFrom.c_str(), "rb");
+		if (!lFrom)
+			return false;
+		FILE* lTo = fopen(pTo.c_str(), "wb");
+		if (!lTo)
+		{
+			fclose(lFrom);
+			return false;
+		}
+
+		std::vector<char> lChunk(kCopyChunk);
+		bool lOk = true;
+		size_t lRead;
+		while (lOk && (lRead = fread(&lChunk[0], 1, lChunk.size(), lFrom)) > 0)
+			lOk = fwrite(&lChunk[0], 1, lRead, lTo) == lRead;
+		lOk = lOk && !ferror(lFrom);
+
+		fclose(lFrom);
+		lOk = fclose(lTo) == 0 && lOk;
+		return lOk;
+	}
+
+	bool ReadWholeFile(const std::string& pPath, std::vector<char>& pBuffer)
+	{
+		FILE* lFile = fopen(pPath.c_str(), "rb");
+		if (!lFile)
+			return false;
+
+		pBuffer.clear();
+		std::vector<char> lChunk(kCopyChunk);
+		size_t lRead;
+		while ((lRead = fread(&lChunk[0], 1, lChunk.size(), lFile)) > 0)
+			pBuffer.insert(pBuffer.end(), lChunk.begin(), lChunk.begin() + lRead);
+		bool lOk = !ferror(lFile);
+		fclose(lFile);
+		return lOk;
+	}
+
+	bool WriteWholeFile(const std::string& pPath, const std::vector<char>& pBuffer)
+	{
+		FILE* lFile = fopen(pPath.c_str(), "wb");
+		if (!lFile)
+			return false;
+		bool lOk = pBuffer.empty() || fwrite(&pBuffer[0], 1, pBuffer.size(), lFile) == pBuffer.size();
+		return fclose(lFile) == 0 && lOk;
+	}
+
+#ifdef _WIN32
+
+	void MakeDirectory(const std::string& pPath)
+	{
+		_mkdir(pPath.c_str());
+	}
+
+	// Mark an entry as just used.
+	void Touch(const std::string& pPath)
+	{
+		_utime(pPath.c_str(), NULL);
+	}
+
+	bool MoveIntoPlace(const std::string& pFrom, const std::string& pTo)
+	{
+		return MoveFileExA(pFrom.c_str(), pTo.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+	}
+
+	unsigned GetProcessNumber()
+	{
+		return unsigned(_getpid());
+	}
+
+	void ListEntries(const std::string& pDirectory, std::vector<CacheEntry>& pEntries)
+	{
+		WIN32_FIND_DATAA lData;
+		HANDLE lFind = FindFirstFileA((pDirectory + "/*").c_str(), &lData);
+		if (lFind == INVALID_HANDLE_VALUE)
+			return;
+		do
+		{
+			if ((lData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) || !IsEntryName(lData.cFileName))
+				continue;
+			CacheEntry lEntry;
+			lEntry.mPath = pDirectory + "/" + lData.cFileName;
+			lEntry.mSize = (uint64_t(lData.nFileSizeHigh) << 32) | lData.nFileSizeLow;
+			lEntry.mTime = (int64_t(lData.ftLastWriteTime.dwHighDateTime) << 32) | lData.ftLastWriteTime.dwLowDateTime;
+			pEntries.push_back(lEntry);
+		} while (FindNextFileA(lFind, &lData));
+		FindClose(lFind);
+	}
+
+#else
+
+	void MakeDirectory(const std::string& pPath)
+	{
+		mkdir(pPath.c_str(), 0777);
+	}
+
+	// Mark an entry as just used.
+	void Touch(const std::string& pPath)
+	{
+		utime(pPath.c_str(), NULL);
+	}
+
+	bool MoveIntoPlace(const std::string& pFrom, const std::string& pTo)
+	{
+		return rename(pFrom.c_str(), pTo.c_str()) == 0;
+	}
+
+	unsigned GetProcessNumber()
+	{
+		return unsigned(getpid());
+	}
+
+	void ListEntries(const std::string& pDirectory, std::vector<CacheEntry>& pEntries)
+	{
+		DIR* lDirectory = opendir(pDirectory.c_str());
+		if (!lDirectory)
+			return;
+		while (dirent* lFile = readdir(lDirectory))
+		{
+			if (!IsEntryName(lFile->d_name))
+				continue;
+			CacheEntry lEntry;
+			lEntry.mPath = pDirectory + "/" + lFile->d_name;
+			struct stat lStat;
+			if (stat(lEntry.mPath.c_str(), &lStat) != 0 || !S_ISREG(lStat.st_mode))
+				continue;
+			lEntry.mSize = uint64_t(lStat.st_size);
+			lEntry.mTime = int64_t(lStat.st_mtime);
+			pEntries.push_back(lEntry);
+		}
+		closedir(lDirectory);
+	}
+
+#endif
+
+	// Remove the least recently used entries until the cache fits pMaxBytes.
+	// pKeep, the entry just stored, is the last one to go.
+	void Evict(const std::string& pDirectory, uint64_t pMaxBytes, const std::string& pKeep)
+	{
+		std::lock_guard<std::mutex> lLock(gEvictionMutex);
+
+		std::vector<CacheEntry> lEntries;
+		ListEntries(pDirectory, lEntries);
+
+		uint64_t lTotal = 0;
+		for (size_t i = 0; i < lEntries.size(); i++)
+			lTotal += lEntries[i].mSize;
+		if (lTotal <= pMaxBytes)
+			return;
+
+		std::sort(lEntries.begin(), lEntries.end());
+		std::stable_partition(lEntries.begin(), lEntries.end(),
+			[&pKeep](const CacheEntry& pEntry) { return pEntry.mPath != pKeep; });
+		for (size_t i = 0; i < lEntries.size() && lTotal > pMaxBytes; i++)
+		{
+			// another process may have removed it already
+			remove(lEntries[i].mPath.c_str());
+			lTotal -= lEntries[i].mSize;
+		}
+	}
+}
+
+uint64_t HashBytes(const void* pData, size_t pSize, uint64_t pSeed)
+{
+	const unsigned char* p = static_cast<const unsigned char*>(pData);
+	const unsigned char* lEnd = p + pSize;
+	uint64_t lHash;
+
+	if (pSize >= 32)
+	{
+		uint64_t lV1 = pSeed + kPrime1 + kPrime2;
+		uint64_t lV2 = pSeed + kPrime2;
+		uint64_t lV3 = pSeed;
+		uint64_t lV4 = pSeed - kPrime1;
+		const unsigned char* lLimit = lEnd - 32;
+		do
+		{
+			lV1 = Round(lV1, Read64(p));
+			lV2 = Round(lV2, Read64(p + 8));
+			lV3 = Round(lV3, Read64(p + 16));
+			lV4 = Round(lV4, Read64(p + 24));
+			p += 32;
+		} while (p <= lLimit);
+
+		lHash = RotateLeft(lV1, 1) + RotateLeft(lV2, 7) + RotateLeft(lV3, 12) + RotateLeft(lV4, 18);
+		lHash = MergeRound(lHash, lV1);
+		lHash = MergeRound(lHash, lV2);
+		lHash = MergeRound(lHash, lV3);
+		lHash = MergeRound(lHash, lV4);
+	}
+	else
+	{
+		lHash = pSeed + kPrime5;
+	}
+
+	lHash += uint64_t(pSize);
+
+	for (; p + 8 <= lEnd; p += 8)
+	{
+		lHash ^= Round(0, Read64(p));
+		lHash = RotateLeft(lHash, 27) * kPrime1 + kPrime4;
+	}
+	if (p + 4 <= lEnd)
+	{
+		lHash ^= uint64_t(Read32(p)) * kPrime1;
+		lHash = RotateLeft(lHash, 23) * kPrime2 + kPrime3;
+		p += 4;
+	}
+	for (; p < lEnd; p++)
+	{
+		lHash ^= uint64_t(*p) * kPrime5;
+		lHash = RotateLeft(lHash, 11) * kPrime1;
+	}
+
+	lHash ^= lHash >> 33;
+	lHash *= kPrime2;
+	lHash ^= lHash >> 29;
+	lHash *= kPrime3;
+	lHash ^= lHash >> 32;
+	return lHash;
+}
+
+std::string GetCacheKey(const char* pData, size_t pSize, const ConversionOptions& pOptions,
+	const std::string& pOutputPath)
+{
+	// the options as the writers will apply them
+#ifdef MOTION2FBX_NO_FBXSDK
+	const char* lSdkVersion = "none";
+	bool lNative = true;
+#else
+	const char* lSdkVersion = FBXSDK_VERSION_STRING;
+	bool lNative = pOptions.mNativeWriter;
+#endif
+	bool lCompress = lNative && pOptions.mCompressArrays && FbxBinaryWriter::SupportsCompression();
+
+	char lDescription[512];
+	snprintf(lDescription, sizeof(lDescription),
+		"motion2fbx %s|sdk %s|%s|format %d|native %d|compress %d|reduce %.17g %.17g|resample %.17g|animation only %d|topology %d",
+		kConverterVersion, lSdkVersion, IsBinaryRecordingPath(pOutputPath) ? "m2fb" : "fbx",
+		pOptions.mFileFormat, int(lNative), int(lCompress),
+		pOptions.ReduceKeys() ? pOptions.mTranslationTolerance : 0.0,
+		pOptions.ReduceKeys() ? pOptions.mRotationTolerance : 0.0,
+		pOptions.Resample() ? pOptions.mFrameRate : 0.0, int(pOptions.mAnimationOnly),
+		int(pOptions.mTopology));
+
+	char lKey[kKeyLength + 1];
+	snprintf(lKey, sizeof(lKey), "%016llx%016llx",
+		(unsigned long long)HashBytes(pData, pSize),
+		(unsigned long long)HashBytes(lDescription, strlen(lDescription)));
+	return lKey;
+}
+
+bool FetchCachedOutput(const ConversionOptions& pOptions, const std::string& pKey,
+	const std::string& pOutputPath, std::vector<char>* pBuffer, uint64_t& pBytes)
+{
+	std::string lEntry = GetEntryPath(pOptions.mCacheDirectory, pKey, pOutputPath);
+	bool lHit = pBuffer ? ReadWholeFile(lEntry, *pBuffer) : CopyWholeFile(lEntry, pOutputPath);
+	if (!lHit)
+		return false;
+
+	Touch(lEntry);
+	pBytes = pBuffer ? pBuffer->size() : GetFileSize(pOutputPath);
+	return true;
+}
+
+bool StoreCachedOutput(const ConversionOptions& pOptions, const std::string& pKey,
+	const std::string& pOutputPath, const std::vector<char>* pBuffer)
+{
+	const std::string& lDirectory = pOptions.mCacheDirectory;
+	MakeDirectory(lDirectory);
+
+	// write under a name of this process and thread, then move it into place,
+	// so no reader ever sees a partial entry
+	char lSuffix[64];
+	snprintf(lSuffix, sizeof(lSuffix), ".%u.%u.tmp", GetProcessNumber(), gTemporaryCounter++);
+	std::string lTemporary = lDirectory + "/" + pKey + lSuffix;
+	std::string lEntry = GetEntryPath(lDirectory, pKey, pOutputPath);
+
+	bool lStored = pBuffer ? WriteWholeFile(lTemporary, *pBuffer) : CopyWholeFile(pOutputPath, lTemporary);
+	lStored = lStored && MoveIntoPlace(lTemporary, lEntry);
+	if (!lStored)
+	{
+		remove(lTemporary.c_str());
+		printf("Warning: Unable to add '%s' to the cache in '%s'\n", pOutputPath.c_str(), lDirectory.c_str());
+		return false;
+	}
+
+	Evict(lDirectory, pOptions.mCacheMaxBytes, lEntry);
+	return true;
+}
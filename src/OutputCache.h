@@ -0,0 +1,41 @@
+#ifndef _OUTPUT_CACHE_H
+#define _OUTPUT_CACHE_H
+
+#include "ConversionOptions.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Version of the converter output. It is part of every cache key: bump it
+// whenever a change makes the same input and options give a different file.
+extern const char* const kConverterVersion;
+
+// 64 bit XXH64 hash of pData.
+uint64_t HashBytes(const void* pData, size_t pSize, uint64_t pSeed = 0);
+
+// Key of the output of converting pData with pOptions into pOutputPath: the
+// hash of the input bytes plus a hash of everything that changes the output
+// (converter and FBX SDK version, writer, format, compression, reduction
+// tolerances, resampling rate, animation only, topology, FBX or .m2fb
+// output), as 32 hex digits.
+std::string GetCacheKey(const char* pData, size_t pSize, const ConversionOptions& pOptions,
+	const std::string& pOutputPath);
+
+// Output cache in pOptions.mCacheDirectory: one file per key, evicted least
+// recently used first once the directory holds more than
+// pOptions.mCacheMaxBytes. Safe to use from several workers and processes;
+// an entry that disappears or cannot be read is a miss.
+//
+// Copy the cached output of pKey to pOutputPath, or into pBuffer if it is
+// not NULL. Set pBytes to its size and return true on a hit.
+bool FetchCachedOutput(const ConversionOptions& pOptions, const std::string& pKey,
+	const std::string& pOutputPath, std::vector<char>* pBuffer, uint64_t& pBytes);
+
+// Add the output just written to pOutputPath (or pBuffer) under pKey, then
+// evict old entries down to the size cap.
+bool StoreCachedOutput(const ConversionOptions& pOptions, const std::string& pKey,
+	const std::string& pOutputPath, const std::vector<char>* pBuffer);
+
+#endif // #ifndef _OUTPUT_CACHE_H
@@ -0,0 +1,667 @@
+#include "ParallelIngest.h"
+#include "FastNumber.h"
+#include "Trace.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+	const size_t kMinChunkBytes = 256 * 1024;
+	const size_t kChunksPerThread = 8;
+
+	inline bool IsSpace(char c)
+	{
+		return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+	}
+
+	inline const char* SkipSpace(const char* p, const char* pEnd)
+	{
+		while (p < pEnd && IsSpace(*p))
+			p++;
+		return p;
+	}
+
+	inline int HexDigit(char c)
+	{
+		if (c >= '0' && c <= '9')
+			return c - '0';
+		if (c >= 'a' && c <= 'f')
+			return c - 'a' + 10;
+		if (c >= 'A' && c <= 'F')
+			return c - 'A' + 10;
+		return -1;
+	}
+
+	// p points after "\u". Read the 4 hex digits into pCode. Return the
+	// position after them, or NULL.
+	const char* ReadUnicodeEscape(const char* p, const char* pEnd, int& pCode)
+	{
+		if (pEnd - p < 4)
+			return NULL;
+		pCode = 0;
+		for (int i = 0; i < 4; i++)
+		{
+			int lDigit = HexDigit(p[i]);
+			if (lDigit < 0)
+				return NULL;
+			pCode = pCode * 16 + lDigit;
+		}
+		return p + 4;
+	}
+
+	// Length of the UTF-8 sequence at p as the JSON parser accepts it (no
+	// overlong forms, surrogates or code points above U+10FFFF), or 0.
+	size_t Utf8Length(const char* p, const char* pEnd)
+	{
+		const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+		unsigned char lLow = 0x80, lHigh = 0xBF;
+		size_t lLength;
+		if (u[0] >= 0xC2 && u[0] <= 0xDF)
+			lLength = 2;
+		else if (u[0] >= 0xE0 && u[0] <= 0xEF)
+		{
+			lLength = 3;
+			if (u[0] == 0xE0)
+				lLow = 0xA0;
+			else if (u[0] == 0xED)
+				lHigh = 0x9F;
+		}
+		else if (u[0] >= 0xF0 && u[0] <= 0xF4)
+		{
+			lLength = 4;
+			if (u[0] == 0xF0)
+				lLow = 0x90;
+			else if (u[0] == 0xF4)
+				lHigh = 0x8F;
+		}
+		else
+			return 0;
+
+		if (size_t(pEnd - p) < lLength || u[1] < lLow || u[1] > lHigh)
+			return 0;
+		for (size_t i = 2; i < lLength; i++)
+		{
+			if (u[i] < 0x80 || u[i] > 0xBF)
+				return 0;
+		}
+		return lLength;
+	}
+
+	// p points at the opening quote. Return the position after the closing
+	// quote, or NULL if the string is not one the JSON parser accepts: raw
+	// control bytes, unknown escapes, \u without 4 hex digits or with an
+	// unpaired surrogate, and invalid UTF-8 are all rejected.
+	const char* SkipString(const char* p, const char* pEnd)
+	{
+		p++;
+		while (p < pEnd)
+		{
+			unsigned char c = static_cast<unsigned char>(*p);
+			if (c == '"')
+				return p + 1;
+			if (c < 0x20)
+				return NULL;
+			if (c >= 0x80)
+			{
+				size_t lLength = Utf8Length(p, pEnd);
+				if (lLength == 0)
+					return NULL;
+				p += lLength;
+				continue;
+			}
+			if (c != '\\')
+			{
+				p++;
+				continue;
+			}
+
+			if (++p >= pEnd)
+				return NULL;
+			switch (*p++)
+			{
+			case '"':
+			case '\\':
+			case '/':
+			case 'b':
+			case 'f':
+			case 'n':
+			case 'r':
+			case 't':
+				break;
+			case 'u':
+			{
+				int lCode;
+				p = ReadUnicodeEscape(p, pEnd, lCode);
+				if (!p || (lCode >= 0xDC00 && lCode <= 0xDFFF))
+					return NULL;
+				if (lCode >= 0xD800 && lCode <= 0xDBFF)
+				{
+					// a high surrogate must be followed by an escaped low one
+					if (pEnd - p < 2 || p[0] != '\\' || p[1] != 'u')
+						return NULL;
+					p = ReadUnicodeEscape(p + 2, pEnd, lCode);
+					if (!p || lCode < 0xDC00 || lCode > 0xDFFF)
+						return NULL;
+				}
+				break;
+			}
+			default:
+				return NULL;
+			}
+		}
+		return NULL;
+	}
+
+	// p points at the opening quote. Return the position after the closing
+	// quote without checking the contents, for SkipBalanced().
+	const char* FindStringEnd(const char* p, const char* pEnd)
+	{
+		p++;
+		for (;;)
+		{
+			const char* lQuote = static_cast<const char*>(memchr(p, '"', size_t(pEnd - p)));
+			if (!lQuote)
+				return NULL;
+
+			// the quote is escaped if it follows an odd number of backslashes
+			const char* lBack = lQuote;
+			while (lBack > p && lBack[-1] == '\\')
+				lBack--;
+			if (((lQuote - lBack) & 1) == 0)
+				return lQuote + 1;
+
+			p = lQuote + 1;
+		}
+	}
+
+	// Deepest nesting SkipValue() and SkipBalanced() follow; deeper documents
+	// are left to ReadPoseRecording.
+	const int kMaxSkipDepth = 256;
+
+	// p points at 't', 'f' or 'n'. Return the position after the literal.
+	const char* SkipLiteral(const char* p, const char* pEnd)
+	{
+		const char* lLiteral = *p == 't' ? "true" : *p == 'f' ? "false" : "null";
+		size_t lLength = strlen(lLiteral);
+		if (size_t(pEnd - p) < lLength || memcmp(p, lLiteral, lLength) != 0)
+			return NULL;
+		return p + lLength;
+	}
+
+	const char* SkipValue(const char* p, const char* pEnd, int pDepth = 0);
+
+	// Skip the object or array at p, checking its members, separators and
+	// closing bracket. Return the position after it.
+	const char* SkipContainer(const char* p, const char* pEnd, int pDepth)
+	{
+		if (pDepth >= kMaxSkipDepth)
+			return NULL;
+
+		bool lObject = *p == '{';
+		char lClose = lObject ? '}' : ']';
+		p = SkipSpace(p + 1, pEnd);
+		if (p < pEnd && *p == lClose)
+			return p + 1;
+
+		for (;;)
+		{
+			if (lObject)
+			{
+				if (p >= pEnd || *p != '"')
+					return NULL;
+				p = SkipSpace(SkipString(p, pEnd), pEnd);
+				if (!p || p >= pEnd || *p != ':')
+					return NULL;
+				p = SkipSpace(p + 1, pEnd);
+			}
+
+			p = SkipValue(p, pEnd, pDepth + 1);
+			if (!p)
+				return NULL;
+
+			p = SkipSpace(p, pEnd);
+			if (p >= pEnd)
+				return NULL;
+			if (*p == lClose)
+				return p + 1;
+			if (*p != ',')
+				return NULL;
+			p = SkipSpace(p + 1, pEnd);
+		}
+	}
+
+	// Skip any JSON value without keeping it, with the same checks as the
+	// JSON parser (strings, literals, number grammar, matching brackets), so
+	// a document is valid or not whichever way it is read. Return the
+	// position after the value, or NULL.
+	const char* SkipValue(const char* p, const char* pEnd, int pDepth)
+	{
+		if (p >= pEnd)
+			return NULL;
+
+		switch (*p)
+		{
+		case '"':
+			return SkipString(p, pEnd);
+		case '{':
+		case '[':
+			return SkipContainer(p, pEnd, pDepth);
+		case 't':
+		case 'f':
+		case 'n':
+			return SkipLiteral(p, pEnd);
+		default:
+			double lNumber;
+			return ParseJsonNumber(p, pEnd, lNumber);
+		}
+	}
+
+	// Find the end of the pose object or other value at p by matching its
+	// brackets only. Used by the serial index pass; the chunk parse checks
+	// the contents with ParsePose() and SkipValue(). Return the position
+	// after the value, or NULL.
+	const char* SkipBalanced(const char* p, const char* pEnd)
+	{
+		if (p >= pEnd)
+			return NULL;
+		if (*p != '{' && *p != '[')
+			return SkipValue(p, pEnd);
+
+		char lOpen[kMaxSkipDepth];
+		int lDepth = 0;
+		while (p < pEnd)
+		{
+			switch (*p)
+			{
+			case '"':
+				p = FindStringEnd(p, pEnd);
+				if (!p)
+					return NULL;
+				continue;
+			case '{':
+			case '[':
+				if (lDepth == kMaxSkipDepth)
+					return NULL;
+				lOpen[lDepth++] = *p;
+				break;
+			case '}':
+			case ']':
+				if (lOpen[--lDepth] != (*p == '}' ? '{' : '['))
+					return NULL;
+				if (lDepth == 0)
+					return p + 1;
+				break;
+			}
+			p++;
+		}
+		return NULL;
+	}
+
+	// p points at the opening quote of an object key. Sets the raw key bytes and
+	// returns the position after the ':' separator. Keys with escapes are rejected.
+	const char* ReadKey(const char* p, const char* pEnd, const char*& pKey, size_t& pKeyLength)
+	{
+		if (p >= pEnd || *p != '"')
+			return NULL;
+
+		const char* lEnd = SkipString(p, pEnd);
+		if (!lEnd)
+			return NULL;
+
+		pKey = p + 1;
+		pKeyLength = size_t(lEnd - 1 - pKey);
+		if (memchr(pKey, '\\', pKeyLength))
+			return NULL;
+
+		p = SkipSpace(lEnd, pEnd);
+		if (p >= pEnd || *p != ':')
+			return NULL;
+		return SkipSpace(p + 1, pEnd);
+	}
+
+	inline bool KeyIs(const char* pKey, size_t pKeyLength, const char* pName, size_t pNameLength)
+	{
+		return pKeyLength == pNameLength && memcmp(pKey, pName, pNameLength) == 0;
+	}
+
+	// After a member value: skip to the next key or the end of the object.
+	// Return the position of the next key, or after the closing '}'.
+	const char* NextMember(const char* p, const char* pEnd, bool& pDone)
+	{
+		p = SkipSpace(p, pEnd);
+		if (p >= pEnd)
+			return NULL;
+		if (*p == '}')
+		{
+			pDone = true;
+			return p + 1;
+		}
+		if (*p != ',')
+			return NULL;
+		return SkipSpace(p + 1, pEnd);
+	}
+
+	// Split the poses array at p into chunks. Return the position after ']'.
+	const char* IndexPoses(const char* pData, const char* p, const char* pEnd, size_t pTrack,
+		size_t pChunkBytes, std::vector<PoseChunk>& pChunks)
+	{
+		PoseChunk lChunk;
+		lChunk.mTrack = pTrack;
+		lChunk.mBegin = size_t(++p - pData);
+
+		p = SkipSpace(p, pEnd);
+		if (p < pEnd && *p == ']')
+			return p + 1;
+
+		for (;;)
+		{
+			p = SkipBalanced(p, pEnd);
+			if (!p)
+				return NULL;
+
+			p = SkipSpace(p, pEnd);
+			if (p >= pEnd)
+				return NULL;
+
+			if (*p == ']')
+			{
+				lChunk.mEnd = size_t(p - pData);
+				pChunks.push_back(lChunk);
+				return p + 1;
+			}
+			if (*p != ',')
+				return NULL;
+
+			if (size_t(p - pData) - lChunk.mBegin >= pChunkBytes)
+			{
+				lChunk.mEnd = size_t(p - pData);
+				pChunks.push_back(lChunk);
+				lChunk.mBegin = lChunk.mEnd + 1;
+			}
+			p = SkipSpace(p + 1, pEnd);
+		}
+	}
+
+	// Index the members of one track object at p. Return the position after '}'.
+	const char* IndexTrack(const char* pData, const char* p, const char* pEnd, size_t pTrack,
+		size_t pChunkBytes, std::vector<PoseChunk>& pChunks)
+	{
+		p = SkipSpace(p + 1, pEnd);
+		if (p < pEnd && *p == '}')
+			return p + 1;
+
+		for (bool lDone = false; !lDone;)
+		{
+			const char* lKey;
+			size_t lKeyLength;
+			p = ReadKey(p, pEnd, lKey, lKeyLength);
+			if (!p || p >= pEnd)
+				return NULL;
+
+			if (*p == '[' && KeyIs(lKey, lKeyLength, "poses", 5))
+				p = IndexPoses(pData, p, pEnd, pTrack, pChunkBytes, pChunks);
+			else
+				p = SkipValue(p, pEnd);
+			if (!p)
+				return NULL;
+
+			p = NextMember(p, pEnd, lDone);
+			if (!p)
+				return NULL;
+		}
+		return p;
+	}
+
+	inline bool IsNumberStart(char c)
+	{
+		return c == '-' || (c >= '0' && c <= '9');
+	}
+
+	// Parse {"x":..,"y":..,"z":..} at p into component i of the three arrays.
+	const char* ParseVector(const char* p, const char* pEnd, size_t i,
+		std::vector<float>& pX, std::vector<float>& pY, std::vector<float>& pZ)
+	{
+		p = SkipSpace(p + 1, pEnd);
+		if (p < pEnd && *p == '}')
+			return p + 1;
+
+		for (bool lDone = false; !lDone;)
+		{
+			const char* lKey;
+			size_t lKeyLength;
+			p = ReadKey(p, pEnd, lKey, lKeyLength);
+			if (!p || p >= pEnd)
+				return NULL;
+
+			std::vector<float>* lComponent = NULL;
+			if (lKeyLength == 1)
+			{
+				if (*lKey == 'x')
+					lComponent = &pX;
+				else if (*lKey == 'y')
+					lComponent = &pY;
+				else if (*lKey == 'z')
+					lComponent = &pZ;
+			}
+
+			if (lComponent && IsNumberStart(*p))
+				p = ParseJsonNumber(p, pEnd, (*lComponent)[i]);
+			else
+				p = SkipValue(p, pEnd);
+			if (!p)
+				return NULL;
+
+			p = NextMember(p, pEnd, lDone);
+			if (!p)
+				return NULL;
+		}
+		return p;
+	}
+
+	// Parse one pose object at p and append it to pTrack.
+	const char* ParsePose(const char* p, const char* pEnd, PoseTrack& pTrack)
+	{
+		size_t i = pTrack.AddPose();
+
+		p = SkipSpace(p + 1, pEnd);
+		if (p < pEnd && *p == '}')
+			return p + 1;
+
+		for (bool lDone = false; !lDone;)
+		{
+			const char* lKey;
+			size_t lKeyLength;
+			p = ReadKey(p, pEnd, lKey, lKeyLength);
+			if (!p || p >= pEnd)
+				return NULL;
+
+			if (*p == '{' && KeyIs(lKey, lKeyLength, "position", 8))
+			{
+				p = ParseVector(p, pEnd, i, pTrack.mPositionX, pTrack.mPositionY, pTrack.mPositionZ);
+			}
+			else if (*p == '{' && KeyIs(lKey, lKeyLength, "rotation", 8))
+			{
+				p = ParseVector(p, pEnd, i, pTrack.mRotationX, pTrack.mRotationY, pTrack.mRotationZ);
+			}
+			else if (IsNumberStart(*p) && KeyIs(lKey, lKeyLength, "timestamp", 9))
+			{
+				p = ParseJsonTimestamp(p, pEnd, pTrack.mTimestamp[i]);
+			}
+			else
+			{
+				p = SkipValue(p, pEnd);
+			}
+			if (!p)
+				return NULL;
+
+			p = NextMember(p, pEnd, lDone);
+			if (!p)
+				return NULL;
+		}
+		return p;
+	}
+
+	// Parse all pose objects of a chunk into pTrack.
+	bool ParseChunk(const char* pData, const PoseChunk& pChunk, PoseTrack& pTrack)
+	{
+		const char* p = pData + pChunk.mBegin;
+		const char* lEnd = pData + pChunk.mEnd;
+
+		// a pose averages well over 100 bytes
+		pTrack.Reserve((pChunk.mEnd - pChunk.mBegin) / 128);
+
+		while (p < lEnd)
+		{
+			p = SkipSpace(p, lEnd);
+			if (p >= lEnd)
+				break;
+
+			if (*p == ',')
+				p++;
+			else if (*p == '{')
+				p = ParsePose(p, lEnd, pTrack);
+			else
+				p = SkipValue(p, lEnd);
+
+			if (!p)
+				return false;
+		}
+		return true;
+	}
+
+	template <typename T>
+	void AppendAndRelease(std::vector<T>& pTo, std::vector<T>& pFrom)
+	{
+		pTo.insert(pTo.end(), pFrom.begin(), pFrom.end());
+		std::vector<T>().swap(pFrom);
+	}
+}
+
+bool IndexPoseChunks(const char* pData, size_t pSize, size_t pChunkBytes,
+	PoseRecording& pRecording, std::vector<PoseChunk>& pChunks)
+{
+	const char* lEnd = pData + pSize;
+	const char* p = SkipSpace(pData, lEnd);
+
+	// optional UTF-8 byte order mark, as accepted by the JSON parser
+	if (lEnd - p >= 3 && memcmp(p, "\xEF\xBB\xBF", 3) == 0)
+		p = SkipSpace(p + 3, lEnd);
+
+	if (p >= lEnd || *p != '{')
+		return false;
+
+	p = SkipSpace(p + 1, lEnd);
+	if (p < lEnd && *p == '}')
+		return SkipSpace(p + 1, lEnd) == lEnd;
+
+	for (bool lDone = false; !lDone;)
+	{
+		const char* lKey;
+		size_t lKeyLength;
+		p = ReadKey(p, lEnd, lKey, lKeyLength);
+		if (!p || p >= lEnd)
+			return false;
+
+		if (*p == '{')
+		{
+			PoseTrack& lTrackRef = pRecording.GetOrAddTrack(std::string(lKey, lKeyLength));
+			size_t lTrack = size_t(&lTrackRef - &pRecording.mTracks[0]);
+			p = IndexTrack(pData, p, lEnd, lTrack, pChunkBytes, pChunks);
+		}
+		else
+		{
+			p = SkipValue(p, lEnd);
+		}
+		if (!p)
+			return false;
+
+		p = NextMember(p, lEnd, lDone);
+		if (!p)
+			return false;
+	}
+
+	return SkipSpace(p, lEnd) == lEnd;
+}
+
+bool ReadPoseRecordingParallel(const char* pData, size_t pSize, PoseRecording& pRecording,
+	unsigned pThreadCount)
+{
+	if (pThreadCount == 0)
+		pThreadCount = std::thread::hardware_concurrency();
+	if (pThreadCount == 0)
+		pThreadCount = 1;
+
+	size_t lChunkBytes = pSize / (pThreadCount * kChunksPerThread);
+	if (lChunkBytes < kMinChunkBytes)
+		lChunkBytes = kMinChunkBytes;
+
+	// phase 1: structural index
+	std::vector<PoseChunk> lChunks;
+	bool lIndexed;
+	{
+		TRACE_SPAN("IndexPoseChunks");
+		lIndexed = IndexPoseChunks(pData, pSize, lChunkBytes, pRecording, lChunks);
+	}
+	if (!lIndexed)
+	{
+		TRACE_SPAN("ReadPoseRecording");
+		pRecording.mTracks.clear();
+		return ReadPoseRecording(pData, pSize, pRecording);
+	}
+
+	// phase 2: parse the chunks concurrently, each into its own buffer
+	std::vector<PoseTrack> lParts(lChunks.size());
+	std::atomic<size_t> lNext(0);
+	std::atomic<bool> lFailed(false);
+
+	auto lWorker = [&]()
+	{
+		for (size_t i = lNext++; i < lChunks.size() && !lFailed; i = lNext++)
+		{
+			TRACE_SPAN("ParseChunk");
+			if (!ParseChunk(pData, lChunks[i], lParts[i]))
+				lFailed = true;
+		}
+	};
+
+	std::vector<std::thread> lThreads;
+	unsigned lExtraThreads = unsigned(std::min<size_t>(pThreadCount, lChunks.size()));
+	for (unsigned i = 1; i < lExtraThreads; i++)
+		lThreads.push_back(std::thread(lWorker));
+	lWorker();
+	for (size_t i = 0; i < lThreads.size(); i++)
+		lThreads[i].join();
+
+	if (lFailed)
+	{
+		TRACE_SPAN("ReadPoseRecording");
+		pRecording.mTracks.clear();
+		return ReadPoseRecording(pData, pSize, pRecording);
+	}
+
+	// concatenate the chunks of every track in file order
+	TRACE_SPAN("ConcatenateChunks");
+	std::vector<size_t> lPoseCounts(pRecording.mTracks.size(), 0);
+	for (size_t i = 0; i < lChunks.size(); i++)
+		lPoseCounts[lChunks[i].mTrack] += lParts[i].Size();
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+		pRecording.mTracks[t].Reserve(lPoseCounts[t]);
+
+	for (size_t i = 0; i < lChunks.size(); i++)
+	{
+		PoseTrack& lTrack = pRecording.mTracks[lChunks[i].mTrack];
+		PoseTrack& lPart = lParts[i];
+		AppendAndRelease(lTrack.mTimestamp, lPart.mTimestamp);
+		AppendAndRelease(lTrack.mPositionX, lPart.mPositionX);
+		AppendAndRelease(lTrack.mPositionY, lPart.mPositionY);
+		AppendAndRelease(lTrack.mPositionZ, lPart.mPositionZ);
+		AppendAndRelease(lTrack.mRotationX, lPart.mRotationX);
+		AppendAndRelease(lTrack.mRotationY, lPart.mRotationY);
+		AppendAndRelease(lTrack.mRotationZ, lPart.mRotationZ);
+	}
+
+	return CheckPoseTimestamps(pRecording);
+}
@@ -0,0 +1,31 @@
+#ifndef _PARALLEL_INGEST_H
+#define _PARALLEL_INGEST_H
+
+#include "PoseBuffer.h"
+
+// Byte range of a run of complete pose objects inside one track's "poses" array.
+struct PoseChunk
+{
+	size_t mTrack;		// index into PoseRecording::mTracks
+	size_t mBegin;		// offset of the first byte of the range
+	size_t mEnd;		// offset one past the last byte of the range
+};
+
+// Structural scan of a recording: walks the document once without
+// interpreting any values, adds every track to pRecording (without poses)
+// and splits each "poses" array into chunks of about pChunkBytes bytes that
+// start and end on pose object boundaries. Return false if the document
+// does not have the expected shape.
+bool IndexPoseChunks(const char* pData, size_t pSize, size_t pChunkBytes,
+	PoseRecording& pRecording, std::vector<PoseChunk>& pChunks);
+
+// Parse a recording with pThreadCount threads (0 = one per hardware thread):
+// the poses arrays are indexed with IndexPoseChunks, the chunks are parsed
+// concurrently into separate buffers and then appended to their tracks in
+// file order. Falls back to the single threaded ReadPoseRecording if the
+// document cannot be indexed or a chunk does not parse, so errors are
+// reported the same way.
+bool ReadPoseRecordingParallel(const char* pData, size_t pSize, PoseRecording& pRecording,
+	unsigned pThreadCount = 0);
+
+#endif // #ifndef _PARALLEL_INGEST_H
@@ -0,0 +1,285 @@
+#include "PoseBuffer.h"
+#include "FastNumber.h"
+#include "nlohmann/json.hpp"
+
+#include <cstdio>
+#include <functional>
+
+using json = nlohmann::json;
+
+PoseTrack::PoseTrack()
+	: mFrameRate(0.0)
+{
+}
+
+size_t PoseTrack::AddPose()
+{
+	mTimestamp.push_back(0);
+	mPositionX.push_back(0.0f);
+	mPositionY.push_back(0.0f);
+	mPositionZ.push_back(0.0f);
+	mRotationX.push_back(0.0f);
+	mRotationY.push_back(0.0f);
+	mRotationZ.push_back(0.0f);
+	return mTimestamp.size() - 1;
+}
+
+void PoseTrack::Reserve(size_t pCount)
+{
+	mTimestamp.reserve(pCount);
+	mPositionX.reserve(pCount);
+	mPositionY.reserve(pCount);
+	mPositionZ.reserve(pCount);
+	mRotationX.reserve(pCount);
+	mRotationY.reserve(pCount);
+	mRotationZ.reserve(pCount);
+}
+
+void PoseTrack::Clear()
+{
+	mTimestamp.clear();
+	mPositionX.clear();
+	mPositionY.clear();
+	mPositionZ.clear();
+	mRotationX.clear();
+	mRotationY.clear();
+	mRotationZ.clear();
+	mKeyTime.clear();
+	mFrameRate = 0.0;
+}
+
+const PoseTrack* PoseRecording::FindTrack(const std::string& pName) const
+{
+	for (size_t i = 0; i < mTracks.size(); i++)
+	{
+		if (mTracks[i].mName == pName)
+			return &mTracks[i];
+	}
+	return NULL;
+}
+
+PoseTrack* PoseRecording::FindTrack(const std::string& pName)
+{
+	for (size_t i = 0; i < mTracks.size(); i++)
+	{
+		if (mTracks[i].mName == pName)
+			return &mTracks[i];
+	}
+	return NULL;
+}
+
+PoseTrack& PoseRecording::GetOrAddTrack(const std::string& pName)
+{
+	PoseTrack* lTrack = FindTrack(pName);
+	if (lTrack)
+		return *lTrack;
+
+	mTracks.push_back(PoseTrack());
+	mTracks.back().mName = pName;
+	return mTracks.back();
+}
+
+size_t PoseRecording::PoseCount() const
+{
+	size_t lCount = 0;
+	for (size_t i = 0; i < mTracks.size(); i++)
+		lCount += mTracks[i].Size();
+	return lCount;
+}
+
+namespace
+{
+	// Nesting depths reported by the parser callback for the recording schema:
+	// { "<track>": { "poses": [ { "position": { "x": ... }, "timestamp": ... } ] } }
+	enum
+	{
+		eDepthRoot = 0,
+		eDepthTrack = 1,
+		eDepthTrackMember = 2,
+		eDepthPose = 3,
+		eDepthPoseMember = 4,
+		eDepthComponent = 5
+	};
+
+	// Receives parser events and copies pose values into a PoseRecording.
+	// Every object, array and value is reported as discarded once it has been
+	// read, so the parser never holds more than the value being parsed.
+	// Start events are always accepted: rejecting them makes json 3.1.1 lose
+	// track of the nesting depth for the rest of the document.
+	class PoseIngestHandler
+	{
+	public:
+		explicit PoseIngestHandler(PoseRecording& pRecording)
+			: mRecording(pRecording), mTrack(NULL), mInPoses(false), mPose(0), mMember(eMemberNone),
+			mTimestampOutOfRange(false)
+		{
+			mKeys.resize(eDepthComponent + 1);
+		}
+
+		bool operator()(int pDepth, json::parse_event_t pEvent, json& pParsed)
+		{
+			switch (pEvent)
+			{
+			case json::parse_event_t::key:
+				if (pDepth <= eDepthComponent)
+					mKeys[pDepth] = pParsed.get<std::string>();
+				return true;
+
+			case json::parse_event_t::object_start:
+				BeginObject(pDepth);
+				return true;
+
+			case json::parse_event_t::array_start:
+				// only the "poses" array of a track is of interest
+				if (pDepth == eDepthTrackMember && mTrack && mKeys[eDepthTrackMember] == "poses")
+					mInPoses = true;
+				return true;
+
+			case json::parse_event_t::object_end:
+				if (pDepth == eDepthTrack)
+					mTrack = NULL;
+				else if (pDepth == eDepthPoseMember)
+					mMember = eMemberNone;
+				return pDepth == eDepthRoot;
+
+			case json::parse_event_t::array_end:
+				if (pDepth == eDepthTrackMember)
+					mInPoses = false;
+				return false;
+
+			case json::parse_event_t::value:
+				if (mInPoses)
+					StoreValue(pDepth, pParsed);
+				return pDepth == eDepthRoot;
+			}
+			return false;
+		}
+
+		// A timestamp does not fit the microsecond range of PoseTrack.
+		bool TimestampOutOfRange() const { return mTimestampOutOfRange; }
+
+	private:
+		void BeginObject(int pDepth)
+		{
+			if (pDepth == eDepthTrack)
+			{
+				mTrack = &mRecording.GetOrAddTrack(mKeys[eDepthTrack]);
+			}
+			else if (pDepth == eDepthPose && mInPoses)
+			{
+				mPose = mTrack->AddPose();
+			}
+			else if (pDepth == eDepthPoseMember && mInPoses)
+			{
+				if (mKeys[eDepthPoseMember] == "position")
+					mMember = eMemberPosition;
+				else if (mKeys[eDepthPoseMember] == "rotation")
+					mMember = eMemberRotation;
+			}
+		}
+
+		void StoreValue(int pDepth, const json& pParsed)
+		{
+			if (!pParsed.is_number())
+				return;
+
+			if (pDepth == eDepthPoseMember && mKeys[eDepthPoseMember] == "timestamp")
+			{
+				// milliseconds to microseconds, the same way as ParseJsonTimestamp()
+				int64_t& lTimestamp = mTrack->mTimestamp[mPose];
+				bool lInRange;
+				if (pParsed.is_number_unsigned())
+					lInRange = pParsed.get<uint64_t>() <= uint64_t(INT64_MAX) && MillisecondsToMicroseconds(pParsed.get<int64_t>(), lTimestamp);
+				else if (pParsed.is_number_integer())
+					lInRange = MillisecondsToMicroseconds(pParsed.get<int64_t>(), lTimestamp);
+				else
+					lInRange = MillisecondsToMicroseconds(pParsed.get<double>(), lTimestamp);
+				if (!lInRange)
+					mTimestampOutOfRange = true;
+			}
+			else if (pDepth == eDepthComponent && mMember != eMemberNone)
+			{
+				const std::string& lAxis = mKeys[eDepthComponent];
+				bool lPosition = mMember == eMemberPosition;
+				float lValue = pParsed.get<float>();
+				if (lAxis == "x")
+					(lPosition ? mTrack->mPositionX : mTrack->mRotationX)[mPose] = lValue;
+				else if (lAxis == "y")
+					(lPosition ? mTrack->mPositionY : mTrack->mRotationY)[mPose] = lValue;
+				else if (lAxis == "z")
+					(lPosition ? mTrack->mPositionZ : mTrack->mRotationZ)[mPose] = lValue;
+			}
+		}
+
+		PoseRecording& mRecording;
+		PoseTrack* mTrack;
+		bool mInPoses;
+		size_t mPose;
+		enum { eMemberNone, eMemberPosition, eMemberRotation } mMember;
+		std::vector<std::string> mKeys;
+		bool mTimestampOutOfRange;
+	};
+
+	bool CheckTimestamps(const PoseIngestHandler& pHandler)
+	{
+		if (!pHandler.TimestampOutOfRange())
+			return true;
+		printf("Error: Unable to parse recording: timestamp out of range\n");
+		return false;
+	}
+}
+
+bool ReadPoseRecording(std::istream& pStream, PoseRecording& pRecording)
+{
+	PoseIngestHandler lHandler(pRecording);
+
+	try
+	{
+		json::parse(pStream, std::ref(lHandler));
+	}
+	catch (const json::exception& e)
+	{
+		printf("Error: Unable to parse recording: %s\n", e.what());
+		return false;
+	}
+
+	return CheckTimestamps(lHandler) && CheckPoseTimestamps(pRecording);
+}
+
+bool ReadPoseRecording(const char* pData, size_t pSize, PoseRecording& pRecording)
+{
+	PoseIngestHandler lHandler(pRecording);
+
+	try
+	{
+		json::parse(pData, pData + pSize, std::ref(lHandler));
+	}
+	catch (const json::exception& e)
+	{
+		printf("Error: Unable to parse recording: %s\n", e.what());
+		return false;
+	}
+
+	return CheckTimestamps(lHandler) && CheckPoseTimestamps(pRecording);
+}
+
+bool CheckPoseTimestamps(const PoseRecording& pRecording)
+{
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+	{
+		const PoseTrack& lTrack = pRecording.mTracks[t];
+		size_t i = 0;
+		while (i < lTrack.Size() && lTrack.mTimestamp[i] == 0)
+			i++;
+		for (; i < lTrack.Size(); i++)
+		{
+			if (lTrack.mTimestamp[i] == 0)
+			{
+				printf("Error: Unable to parse recording: pose %u of track '%s' has no timestamp\n",
+					unsigned(i), lTrack.mName.c_str());
+				return false;
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,77 @@
+#ifndef _POSE_BUFFER_H
+#define _POSE_BUFFER_H
+
+#include <stdint.h>
+#include <istream>
+#include <string>
+#include <vector>
+
+// Timestamps are kept in integer microseconds: the recorded milliseconds
+// with up to three decimals.
+const int64_t kMicrosecondsPerMillisecond = 1000;
+
+// Structure-of-arrays storage for the poses of one tracked device
+// ("camera", "left", "right", ...). Index i of every array belongs to pose i.
+struct PoseTrack
+{
+	std::string mName;
+
+	std::vector<int64_t> mTimestamp;	// microseconds
+
+	std::vector<float> mPositionX;
+	std::vector<float> mPositionY;
+	std::vector<float> mPositionZ;
+
+	std::vector<float> mRotationX;
+	std::vector<float> mRotationY;
+	std::vector<float> mRotationZ;
+
+	// Frames per second if the poses lie on a uniform frame grid (see
+	// ResampleTrack), 0 if they keep their recorded times.
+	double mFrameRate;
+
+	// Key time of every pose in FBX ticks since the start of the session,
+	// filled by BuildTimeline() once all tracks are final (see KeyTime.h).
+	std::vector<int64_t> mKeyTime;
+
+	PoseTrack();
+
+	size_t Size() const { return mTimestamp.size(); }
+
+	// Append a pose with all components zeroed and return its index.
+	size_t AddPose();
+
+	void Reserve(size_t pCount);
+	void Clear();
+};
+
+// All tracks of a recording, in the order they appear in the input.
+struct PoseRecording
+{
+	std::vector<PoseTrack> mTracks;
+
+	// Return the track with the given name, or NULL if the recording has none.
+	const PoseTrack* FindTrack(const std::string& pName) const;
+	PoseTrack* FindTrack(const std::string& pName);
+
+	// Return the track with the given name, appending an empty one if needed.
+	PoseTrack& GetOrAddTrack(const std::string& pName);
+
+	size_t PoseCount() const;
+};
+
+// Parse an A-Frame motion capture recording into pRecording without building
+// a JSON document. Only "timestamp", "position" and "rotation" of each pose
+// are kept; every other value is dropped as soon as it has been read.
+bool ReadPoseRecording(std::istream& pStream, PoseRecording& pRecording);
+
+// Same as above, parsing directly from a block of memory (e.g. an InputFile).
+bool ReadPoseRecording(const char* pData, size_t pSize, PoseRecording& pRecording);
+
+// True if every pose after the first stamped one of its track has a
+// timestamp of its own, otherwise print an error. Poses before it may lack
+// one (they take its time, see GetTrackStart); a gap later in the track has
+// no time to take. Both JSON parsers end with this check.
+bool CheckPoseTimestamps(const PoseRecording& pRecording);
+
+#endif // #ifndef _POSE_BUFFER_H
@@ -0,0 +1,291 @@
+#include "Resample.h"
+#include "KeyTime.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+	#include <xmmintrin.h>
+	#define RESAMPLE_SSE
+#endif
+
+namespace
+{
+	// about a day at 1000 fps; longer grids come from bogus timestamps
+	const double kMaxFrameCount = 1e8;
+
+	const double kDegreesToRadians = 3.14159265358979323846 / 180.0;
+	const double kRadiansToDegrees = 180.0 / 3.14159265358979323846;
+
+	// Euler XYZ (X applied first, R = Rz * Ry * Rx) in degrees to a unit quaternion.
+	void EulerToQuaternion(double pX, double pY, double pZ, float& pQw, float& pQx, float& pQy, float& pQz)
+	{
+		double lHalfX = pX * kDegreesToRadians * 0.5;
+		double lHalfY = pY * kDegreesToRadians * 0.5;
+		double lHalfZ = pZ * kDegreesToRadians * 0.5;
+		double cx = cos(lHalfX), sx = sin(lHalfX);
+		double cy = cos(lHalfY), sy = sin(lHalfY);
+		double cz = cos(lHalfZ), sz = sin(lHalfZ);
+
+		pQw = float(cx * cy * cz + sx * sy * sz);
+		pQx = float(sx * cy * cz - cx * sy * sz);
+		pQy = float(cx * sy * cz + sx * cy * sz);
+		pQz = float(cx * cy * sz - sx * sy * cz);
+	}
+
+	// Add the multiple of 360 degrees to pAngle that brings it closest to pReference.
+	double Unwrap(double pAngle, double pReference)
+	{
+		return pAngle + 360.0 * floor((pReference - pAngle) / 360.0 + 0.5);
+	}
+
+	// Inverse of EulerToQuaternion. A rotation has two Euler XYZ solutions
+	// (plus any multiple of 360 degrees per angle); return the one closest to
+	// the reference angles so consecutive frames do not flip or wrap.
+	void QuaternionToEuler(double pQw, double pQx, double pQy, double pQz,
+		const double* pReference, double* pEuler)
+	{
+		double lSinY = 2.0 * (pQw * pQy - pQz * pQx);
+		if (lSinY > 1.0)
+			lSinY = 1.0;
+		else if (lSinY < -1.0)
+			lSinY = -1.0;
+
+		double lX = atan2(2.0 * (pQw * pQx + pQy * pQz), 1.0 - 2.0 * (pQx * pQx + pQy * pQy)) * kRadiansToDegrees;
+		double lY = asin(lSinY) * kRadiansToDegrees;
+		double lZ = atan2(2.0 * (pQw * pQz + pQx * pQy), 1.0 - 2.0 * (pQy * pQy + pQz * pQz)) * kRadiansToDegrees;
+
+		double lFirst[3] = { Unwrap(lX, pReference[0]), Unwrap(lY, pReference[1]), Unwrap(lZ, pReference[2]) };
+		double lSecond[3] = { Unwrap(lX + 180.0, pReference[0]), Unwrap(180.0 - lY, pReference[1]), Unwrap(lZ + 180.0, pReference[2]) };
+
+		double lFirstDistance = 0.0, lSecondDistance = 0.0;
+		for (int c = 0; c < 3; c++)
+		{
+			lFirstDistance += fabs(lFirst[c] - pReference[c]);
+			lSecondDistance += fabs(lSecond[c] - pReference[c]);
+		}
+
+		const double* lBest = lFirstDistance <= lSecondDistance ? lFirst : lSecond;
+		for (int c = 0; c < 3; c++)
+			pEuler[c] = lBest[c];
+	}
+
+	// Copy the samples on both sides of every frame into contiguous arrays
+	// so the interpolation itself only streams through memory.
+	void Gather(const float* pValues, const std::vector<size_t>& pIndex, size_t pStride,
+		float* pLow, float* pHigh)
+	{
+		for (size_t i = 0; i < pIndex.size(); i++)
+		{
+			pLow[i] = pValues[pIndex[i]];
+			pHigh[i] = pValues[pIndex[i] + pStride];
+		}
+	}
+}
+
+void LerpArrays(const float* pA, const float* pB, const float* pWeight, float* pResult, size_t pCount)
+{
+	size_t i = 0;
+
+#ifdef RESAMPLE_SSE
+	for (; i + 4 <= pCount; i += 4)
+	{
+		__m128 lA = _mm_loadu_ps(pA + i);
+		__m128 lB = _mm_loadu_ps(pB + i);
+		__m128 lWeight = _mm_loadu_ps(pWeight + i);
+		_mm_storeu_ps(pResult + i, _mm_add_ps(lA, _mm_mul_ps(lWeight, _mm_sub_ps(lB, lA))));
+	}
+#endif
+
+	for (; i < pCount; i++)
+		pResult[i] = pA[i] + pWeight[i] * (pB[i] - pA[i]);
+}
+
+void SlerpArrays(const float* const* pA, const float* const* pB, const float* pWeight,
+	float* const* pResult, size_t pCount)
+{
+	const float* lAw = pA[0]; const float* lAx = pA[1]; const float* lAy = pA[2]; const float* lAz = pA[3];
+	const float* lBw = pB[0]; const float* lBx = pB[1]; const float* lBy = pB[2]; const float* lBz = pB[3];
+
+	for (size_t i = 0; i < pCount; i++)
+	{
+		double lDot = double(lAw[i]) * lBw[i] + double(lAx[i]) * lBx[i] + double(lAy[i]) * lBy[i] + double(lAz[i]) * lBz[i];
+
+		// q and -q are the same rotation, take the shorter arc
+		double lSign = 1.0;
+		if (lDot < 0.0)
+		{
+			lDot = -lDot;
+			lSign = -1.0;
+		}
+
+		double lWeightA, lWeightB;
+		double lWeight = pWeight[i];
+		if (lDot > 0.9995)
+		{
+			// nearly parallel: sin(theta) vanishes, lerp and renormalize below
+			lWeightA = 1.0 - lWeight;
+			lWeightB = lWeight;
+		}
+		else
+		{
+			double lTheta = acos(lDot);
+			double lInvSin = 1.0 / sin(lTheta);
+			lWeightA = sin((1.0 - lWeight) * lTheta) * lInvSin;
+			lWeightB = sin(lWeight * lTheta) * lInvSin;
+		}
+		lWeightB *= lSign;
+
+		double lW = lWeightA * lAw[i] + lWeightB * lBw[i];
+		double lX = lWeightA * lAx[i] + lWeightB * lBx[i];
+		double lY = lWeightA * lAy[i] + lWeightB * lBy[i];
+		double lZ = lWeightA * lAz[i] + lWeightB * lBz[i];
+		double lInvLength = 1.0 / sqrt(lW * lW + lX * lX + lY * lY + lZ * lZ);
+
+		pResult[0][i] = float(lW * lInvLength);
+		pResult[1][i] = float(lX * lInvLength);
+		pResult[2][i] = float(lY * lInvLength);
+		pResult[3][i] = float(lZ * lInvLength);
+	}
+}
+
+bool ResampleTrack(const PoseTrack& pSource, double pFrameRate, int64_t pGridOrigin, PoseTrack& pResult)
+{
+	if (!(pFrameRate > 0.0))
+		return false;
+
+	pResult.Clear();
+	pResult.mName = pSource.mName;
+	pResult.mFrameRate = pFrameRate;
+
+	size_t lPoseCount = pSource.Size();
+	if (lPoseCount == 0)
+		return true;
+
+	const std::vector<int64_t>& lTimestamp = pSource.mTimestamp;
+	double lFrameDuration = double(kMicrosecondsPerMillisecond * 1000) / pFrameRate;
+
+	// poses before the first stamped one (timestamp 0, see GetTrackStart)
+	// take its values; a track that was never stamped is one frame at the origin
+	size_t lFirst = 0;
+	while (lFirst + 1 < lPoseCount && lTimestamp[lFirst] == 0)
+		lFirst++;
+	int64_t lFirstTime = lTimestamp[lFirst] != 0 ? lTimestamp[lFirst] : pGridOrigin;
+
+	// the first frame of the grid at or after the first stamped pose
+	double lFirstFrame = std::ceil(double(lFirstTime - pGridOrigin) / lFrameDuration - 1e-9);
+	double lStart = double(pGridOrigin) + lFirstFrame * lFrameDuration;
+	double lEnd = double(lTimestamp[lPoseCount - 1]);
+	double lDuration = lEnd > lStart ? lEnd - lStart : 0.0;
+	double lFrames = lDuration / lFrameDuration + 1e-9;
+	// written so that a NaN (from a frame rate that is not finite) fails too
+	if (!(lFrames < kMaxFrameCount))
+	{
+		printf("Error: Resampling track '%s' at %g fps would give %.0f frames (at most %.0f)\n",
+			pSource.mName.c_str(), pFrameRate, lFrames, kMaxFrameCount);
+		return false;
+	}
+	size_t lFrameCount = size_t(lFrames) + 1;
+
+	// source segment and interpolation weight of every frame
+	std::vector<size_t> lIndex(lFrameCount);
+	std::vector<float> lWeight(lFrameCount);
+	size_t lStride = lPoseCount - lFirst > 1 ? 1 : 0;
+	size_t lSegment = lFirst;
+	for (size_t f = 0; f < lFrameCount; f++)
+	{
+		double lTime = lStart + double(f) * lFrameDuration;
+		while (lSegment + 2 < lPoseCount && double(lTimestamp[lSegment + 1]) <= lTime)
+			lSegment++;
+
+		float lFraction = 0.0f;
+		if (lStride)
+		{
+			double lSpan = double(lTimestamp[lSegment + 1] - lTimestamp[lSegment]);
+			double lOffset = lTime - double(lTimestamp[lSegment]);
+			lFraction = lSpan > 0.0 ? float(lOffset / lSpan) : 1.0f;
+			if (lFraction < 0.0f)
+				lFraction = 0.0f;
+			else if (lFraction > 1.0f)
+				lFraction = 1.0f;
+		}
+
+		lIndex[f] = lSegment;
+		lWeight[f] = lFraction;
+	}
+
+	pResult.mTimestamp.resize(lFrameCount);
+	for (size_t f = 0; f < lFrameCount; f++)
+		pResult.mTimestamp[f] = pGridOrigin + int64_t(floor((lFirstFrame + double(f)) * lFrameDuration + 0.5));
+
+	std::vector<float> lLow(lFrameCount), lHigh(lFrameCount);
+
+	// positions: linear
+	const std::vector<float>* lSourcePosition[] = { &pSource.mPositionX, &pSource.mPositionY, &pSource.mPositionZ };
+	std::vector<float>* lResultPosition[] = { &pResult.mPositionX, &pResult.mPositionY, &pResult.mPositionZ };
+	for (int c = 0; c < 3; c++)
+	{
+		lResultPosition[c]->resize(lFrameCount);
+		Gather(&(*lSourcePosition[c])[0], lIndex, lStride, &lLow[0], &lHigh[0]);
+		LerpArrays(&lLow[0], &lHigh[0], &lWeight[0], &(*lResultPosition[c])[0], lFrameCount);
+	}
+
+	// rotations: slerp between the quaternions of the source poses
+	std::vector<float> lQuaternion[4];
+	for (int c = 0; c < 4; c++)
+		lQuaternion[c].resize(lPoseCount);
+	for (size_t i = 0; i < lPoseCount; i++)
+		EulerToQuaternion(pSource.mRotationX[i], pSource.mRotationY[i], pSource.mRotationZ[i],
+			lQuaternion[0][i], lQuaternion[1][i], lQuaternion[2][i], lQuaternion[3][i]);
+
+	std::vector<float> lLowQuaternion[4], lHighQuaternion[4], lResultQuaternion[4];
+	const float* lLowArrays[4];
+	const float* lHighArrays[4];
+	float* lResultArrays[4];
+	for (int c = 0; c < 4; c++)
+	{
+		lLowQuaternion[c].resize(lFrameCount);
+		lHighQuaternion[c].resize(lFrameCount);
+		lResultQuaternion[c].resize(lFrameCount);
+		Gather(&lQuaternion[c][0], lIndex, lStride, &lLowQuaternion[c][0], &lHighQuaternion[c][0]);
+		lLowArrays[c] = &lLowQuaternion[c][0];
+		lHighArrays[c] = &lHighQuaternion[c][0];
+		lResultArrays[c] = &lResultQuaternion[c][0];
+	}
+	SlerpArrays(lLowArrays, lHighArrays, &lWeight[0], lResultArrays, lFrameCount);
+
+	pResult.mRotationX.resize(lFrameCount);
+	pResult.mRotationY.resize(lFrameCount);
+	pResult.mRotationZ.resize(lFrameCount);
+
+	// the first frame follows the recorded angles, every other frame the previous one
+	double lReference[3] = { pSource.mRotationX[lFirst], pSource.mRotationY[lFirst], pSource.mRotationZ[lFirst] };
+	for (size_t f = 0; f < lFrameCount; f++)
+	{
+		double lEuler[3];
+		QuaternionToEuler(lResultArrays[0][f], lResultArrays[1][f], lResultArrays[2][f], lResultArrays[3][f],
+			lReference, lEuler);
+
+		pResult.mRotationX[f] = float(lEuler[0]);
+		pResult.mRotationY[f] = float(lEuler[1]);
+		pResult.mRotationZ[f] = float(lEuler[2]);
+		for (int c = 0; c < 3; c++)
+			lReference[c] = lEuler[c];
+	}
+
+	return true;
+}
+
+bool ResampleRecording(PoseRecording& pRecording, double pFrameRate)
+{
+	int64_t lOrigin = GetSessionOrigin(pRecording);
+	for (size_t t = 0; t < pRecording.mTracks.size(); t++)
+	{
+		PoseTrack lResampled;
+		if (!ResampleTrack(pRecording.mTracks[t], pFrameRate, lOrigin, lResampled))
+			return false;
+		std::swap(pRecording.mTracks[t], lResampled);
+	}
+	return true;
+}
@@ -0,0 +1,30 @@
+#ifndef _RESAMPLE_H
+#define _RESAMPLE_H
+
+#include "PoseBuffer.h"
+
+// Linear interpolation of whole arrays: pResult[i] = pA[i] + pWeight[i] * (pB[i] - pA[i]).
+// pResult may alias pA or pB.
+void LerpArrays(const float* pA, const float* pB, const float* pWeight, float* pResult, size_t pCount);
+
+// Spherical interpolation of whole arrays of unit quaternions stored as
+// separate w/x/y/z arrays. pA and pB hold 4 array pointers each (w, x, y, z),
+// results are written to the 4 arrays of pResult.
+void SlerpArrays(const float* const* pA, const float* const* pB, const float* pWeight,
+	float* const* pResult, size_t pCount);
+
+// Convert pSource onto a uniform grid of pFrameRate frames per second that
+// starts at pGridOrigin (microseconds); the first frame is the first one at
+// or after the first stamped pose (poses before it have timestamp 0 and take
+// its values). Positions are interpolated linearly, rotations (Euler XYZ
+// in degrees, the FBX default rotation order) with slerp and converted back to
+// angles that stay continuous from frame to frame.
+// Return false if pFrameRate is not positive or the grid would have an
+// absurd number of frames (reported as an error).
+bool ResampleTrack(const PoseTrack& pSource, double pFrameRate, int64_t pGridOrigin, PoseTrack& pResult);
+
+// Resample every track of pRecording in place, all on the grid that starts
+// at the session origin (see GetSessionOrigin), so their frames line up.
+bool ResampleRecording(PoseRecording& pRecording, double pFrameRate);
+
+#endif // #ifndef _RESAMPLE_H
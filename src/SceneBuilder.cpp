@@ -0,0 +1,382 @@
+#include "../Common/Common.h"
+#include "ConversionStats.h"
+#include "DeviceTemplates.h"
+#include "KeyTime.h"
+#include "MarkerTopology.h"
+#include "PoseBuffer.h"
+#include "SceneBuilder.h"
+
+bool CreateScene(FbxManager* pSdkManager, FbxScene* pScene, const PoseRecording& pRecording, ConversionStats& pStats,
+	bool pAnimationOnly, EDeviceTopology pTopology)
+{
+	if (!CheckKeyTimes(pRecording))
+		return false;
+
+	std::vector<SceneDevice> lDevices;
+	GetSceneDevices(pRecording, lDevices);
+
+	// create the root marker
+	FbxNode* lMarkerRoot = CreateMarker(pScene, "Root");
+	pScene->GetRootNode()->AddChild(lMarkerRoot);
+
+	// every device: position marker, rotation marker (or one node for both),
+	// mesh (and the camera)
+	MeshRegistry lMeshes(pScene);
+	FbxNode* lCamera = NULL;
+	std::vector<FbxNode*> lPositions(lDevices.size());
+	std::vector<FbxNode*> lRotations(lDevices.size());
+	for (size_t i = 0; i < lDevices.size(); i++)
+	{
+		const SceneDevice& lDevice = lDevices[i];
+		const DeviceTemplate& lTemplate = *lDevice.mTemplate;
+
+		FbxVector4 lMarkerRotation(lTemplate.mMarkerRotation[0], lTemplate.mMarkerRotation[1], lTemplate.mMarkerRotation[2]);
+		FbxNode* lPosition;
+		FbxNode* lRotation;
+		if (pTopology == eTopologySingleNode)
+		{
+			lPosition = lRotation = CreateMarker(pScene, (lDevice.mName + "Animation").c_str());
+			SetMarkerDefaultPosition(lPosition, lMarkerRotation);
+			lMarkerRoot->AddChild(lPosition);
+		}
+		else
+		{
+			lPosition = CreateMarker(pScene, (lDevice.mName + "PositionAnimation").c_str());
+			lRotation = CreateMarker(pScene, (lDevice.mName + "RotationAnimation").c_str());
+			SetMarkerDefaultPosition(lPosition, lMarkerRotation);
+			SetMarkerDefaultPosition(lRotation, FbxVector4(0, 0, 0));
+			lMarkerRoot->AddChild(lPosition);
+			lPosition->AddChild(lRotation);
+		}
+		lPositions[i] = lPosition;
+		lRotations[i] = lRotation;
+
+		if (pAnimationOnly)
+			continue;
+
+		if (lTemplate.mCamera && !lCamera)
+		{
+			lCamera = CreateCamera(pScene, "Camera");
+			SetCameraDefaultPosition(lCamera);
+			lRotation->AddChild(lCamera);
+		}
+
+		FbxNode* lMesh = lMeshes.CreatePyramid(("Mesh" + lDevice.mName).c_str(), lTemplate.mMeshSide, lTemplate.mMeshHeight, lTemplate.mMeshApexDown);
+		FbxVector4 lMeshLocation(lTemplate.mMeshTranslation[0], lTemplate.mMeshTranslation[1], lTemplate.mMeshTranslation[2]);
+		FbxVector4 lMeshRotation(lTemplate.mMeshRotation[0], lTemplate.mMeshRotation[1], lTemplate.mMeshRotation[2]);
+		SetMeshDefaultPosition(lMesh, lMeshLocation, lMeshRotation);
+		lRotation->AddChild(lMesh);
+	}
+
+    // Create one animation stack
+    FbxAnimStack* lAnimStack = FbxAnimStack::Create(pScene, "Stack001");
+
+    // this stack animation range is limited
+    lAnimStack->LocalStop = FBXSDK_TIME_ONE_HOUR;
+    lAnimStack->Description = "This is the animation stack description field.";
+
+    // all animation stacks need, at least, one layer.
+    FbxAnimLayer* lAnimLayer = FbxAnimLayer::Create(pScene, "Base Layer");	// the AnimLayer object name is "Base Layer"
+    lAnimStack->AddMember(lAnimLayer);											// add the layer to the stack
+
+	// animate the devices
+	{
+		StageTimer lTimer(pStats, eStageCurves);
+		for (size_t i = 0; i < lDevices.size(); i++)
+			AnimateTrack(lPositions[i], lRotations[i], lAnimLayer, *lDevices[i].mTrack);
+	}
+
+	// set camera switcher as the default camera
+	if (lCamera)
+		pScene->GetGlobalSettings().SetDefaultCamera((char *)lCamera->GetName());
+
+    return true;
+}
+
+bool CompareTopologies(FbxManager* pSdkManager, FbxScene* pSingle, const PoseRecording& pPairs, TopologyCheck& pCheck)
+{
+	FbxScene* lPairs = FbxScene::Create(pSdkManager, "Marker Pairs");
+	ConversionStats lStats;
+	if (!CreateScene(pSdkManager, lPairs, pPairs, lStats, true, eTopologyMarkerPairs))
+	{
+		lPairs->Destroy();
+		return false;
+	}
+
+	// evaluate the curves of the (only) animation stack of each scene
+	lPairs->SetCurrentAnimationStack(lPairs->GetSrcObject<FbxAnimStack>(0));
+	pSingle->SetCurrentAnimationStack(pSingle->GetSrcObject<FbxAnimStack>(0));
+
+	std::vector<SceneDevice> lDevices;
+	GetSceneDevices(pPairs, lDevices);
+
+	bool lResult = true;
+	FbxTime lTime;
+	for (size_t d = 0; d < lDevices.size(); d++)
+	{
+		const SceneDevice& lDevice = lDevices[d];
+		FbxNode* lPair = lPairs->FindNodeByName((lDevice.mName + "RotationAnimation").c_str());
+		FbxNode* lSingle = pSingle->FindNodeByName((lDevice.mName + "Animation").c_str());
+		if (!lPair || !lSingle)
+		{
+			FBXSDK_printf("Error: The scene has no %sAnimation node to compare\n", lDevice.mName.c_str());
+			lResult = false;
+			break;
+		}
+
+		const PoseTrack& lTrack = *lDevice.mTrack;
+		for (size_t i = 0; i < lTrack.Size(); i++)
+		{
+			lTime.Set(lTrack.mKeyTime[i]);
+			FbxQuaternion lPairRotation = lPair->EvaluateGlobalTransform(lTime).GetQ();
+			FbxQuaternion lSingleRotation = lSingle->EvaluateGlobalTransform(lTime).GetQ();
+
+			// angle of the rotation between the two, either sign of the quaternion
+			double lCos = fabs(lPairRotation.DotProduct(lSingleRotation));
+			double lError = 2.0 * acos(lCos < 1.0 ? lCos : 1.0) * FBXSDK_180_DIV_PI;
+			if (lError > pCheck.mMaxRotationError)
+				pCheck.mMaxRotationError = lError;
+		}
+		pCheck.mPoses += lTrack.Size();
+		pCheck.mDevices++;
+	}
+
+	lPairs->Destroy();
+	return lResult;
+}
+
+// Create a camera.
+FbxNode* CreateCamera(FbxScene* pScene, const char* pName)
+{
+	FbxCamera* lCamera = FbxCamera::Create(pScene, pName);
+
+	// Set camera property for a classic TV projection with aspect ratio 4:3
+	lCamera->SetFormat(FbxCamera::eHD);
+
+	FbxNode* lNode = FbxNode::Create(pScene, pName);
+
+	lNode->SetNodeAttribute(lCamera);
+
+	return lNode;
+}
+
+
+// Compute the camera position.
+void SetCameraDefaultPosition(FbxNode* pCamera)
+{
+	// set the initial camera position
+	FbxVector4 lCameraLocation(0.0, 0.0, 0.0);
+	pCamera->LclTranslation.Set(lCameraLocation);
+	pCamera->LclRotation.Set(FbxVector4(0,90,0));
+	pCamera->LclScaling.Set(FbxVector4(100.0, 100.0, 100.0));
+}
+
+// Compute the camera position.
+void SetMeshDefaultPosition(FbxNode* pMesh, FbxVector4& location, FbxVector4& rotation)
+{
+	pMesh->LclTranslation.Set(location);
+	pMesh->LclRotation.Set(rotation);
+	pMesh->LclScaling.Set(FbxVector4(1.0, 1.0, 1.0));
+}
+
+// Create the materials of the pyramid faces.
+void CreateMaterials(FbxScene* pScene, FbxSurfacePhong* pMaterials[kPyramidMaterialCount])
+{
+	int i;
+
+	for (i = 0; i < kPyramidMaterialCount; i++)
+	{
+		FbxString lMaterialName = "material";
+		FbxString lShadingName = "Phong";
+		lMaterialName += i;
+		FbxDouble3 lBlack(0.0, 0.0, 0.0);
+		FbxDouble3 lRed(1.0, 0.0, 0.0);
+		FbxDouble3 lColor;
+		FbxSurfacePhong *lMaterial = FbxSurfacePhong::Create(pScene, lMaterialName.Buffer());
+
+
+		// Generate primary and secondary colors.
+		lMaterial->Emissive.Set(lBlack);
+		lMaterial->Ambient.Set(lRed);
+		lColor = FbxDouble3(i > 2 ? 1.0 : 0.0,
+			i > 0 && i < 4 ? 1.0 : 0.0,
+			i % 2 ? 0.0 : 1.0);
+		lMaterial->Diffuse.Set(lColor);
+		lMaterial->TransparencyFactor.Set(0.0);
+		lMaterial->ShadingModel.Set(lShadingName);
+		lMaterial->Shininess.Set(0.5);
+
+		pMaterials[i] = lMaterial;
+	}
+}
+
+// Create a pyramid mesh, one material index per face. The right hand one
+// points down: its apex and normals are mirrored in y.
+FbxMesh* CreatePyramidMesh(FbxScene* pScene, const char* pName, const double& side, const double& height, bool pApexDown)
+{
+	int i, j;
+	FbxMesh* lMesh = FbxMesh::Create(pScene, pName);
+	const double lUp = pApexDown ? -1.0 : 1.0;
+
+	FbxVector4 vertex0(-side, 0, side);
+	FbxVector4 vertex1(side, 0, side);
+	FbxVector4 vertex2(side, 0, -side);
+	FbxVector4 vertex3(-side, 0, -side);
+	FbxVector4 vertex4(0, lUp * height, 0);
+
+	FbxVector4 lNormalP0(0, lUp, 0);
+	FbxVector4 lNormalP1(0, lUp * 0.447, 0.894);
+	FbxVector4 lNormalP2(0.894, lUp * 0.447, 0);
+	FbxVector4 lNormalP3(0, lUp * 0.447, -0.894);
+	FbxVector4 lNormalP4(-0.894, lUp * 0.447, 0);
+
+	// Create control points.
+	lMesh->InitControlPoints(16);
+	FbxVector4* lControlPoints = lMesh->GetControlPoints();
+
+	lControlPoints[0] = vertex0;
+	lControlPoints[1] = vertex1;
+	lControlPoints[2] = vertex2;
+	lControlPoints[3] = vertex3;
+	lControlPoints[4] = vertex0;
+	lControlPoints[5] = vertex1;
+	lControlPoints[6] = vertex4;
+	lControlPoints[7] = vertex1;
+	lControlPoints[8] = vertex2;
+	lControlPoints[9] = vertex4;
+	lControlPoints[10] = vertex2;
+	lControlPoints[11] = vertex3;
+	lControlPoints[12] = vertex4;
+	lControlPoints[13] = vertex3;
+	lControlPoints[14] = vertex0;
+	lControlPoints[15] = vertex4;
+
+	// specify normals per control point.
+
+	FbxGeometryElementNormal* lNormalElement = lMesh->CreateElementNormal();
+	lNormalElement->SetMappingMode(FbxGeometryElement::eByControlPoint);
+	lNormalElement->SetReferenceMode(FbxGeometryElement::eDirect);
+
+	lNormalElement->GetDirectArray().Add(lNormalP0);
+	lNormalElement->GetDirectArray().Add(lNormalP0);
+	lNormalElement->GetDirectArray().Add(lNormalP0);
+	lNormalElement->GetDirectArray().Add(lNormalP0);
+	lNormalElement->GetDirectArray().Add(lNormalP1);
+	lNormalElement->GetDirectArray().Add(lNormalP1);
+	lNormalElement->GetDirectArray().Add(lNormalP1);
+	lNormalElement->GetDirectArray().Add(lNormalP2);
+	lNormalElement->GetDirectArray().Add(lNormalP2);
+	lNormalElement->GetDirectArray().Add(lNormalP2);
+	lNormalElement->GetDirectArray().Add(lNormalP3);
+	lNormalElement->GetDirectArray().Add(lNormalP3);
+	lNormalElement->GetDirectArray().Add(lNormalP3);
+	lNormalElement->GetDirectArray().Add(lNormalP4);
+	lNormalElement->GetDirectArray().Add(lNormalP4);
+	lNormalElement->GetDirectArray().Add(lNormalP4);
+
+	// Array of polygon vertices.
+	int lPolygonVertices[] = { 0, 3, 2, 1,
+		4, 5, 6,
+		7, 8, 9,
+		10, 11, 12,
+		13, 14, 15 };
+
+	// Set material mapping.
+	FbxGeometryElementMaterial* lMaterialElement = lMesh->CreateElementMaterial();
+	lMaterialElement->SetMappingMode(FbxGeometryElement::eByPolygon);
+	lMaterialElement->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
+
+	// Create polygons. Assign material indices.
+
+	// Pyramid base.
+	lMesh->BeginPolygon(0); // Material index.
+
+	for (j = 0; j < 4; j++)
+	{
+		lMesh->AddPolygon(lPolygonVertices[j]); // Control point index.
+	}
+
+	lMesh->EndPolygon();
+
+	// Pyramid sides.
+	for (i = 1; i < 5; i++)
+	{
+		lMesh->BeginPolygon(i); // Material index.
+
+		for (j = 0; j < 3; j++)
+		{
+			lMesh->AddPolygon(lPolygonVertices[4 + 3 * (i - 1) + j]); // Control point index.
+		}
+
+		lMesh->EndPolygon();
+	}
+
+	return lMesh;
+}
+
+MeshRegistry::MeshRegistry(FbxScene* pScene)
+	: mScene(pScene), mMaterialsCreated(false)
+{
+	for (int i = 0; i < kPyramidMaterialCount; i++)
+		mMaterials[i] = NULL;
+}
+
+FbxNode* MeshRegistry::CreatePyramid(const char* pName, double pSide, double pHeight, bool pApexDown)
+{
+	FbxMesh* lMesh = NULL;
+	for (size_t i = 0; i < mPyramids.size(); i++)
+	{
+		const Pyramid& lPyramid = mPyramids[i];
+		if (lPyramid.mSide == pSide && lPyramid.mHeight == pHeight && lPyramid.mApexDown == pApexDown)
+		{
+			lMesh = lPyramid.mMesh;
+			break;
+		}
+	}
+	if (!lMesh)
+	{
+		// the first node showing a shape names its mesh
+		Pyramid lPyramid;
+		lPyramid.mSide = pSide;
+		lPyramid.mHeight = pHeight;
+		lPyramid.mApexDown = pApexDown;
+		lPyramid.mMesh = lMesh = CreatePyramidMesh(mScene, pName, pSide, pHeight, pApexDown);
+		mPyramids.push_back(lPyramid);
+	}
+
+	if (!mMaterialsCreated)
+	{
+		CreateMaterials(mScene, mMaterials);
+		mMaterialsCreated = true;
+	}
+
+	FbxNode* lNode = FbxNode::Create(mScene, pName);
+
+	lNode->SetNodeAttribute(lMesh);
+
+	for (int i = 0; i < kPyramidMaterialCount; i++)
+		lNode->AddMaterial(mMaterials[i]);
+
+	return lNode;
+}
+
+// Create a marker to use a point of interest for the camera. 
+FbxNode* CreateMarker(FbxScene* pScene, const char* pName)
+{
+	FbxMarker* lMarker = FbxMarker::Create(pScene, pName);
+
+	FbxNode* lNode = FbxNode::Create(pScene, pName);
+
+	lNode->SetNodeAttribute(lMarker);
+
+	return lNode;
+}
+
+// Set marker default position.
+void SetMarkerDefaultPosition(FbxNode* pMarker, const FbxVector4& rotation)
+{
+	// The marker is positioned above the origin. There is no rotation and no scaling.
+	pMarker->LclTranslation.Set(FbxVector4(0.0, 0.0, 0.0));
+	pMarker->LclRotation.Set(rotation);
+	pMarker->LclScaling.Set(FbxVector4(1.0, 1.0, 1.0));
+}
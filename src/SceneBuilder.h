@@ -0,0 +1,68 @@
+#ifndef _SCENE_BUILDER_H
+#define _SCENE_BUILDER_H
+
+#include "ConversionOptions.h"
+
+#include <fbxsdk.h>
+#include <vector>
+
+struct ConversionStats;
+struct PoseRecording;
+struct TopologyCheck;
+
+// Faces of a pyramid mesh, each with its own material.
+const int kPyramidMaterialCount = 5;
+
+// Create the kPyramidMaterialCount Phong materials of the pyramid faces.
+void CreateMaterials(FbxScene* pScene, FbxSurfacePhong* pMaterials[kPyramidMaterialCount]);
+
+// Create a pyramid mesh with its apex up, or down for pApexDown.
+FbxMesh* CreatePyramidMesh(FbxScene* pScene, const char* pName, const double& side, const double& height, bool pApexDown);
+
+// Meshes and materials shared by the pyramids of one scene: each pyramid
+// shape is a single FbxMesh instanced by every node showing it, and the
+// materials are created once and connected to all of those nodes.
+class MeshRegistry
+{
+public:
+	explicit MeshRegistry(FbxScene* pScene);
+
+	// Node showing the pyramid of the given shape, with the shared materials.
+	FbxNode* CreatePyramid(const char* pName, double pSide, double pHeight, bool pApexDown);
+
+private:
+	struct Pyramid
+	{
+		double mSide;
+		double mHeight;
+		bool mApexDown;
+		FbxMesh* mMesh;
+	};
+
+	FbxScene* mScene;
+	std::vector<Pyramid> mPyramids;
+	FbxSurfacePhong* mMaterials[kPyramidMaterialCount];
+	bool mMaterialsCreated;
+};
+
+// Build the marker hierarchy, the pyramid meshes with their shared
+// materials, the camera and the translation/rotation curves of every device
+// of GetSceneDevices() in pScene. The camera, left and right devices are
+// created without curves if their track is missing. pAnimationOnly leaves
+// out the meshes, materials and camera. With eTopologySingleNode every
+// device is one <Name>Animation node carrying both curves, which expects
+// the rotations of pRecording to have gone through CollapseMarkerRotations.
+// The keys go at the times BuildTimeline() computed for every track; return
+// false if a track has none. Creating the curves is timed in pStats.
+bool CreateScene(FbxManager* pSdkManager, FbxScene* pScene, const PoseRecording& pRecording, ConversionStats& pStats,
+	bool pAnimationOnly = false, EDeviceTopology pTopology = eTopologyMarkerPairs);
+
+// Check pSingle, a scene CreateScene built with eTopologySingleNode, the
+// way an importer sees it: build the marker pairs of pPairs (the recording
+// before CollapseMarkerRotations, with its key times) in a scratch scene
+// and compare EvaluateGlobalTransform() of every <Name>RotationAnimation
+// with that of <Name>Animation at every key. The largest rotation
+// difference goes to pCheck. Return false if the scenes cannot be compared.
+bool CompareTopologies(FbxManager* pSdkManager, FbxScene* pSingle, const PoseRecording& pPairs, TopologyCheck& pCheck);
+
+#endif // #ifndef _SCENE_BUILDER_H
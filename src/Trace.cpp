@@ -0,0 +1,171 @@
+#include "Trace.h"
+
+#include <cstdio>
+
+#ifndef MOTION2FBX_TRACE
+
+bool StartTracing()
+{
+	return false;
+}
+
+void SetTraceThreadName(const std::string&)
+{
+}
+
+bool WriteTrace(const std::string&)
+{
+	return false;
+}
+
+#else
+
+#include "nlohmann/json.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+using json = nlohmann::json;
+
+namespace
+{
+	typedef std::chrono::steady_clock Clock;
+
+	struct TraceEvent
+	{
+		const char* mName;
+		std::string mDetail;
+		int64_t mStart;
+		int64_t mDuration;
+	};
+
+	// Events of one thread. Buffers are never freed, so the events of
+	// threads that have exited are still written.
+	struct ThreadTrace
+	{
+		unsigned mId;
+		std::string mName;
+		std::vector<TraceEvent> mEvents;
+	};
+
+	std::atomic<bool> gTracing(false);
+	Clock::time_point gStart;
+
+	std::mutex gThreadsMutex;
+	std::vector<ThreadTrace*> gThreads;
+
+	thread_local ThreadTrace* tThread = NULL;
+
+	int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - gStart).count();
+	}
+
+	ThreadTrace& GetThreadTrace()
+	{
+		if (!tThread)
+		{
+			std::lock_guard<std::mutex> lLock(gThreadsMutex);
+			tThread = new ThreadTrace;
+			tThread->mId = unsigned(gThreads.size()) + 1;
+			gThreads.push_back(tThread);
+		}
+		return *tThread;
+	}
+}
+
+bool StartTracing()
+{
+	gStart = Clock::now();
+	gTracing = true;
+	return true;
+}
+
+void SetTraceThreadName(const std::string& pName)
+{
+	if (gTracing)
+		GetThreadTrace().mName = pName;
+}
+
+TraceSpan::TraceSpan(const char* pName)
+	: mName(pName), mStart(gTracing ? Now() : -1)
+{
+}
+
+TraceSpan::TraceSpan(const char* pName, const std::string& pDetail)
+	: mName(pName), mStart(gTracing ? Now() : -1)
+{
+	if (mStart >= 0)
+		mDetail = pDetail;
+}
+
+TraceSpan::~TraceSpan()
+{
+	if (mStart < 0)
+		return;
+
+	TraceEvent lEvent;
+	lEvent.mName = mName;
+	lEvent.mDetail.swap(mDetail);
+	lEvent.mStart = mStart;
+	lEvent.mDuration = Now() - mStart;
+	GetThreadTrace().mEvents.push_back(lEvent);
+}
+
+bool WriteTrace(const std::string& pPath)
+{
+	json lEvents = json::array();
+
+	std::lock_guard<std::mutex> lLock(gThreadsMutex);
+	for (size_t t = 0; t < gThreads.size(); t++)
+	{
+		const ThreadTrace& lThread = *gThreads[t];
+		if (!lThread.mName.empty())
+		{
+			json lMetadata = json::object();
+			lMetadata["name"] = "thread_name";
+			lMetadata["ph"] = "M";
+			lMetadata["pid"] = 1;
+			lMetadata["tid"] = lThread.mId;
+			lMetadata["args"] = json::object();
+			lMetadata["args"]["name"] = lThread.mName;
+			lEvents.push_back(lMetadata);
+		}
+
+		for (size_t i = 0; i < lThread.mEvents.size(); i++)
+		{
+			const TraceEvent& lSpan = lThread.mEvents[i];
+			json lEvent = json::object();
+			lEvent["name"] = lSpan.mName;
+			lEvent["ph"] = "X";
+			lEvent["pid"] = 1;
+			lEvent["tid"] = lThread.mId;
+			lEvent["ts"] = lSpan.mStart;
+			lEvent["dur"] = lSpan.mDuration;
+			if (!lSpan.mDetail.empty())
+			{
+				lEvent["args"] = json::object();
+				lEvent["args"]["detail"] = lSpan.mDetail;
+			}
+			lEvents.push_back(lEvent);
+		}
+	}
+
+	json lTrace = json::object();
+	lTrace["traceEvents"] = lEvents;
+	lTrace["displayTimeUnit"] = "ms";
+
+	std::ofstream lFile(pPath.c_str());
+	lFile << lTrace.dump() << "\n";
+	if (!lFile)
+	{
+		printf("Error: Unable to write trace '%s'\n", pPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+#endif // #ifndef MOTION2FBX_TRACE
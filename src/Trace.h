@@ -0,0 +1,59 @@
+#ifndef _TRACE_H
+#define _TRACE_H
+
+#include <string>
+
+// Scoped spans written as Chrome Trace Event JSON (chrome://tracing,
+// ui.perfetto.dev). Spans are only compiled in when MOTION2FBX_TRACE is
+// defined, and only recorded after StartTracing():
+//
+//	TRACE_SPAN("CreateScene");
+//	TRACE_SPAN_DETAIL("AnimateTrack", pTrack.mName);
+//
+// Every thread appends to its own buffer, so a span costs two clock reads
+// and no locking.
+
+// Start recording spans. Return false if tracing is compiled out.
+bool StartTracing();
+
+// Name the calling thread in the trace ("worker 2").
+void SetTraceThreadName(const std::string& pName);
+
+// Write every span recorded so far to pPath. Call it while no traced
+// thread is running.
+bool WriteTrace(const std::string& pPath);
+
+#ifdef MOTION2FBX_TRACE
+
+#include <stdint.h>
+
+// Record the time between construction and destruction as a complete event.
+class TraceSpan
+{
+public:
+	explicit TraceSpan(const char* pName);
+	TraceSpan(const char* pName, const std::string& pDetail);
+	~TraceSpan();
+
+private:
+	TraceSpan(const TraceSpan&);
+	TraceSpan& operator=(const TraceSpan&);
+
+	const char* mName;
+	std::string mDetail;
+	int64_t mStart;		// microseconds, -1 while tracing is off
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SPAN(pName) TraceSpan TRACE_CONCAT(lTraceSpan, __LINE__)(pName)
+#define TRACE_SPAN_DETAIL(pName, pDetail) TraceSpan TRACE_CONCAT(lTraceSpan, __LINE__)(pName, pDetail)
+
+#else
+
+#define TRACE_SPAN(pName)
+#define TRACE_SPAN_DETAIL(pName, pDetail)
+
+#endif // #ifdef MOTION2FBX_TRACE
+
+#endif // #ifndef _TRACE_H
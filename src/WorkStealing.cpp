@@ -0,0 +1,108 @@
+#include "WorkStealing.h"
+
+#include <algorithm>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	struct WorkerQueue
+	{
+		std::mutex mMutex;
+		std::deque<size_t> mJobs;
+		uint64_t mWeight;		// total weight of mJobs
+
+		WorkerQueue() : mWeight(0) {}
+	};
+
+	struct HeavierJob
+	{
+		const std::vector<uint64_t>& mWeights;
+
+		explicit HeavierJob(const std::vector<uint64_t>& pWeights) : mWeights(pWeights) {}
+		bool operator()(size_t a, size_t b) const { return mWeights[a] > mWeights[b]; }
+	};
+
+	bool PopFront(WorkerQueue& pQueue, const std::vector<uint64_t>& pWeights, size_t& pJob)
+	{
+		std::lock_guard<std::mutex> lLock(pQueue.mMutex);
+		if (pQueue.mJobs.empty())
+			return false;
+		pJob = pQueue.mJobs.front();
+		pQueue.mJobs.pop_front();
+		pQueue.mWeight -= pWeights[pJob];
+		return true;
+	}
+
+	// Steal from the queue with the most weight left. Return false once every queue is empty.
+	bool Steal(std::vector<WorkerQueue>& pQueues, const std::vector<uint64_t>& pWeights, size_t& pJob)
+	{
+		for (;;)
+		{
+			size_t lVictim = pQueues.size();
+			uint64_t lMostWeight = 0;
+			bool lAnyJob = false;
+			for (size_t q = 0; q < pQueues.size(); q++)
+			{
+				std::lock_guard<std::mutex> lLock(pQueues[q].mMutex);
+				if (pQueues[q].mJobs.empty())
+					continue;
+				if (!lAnyJob || pQueues[q].mWeight > lMostWeight)
+				{
+					lVictim = q;
+					lMostWeight = pQueues[q].mWeight;
+				}
+				lAnyJob = true;
+			}
+
+			if (!lAnyJob)
+				return false;
+
+			// the victim may have been emptied in the meantime, then look again
+			if (PopFront(pQueues[lVictim], pWeights, pJob))
+				return true;
+		}
+	}
+
+	void Work(std::vector<WorkerQueue>& pQueues, const std::vector<uint64_t>& pWeights, unsigned pWorker,
+		const std::function<void(size_t, unsigned)>& pTask)
+	{
+		size_t lJob;
+		for (;;)
+		{
+			if (!PopFront(pQueues[pWorker], pWeights, lJob) && !Steal(pQueues, pWeights, lJob))
+				return;
+			pTask(lJob, pWorker);
+		}
+	}
+}
+
+void RunWorkStealing(const std::vector<uint64_t>& pWeights, unsigned pWorkerCount,
+	const std::function<void(size_t pJob, unsigned pWorker)>& pTask)
+{
+	if (pWorkerCount == 0)
+		pWorkerCount = 1;
+
+	std::vector<size_t> lOrder(pWeights.size());
+	for (size_t i = 0; i < lOrder.size(); i++)
+		lOrder[i] = i;
+	std::stable_sort(lOrder.begin(), lOrder.end(), HeavierJob(pWeights));
+
+	std::vector<WorkerQueue> lQueues(pWorkerCount);
+	for (size_t i = 0; i < lOrder.size(); i++)
+	{
+		WorkerQueue& lQueue = lQueues[i % pWorkerCount];
+		lQueue.mJobs.push_back(lOrder[i]);
+		lQueue.mWeight += pWeights[lOrder[i]];
+	}
+
+	std::vector<std::thread> lThreads;
+	for (unsigned w = 1; w < pWorkerCount; w++)
+		lThreads.push_back(std::thread(Work, std::ref(lQueues), std::cref(pWeights), w, std::cref(pTask)));
+
+	Work(lQueues, pWeights, 0, pTask);
+
+	for (size_t t = 0; t < lThreads.size(); t++)
+		lThreads[t].join();
+}
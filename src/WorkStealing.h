@@ -0,0 +1,21 @@
+#ifndef _WORK_STEALING_H
+#define _WORK_STEALING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <functional>
+#include <vector>
+
+// Run pTask(job, worker) once for every job on pWorkerCount threads, the
+// calling thread being worker 0.
+//
+// Jobs are sorted by decreasing weight (e.g. input size) and dealt round
+// robin into one deque per worker, so every worker starts with large jobs.
+// A worker takes the front (largest) job of its own deque; once that is
+// empty it steals the front job of the deque with the most weight left.
+// The largest remaining jobs are therefore always started first and no
+// worker sits idle while any job is still queued.
+void RunWorkStealing(const std::vector<uint64_t>& pWeights, unsigned pWorkerCount,
+	const std::function<void(size_t pJob, unsigned pWorker)>& pTask);
+
+#endif // #ifndef _WORK_STEALING_H
@@ -1,563 +1,291 @@
-#include "../Common/Common.h"
-
-using json = nlohmann::json;
-using namespace std;
-
-bool CreateScene(FbxManager* pSdkManager, FbxScene* pScene, json& j);
-
-int main(int argc, char** argv)
-{
-	if (argc < 3)
-	{
-		cout << "usage: " << argv[0] << " <json input> <fbx output> <format>\n";
-		return 0;
-	}
-	
-	int asciiFormat = 0;
-	if (argc == 4 && argv[3] != "")
-		asciiFormat = -1;
-
-	// read the JSON file
-	std::ifstream i(argv[1]);
-	json j;
-	i >> j;
-
-#ifdef DEBUG
-	std::ofstream o("pretty.json");
-	o << std::setw(4) << j << std::endl;
+#include "BatchJobs.h"
+#include "Conversion.h"
+#include "ConversionOptions.h"
+#include "ConversionServer.h"
+#include "ConversionStats.h"
+#include "Trace.h"
+#include "WorkStealing.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+#ifdef _WIN32
+	#include <fcntl.h>
+	#include <io.h>
+#else
+	#include <errno.h>
+	#include <unistd.h>
 #endif
 
-    FbxManager* lSdkManager = NULL;
-    FbxScene* lScene = NULL;
-
-    // Prepare the FBX SDK.
-    InitializeSdkObjects(lSdkManager, lScene);
-
-    // Create the scene.
-    if( !CreateScene(lSdkManager, lScene, j) )
-    {
-        FBXSDK_printf("\n\nAn error occurred while creating the scene...\n");
-        DestroySdkObjects(lSdkManager, false);
-        return 0;
-    }
-
-	const char* lSampleFileName = argv[2];
-	SaveScene(lSdkManager, lScene, lSampleFileName, asciiFormat);
-    // Destroy all objects created by the FBX SDK.
-    DestroySdkObjects(lSdkManager, true);
-
-    return 0;
-}
-
-bool CreateScene(FbxManager* pSdkManager, FbxScene* pScene, json& j)
-{
-	const double CAMERA_MESH_HEIGHT = 20;
-	const double CAMERA_MESH_SIDE = 10;
-	const double HAND_MESH_HEIGHT = 10;
-	const double HAND_MESH_SIDE = 2;
-
-
-    FbxTime lTime;
-    FbxAnimCurveKey key;
-    FbxAnimCurve* lCurve = NULL;
-
-	// create markers
-	FbxNode* lMarkerRoot = CreateMarker(pScene, "Root");
-	FbxNode* lMarkerPosCam = CreateMarker(pScene, "CameraPositionAnimation");
-	FbxNode* lMarkerRotCam = CreateMarker(pScene, "CameraRotationAnimation");
-	FbxNode* lMarkerPosLeft = CreateMarker(pScene, "LeftPositionAnimation");
-	FbxNode* lMarkerRotLeft = CreateMarker(pScene, "LeftRotationAnimation");
-	FbxNode* lMarkerPosRight = CreateMarker(pScene, "RightPositionAnimation");
-	FbxNode* lMarkerRotRight = CreateMarker(pScene, "RightRotationAnimation");
-
-	// set the marker positions
-	SetMarkerDefaultPosition(lMarkerPosCam, FbxVector4(0, 0, 0));
-	SetMarkerDefaultPosition(lMarkerRotCam, FbxVector4(0, 0, 0));
-	SetMarkerDefaultPosition(lMarkerPosLeft, FbxVector4(-160, 180, 90));
-	SetMarkerDefaultPosition(lMarkerRotLeft, FbxVector4(0, 0, 0));
-	SetMarkerDefaultPosition(lMarkerPosRight, FbxVector4(325, -180, -90));
-	SetMarkerDefaultPosition(lMarkerRotRight, FbxVector4(0, 0, 0));
-
-	// create a mesh
-	FbxNode* lMeshCam = CreatePyramidWithMaterials(pScene, "MeshCamera", CAMERA_MESH_SIDE, CAMERA_MESH_HEIGHT);
-	FbxNode* lMeshLeft = CreatePyramidWithMaterials(pScene, "MeshLeft", HAND_MESH_SIDE, HAND_MESH_HEIGHT);
-	FbxNode* lMeshRight = CreatePyramidWithMaterialsRightHand(pScene, "MeshRight", HAND_MESH_SIDE, HAND_MESH_HEIGHT);
-
-	// create a camera
-	FbxNode* lCamera = CreateCamera(pScene, "Camera");
-
-    // Create one animation stack
-    FbxAnimStack* lAnimStack = FbxAnimStack::Create(pScene, "Stack001");
-
-    // this stack animation range is limited
-    lAnimStack->LocalStop = FBXSDK_TIME_ONE_HOUR;
-    lAnimStack->Description = "This is the animation stack description field.";
-
-    // all animation stacks need, at least, one layer.
-    FbxAnimLayer* lAnimLayer = FbxAnimLayer::Create(pScene, "Base Layer");	// the AnimLayer object name is "Base Layer"
-    lAnimStack->AddMember(lAnimLayer);											// add the layer to the stack
-			
-	// set the camera position
-	SetCameraDefaultPosition(lCamera);
-
-	SetMeshDefaultPosition(lMeshCam, FbxVector4(0, 0, -CAMERA_MESH_HEIGHT), FbxVector4(90, 0, 0));
-	SetMeshDefaultPosition(lMeshLeft, FbxVector4(0, 0, 0), FbxVector4(-60, 0, 90));// (-118, 25, 0));
-	SetMeshDefaultPosition(lMeshRight, FbxVector4(0, 0, 0), FbxVector4(-60, 0, 90));// (-118, 25, 0));
-
-	// animate the camera
-	AnimatePosition(lMarkerPosCam, lAnimLayer, j, std::string("camera"));
-	AnimateRotation(lMarkerRotCam, lAnimLayer, j, std::string("camera"));
-	AnimatePosition(lMarkerPosLeft, lAnimLayer, j, std::string("left"));
-	AnimateRotation(lMarkerRotLeft, lAnimLayer, j, std::string("left"));
-	AnimatePosition(lMarkerPosRight, lAnimLayer, j, std::string("right"));
-	AnimateRotation(lMarkerRotRight, lAnimLayer, j, std::string("right"));
-
-	// build a minimum scene graph
-	FbxNode* lRootNode = pScene->GetRootNode();
-	lRootNode->AddChild(lMarkerRoot);
-
-	lMarkerRoot->AddChild(lMarkerPosCam);
-	lMarkerPosCam->AddChild(lMarkerRotCam);
-	lMarkerRotCam->AddChild(lCamera);
-	lMarkerRotCam->AddChild(lMeshCam);
-
-	lMarkerRoot->AddChild(lMarkerPosLeft);
-	lMarkerPosLeft->AddChild(lMarkerRotLeft);
-	lMarkerRotLeft->AddChild(lMeshLeft);
-		
-	lMarkerRoot->AddChild(lMarkerPosRight);
-	lMarkerPosRight->AddChild(lMarkerRotRight);
-	lMarkerRotRight->AddChild(lMeshRight);
-
-	// set camera switcher as the default camera
-	pScene->GetGlobalSettings().SetDefaultCamera((char *)lCamera->GetName());
-
-    return true;
-}
-
-// Create a camera.
-FbxNode* CreateCamera(FbxScene* pScene, char* pName)
-{
-	FbxCamera* lCamera = FbxCamera::Create(pScene, pName);
-
-	// Set camera property for a classic TV projection with aspect ratio 4:3
-	lCamera->SetFormat(FbxCamera::eHD);
-
-	FbxNode* lNode = FbxNode::Create(pScene, pName);
-
-	lNode->SetNodeAttribute(lCamera);
-
-	return lNode;
-}
+using namespace std;
 
+typedef std::chrono::steady_clock Clock;
 
-// Compute the camera position.
-void SetCameraDefaultPosition(FbxNode* pCamera)
+static double SecondsSince(Clock::time_point pStart)
 {
-	// set the initial camera position
-	FbxVector4 lCameraLocation(0.0, 0.0, 0.0);
-	pCamera->LclTranslation.Set(lCameraLocation);
-	pCamera->LclRotation.Set(FbxVector4(0,90,0));
-	pCamera->LclScaling.Set(FbxVector4(100.0, 100.0, 100.0));
+	return std::chrono::duration<double>(Clock::now() - pStart).count();
 }
 
-// Compute the camera position.
-void SetMeshDefaultPosition(FbxNode* pMesh, FbxVector4& location, FbxVector4& rotation)
-{
-	pMesh->LclTranslation.Set(location);
-	pMesh->LclRotation.Set(rotation);
-	pMesh->LclScaling.Set(FbxVector4(1.0, 1.0, 1.0));
-}
+bool ConvertSingle(const ConversionOptions& pOptions);
+bool ConvertBatch(const ConversionOptions& pOptions);
+bool Serve(const ConversionOptions& pOptions);
+unsigned WorkerCount(const ConversionOptions& pOptions, size_t pMaxWorkers);
 
-// Position animation
-void AnimatePosition(FbxNode* pPosition, FbxAnimLayer* pAnimLayer, json& j, std::string& nodeName)
+int main(int argc, char** argv)
 {
-	FbxAnimCurve* lCurve = NULL;
-	FbxTime lTime;
-	int lKeyIndex = 0;
-
-	pPosition->LclTranslation.GetCurveNode(pAnimLayer, true);
-
-	//get first timestamp
-	FbxLongLong lStartTimestamp = 0;
+	ConversionOptions lOptions;
+	if (!ParseConversionOptions(argc, argv, lOptions))
+		return 1;
 
-	// iterate the array
-	for (json::iterator it = j[nodeName]["poses"].begin(); it != j[nodeName]["poses"].end(); ++it) {
-		if (lStartTimestamp == 0)
-			lStartTimestamp = (*it)["timestamp"];
+	// the server decides how to write the file
+	if (lOptions.Connect())
+		return RunConversionClient(lOptions, argc, argv) ? 0 : 1;
 
-		// X translation.
-		float xValue = float((*it)["position"]["x"]) * float(100);
-		lCurve = pPosition->LclTranslation.GetCurve(pAnimLayer, FBXSDK_CURVENODE_COMPONENT_X, true);
-		if (lCurve)
-		{
-			lCurve->KeyModifyBegin();
-
-			lTime.SetMilliSeconds(FbxLongLong((*it)["timestamp"]) - lStartTimestamp);
-			lKeyIndex = lCurve->KeyAdd(lTime);
-			lCurve->KeySet(lKeyIndex, lTime, xValue, FbxAnimCurveDef::eInterpolationLinear);
-
-			lCurve->KeyModifyEnd();
-		}
+#ifdef MOTION2FBX_NO_FBXSDK
+	// built without the FBX SDK: the native writer is all there is
+	lOptions.mNativeWriter = true;
+#endif
 
-		// Y translation.
-		float yValue = float((*it)["position"]["y"]) * float(100);
-		lCurve = pPosition->LclTranslation.GetCurve(pAnimLayer, FBXSDK_CURVENODE_COMPONENT_Y, true);
-		if (lCurve)
+	if (!lOptions.mTraceFile.empty())
+	{
+		if (!StartTracing())
 		{
-			lCurve->KeyModifyBegin();
-
-			lTime.SetMilliSeconds(FbxLongLong((*it)["timestamp"]) - lStartTimestamp);
-			lKeyIndex = lCurve->KeyAdd(lTime);
-			lCurve->KeySet(lKeyIndex, lTime, yValue, FbxAnimCurveDef::eInterpolationLinear);
-
-			lCurve->KeyModifyEnd();
+			printf("Error: --trace needs a build with MOTION2FBX_TRACE defined\n");
+			return 1;
 		}
+		SetTraceThreadName("main");
+	}
 
-		// Z translation.
-		float zValue = float((*it)["position"]["z"]) * float(100);
-		lCurve = pPosition->LclTranslation.GetCurve(pAnimLayer, FBXSDK_CURVENODE_COMPONENT_Z, true);
-		if (lCurve)
-		{
-			lCurve->KeyModifyBegin();
+	bool lResult;
+	if (lOptions.Batch())
+		lResult = ConvertBatch(lOptions);
+	else if (lOptions.Serve())
+		lResult = Serve(lOptions);
+	else
+		lResult = ConvertSingle(lOptions);
 
-			lTime.SetMilliSeconds(FbxLongLong((*it)["timestamp"]) - lStartTimestamp);
-			lKeyIndex = lCurve->KeyAdd(lTime);
-			lCurve->KeySet(lKeyIndex, lTime, zValue, FbxAnimCurveDef::eInterpolationLinear);
+	if (!lOptions.mTraceFile.empty())
+		WriteTrace(lOptions.mTraceFile);
 
-			lCurve->KeyModifyEnd();
-		}
-	}
+    return lResult ? 0 : 1;
 }
 
-void AnimateRotation(FbxNode* pRotation, FbxAnimLayer* pAnimLayer, json& j, std::string& nodeName)
+// Keep the process's stdout for the FBX file and send everything printed,
+// FBX SDK messages included, to stderr. Return the descriptor of the
+// original stdout, or -1 if it cannot be duplicated.
+static int ReserveStdout()
 {
-	FbxAnimCurve* lCurve = NULL;
-	FbxTime lTime;
-	int lKeyIndex = 0;
-
-	pRotation->LclRotation.GetCurveNode(pAnimLayer, true);
-
-	//get first timestamp
-	FbxLongLong lStartTimestamp = 0;
-
-	// iterate the array
-	for (json::iterator it = j[nodeName]["poses"].begin(); it != j[nodeName]["poses"].end(); ++it) {
-		if (lStartTimestamp == 0)
-			lStartTimestamp = (*it)["timestamp"];
-
-		// X rotation.
-		float xValue = float((*it)["rotation"]["x"]);
-		lCurve = pRotation->LclRotation.GetCurve(pAnimLayer, FBXSDK_CURVENODE_COMPONENT_X, true);
-		if (lCurve)
-		{
-			lCurve->KeyModifyBegin();
-
-			lTime.SetMilliSeconds(FbxLongLong((*it)["timestamp"]) - lStartTimestamp);
-			lKeyIndex = lCurve->KeyAdd(lTime);
-			lCurve->KeySet(lKeyIndex, lTime, xValue, FbxAnimCurveDef::eInterpolationLinear);
-
-			lCurve->KeyModifyEnd();
-		}
-
-		// Y rotation.
-		float yValue = float((*it)["rotation"]["y"]);
-		lCurve = pRotation->LclRotation.GetCurve(pAnimLayer, FBXSDK_CURVENODE_COMPONENT_Y, true);
-		if (lCurve)
-		{
-			lCurve->KeyModifyBegin();
-
-			lTime.SetMilliSeconds(FbxLongLong((*it)["timestamp"]) - lStartTimestamp);
-			lKeyIndex = lCurve->KeyAdd(lTime);
-			lCurve->KeySet(lKeyIndex, lTime, yValue, FbxAnimCurveDef::eInterpolationLinear);
-
-			lCurve->KeyModifyEnd();
-		}
-
-		// Z rotation.
-		float zValue = float((*it)["rotation"]["z"]);
-		lCurve = pRotation->LclRotation.GetCurve(pAnimLayer, FBXSDK_CURVENODE_COMPONENT_Z, true);
-		if (lCurve)
-		{
-			lCurve->KeyModifyBegin();
-
-			lTime.SetMilliSeconds(FbxLongLong((*it)["timestamp"]) - lStartTimestamp);
-			lKeyIndex = lCurve->KeyAdd(lTime);
-			lCurve->KeySet(lKeyIndex, lTime, zValue, FbxAnimCurveDef::eInterpolationLinear);
-
-			lCurve->KeyModifyEnd();
-		}
+	fflush(stdout);
+#ifdef _WIN32
+	int lDescriptor = _dup(_fileno(stdout));
+	if (lDescriptor >= 0)
+	{
+		_setmode(lDescriptor, _O_BINARY);
+		_dup2(_fileno(stderr), _fileno(stdout));
 	}
+#else
+	int lDescriptor = dup(STDOUT_FILENO);
+	if (lDescriptor >= 0)
+		dup2(STDERR_FILENO, STDOUT_FILENO);
+#endif
+	return lDescriptor;
 }
 
-// Create materials for pyramid.
-void CreateMaterials(FbxScene* pScene, FbxMesh* pMesh)
+// Write pData to pDescriptor and close it.
+static bool WriteAndClose(int pDescriptor, const std::vector<char>& pData)
 {
-	int i;
-
-	for (i = 0; i < 5; i++)
+	size_t lWritten = 0;
+	while (lWritten < pData.size())
 	{
-		FbxString lMaterialName = "material";
-		FbxString lShadingName = "Phong";
-		lMaterialName += i;
-		FbxDouble3 lBlack(0.0, 0.0, 0.0);
-		FbxDouble3 lRed(1.0, 0.0, 0.0);
-		FbxDouble3 lColor;
-		FbxSurfacePhong *lMaterial = FbxSurfacePhong::Create(pScene, lMaterialName.Buffer());
-
-
-		// Generate primary and secondary colors.
-		lMaterial->Emissive.Set(lBlack);
-		lMaterial->Ambient.Set(lRed);
-		lColor = FbxDouble3(i > 2 ? 1.0 : 0.0,
-			i > 0 && i < 4 ? 1.0 : 0.0,
-			i % 2 ? 0.0 : 1.0);
-		lMaterial->Diffuse.Set(lColor);
-		lMaterial->TransparencyFactor.Set(0.0);
-		lMaterial->ShadingModel.Set(lShadingName);
-		lMaterial->Shininess.Set(0.5);
-
-		//get the node of mesh, add material for it.
-		FbxNode* lNode = pMesh->GetNode();
-		if (lNode)
-			lNode->AddMaterial(lMaterial);
+		size_t lChunk = std::min<size_t>(pData.size() - lWritten, 1 << 30);
+#ifdef _WIN32
+		int lCount = _write(pDescriptor, &pData[lWritten], unsigned(lChunk));
+#else
+		ssize_t lCount = write(pDescriptor, &pData[lWritten], lChunk);
+		if (lCount < 0 && errno == EINTR)
+			continue;
+#endif
+		if (lCount <= 0)
+			break;
+		lWritten += size_t(lCount);
 	}
+
+#ifdef _WIN32
+	bool lClosed = _close(pDescriptor) == 0;
+#else
+	bool lClosed = close(pDescriptor) == 0;
+#endif
+	return lWritten == pData.size() && lClosed;
 }
 
-// Create a pyramid with materials.
-FbxNode* CreatePyramidWithMaterials(FbxScene* pScene, char* pName, const double& side, const double& height)
+// Convert the recording given on the command line. An output of "-" is
+// built in memory and written to stdout once complete: the FBX writers seek
+// back to patch record sizes, which a pipe does not allow.
+bool ConvertSingle(const ConversionOptions& pOptions)
 {
-	int i, j;
-	FbxMesh* lMesh = FbxMesh::Create(pScene, pName);
-
-	FbxVector4 vertex0(-side, 0, side);
-	FbxVector4 vertex1(side, 0, side);
-	FbxVector4 vertex2(side, 0, -side);
-	FbxVector4 vertex3(-side, 0, -side);
-	FbxVector4 vertex4(0, height, 0);
-
-	FbxVector4 lNormalP0(0, 1, 0);
-	FbxVector4 lNormalP1(0, 0.447, 0.894);
-	FbxVector4 lNormalP2(0.894, 0.447, 0);
-	FbxVector4 lNormalP3(0, 0.447, -0.894);
-	FbxVector4 lNormalP4(-0.894, 0.447, 0);
-
-	// Create control points.
-	lMesh->InitControlPoints(16);
-	FbxVector4* lControlPoints = lMesh->GetControlPoints();
-
-	lControlPoints[0] = vertex0;
-	lControlPoints[1] = vertex1;
-	lControlPoints[2] = vertex2;
-	lControlPoints[3] = vertex3;
-	lControlPoints[4] = vertex0;
-	lControlPoints[5] = vertex1;
-	lControlPoints[6] = vertex4;
-	lControlPoints[7] = vertex1;
-	lControlPoints[8] = vertex2;
-	lControlPoints[9] = vertex4;
-	lControlPoints[10] = vertex2;
-	lControlPoints[11] = vertex3;
-	lControlPoints[12] = vertex4;
-	lControlPoints[13] = vertex3;
-	lControlPoints[14] = vertex0;
-	lControlPoints[15] = vertex4;
-
-	// specify normals per control point.
-
-	FbxGeometryElementNormal* lNormalElement = lMesh->CreateElementNormal();
-	lNormalElement->SetMappingMode(FbxGeometryElement::eByControlPoint);
-	lNormalElement->SetReferenceMode(FbxGeometryElement::eDirect);
-
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP1);
-	lNormalElement->GetDirectArray().Add(lNormalP1);
-	lNormalElement->GetDirectArray().Add(lNormalP1);
-	lNormalElement->GetDirectArray().Add(lNormalP2);
-	lNormalElement->GetDirectArray().Add(lNormalP2);
-	lNormalElement->GetDirectArray().Add(lNormalP2);
-	lNormalElement->GetDirectArray().Add(lNormalP3);
-	lNormalElement->GetDirectArray().Add(lNormalP3);
-	lNormalElement->GetDirectArray().Add(lNormalP3);
-	lNormalElement->GetDirectArray().Add(lNormalP4);
-	lNormalElement->GetDirectArray().Add(lNormalP4);
-	lNormalElement->GetDirectArray().Add(lNormalP4);
-
-	// Array of polygon vertices.
-	int lPolygonVertices[] = { 0, 3, 2, 1,
-		4, 5, 6,
-		7, 8, 9,
-		10, 11, 12,
-		13, 14, 15 };
-
-	// Set material mapping.
-	FbxGeometryElementMaterial* lMaterialElement = lMesh->CreateElementMaterial();
-	lMaterialElement->SetMappingMode(FbxGeometryElement::eByPolygon);
-	lMaterialElement->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
-
-	// Create polygons. Assign material indices.
-
-	// Pyramid base.
-	lMesh->BeginPolygon(0); // Material index.
-
-	for (j = 0; j < 4; j++)
+	bool lToStdout = pOptions.mOutput == "-";
+	int lStdout = -1;
+	if (lToStdout && (lStdout = ReserveStdout()) < 0)
 	{
-		lMesh->AddPolygon(lPolygonVertices[j]); // Control point index.
+		printf("Error: Unable to write to stdout\n");
+		return false;
 	}
 
-	lMesh->EndPolygon();
+	std::vector<char> lFbx;
+	ConversionOutput lOutput = lToStdout ? ConversionOutput(lFbx, "stdout") : ConversionOutput(pOptions.mOutput);
 
-	// Pyramid sides.
-	for (i = 1; i < 5; i++)
-	{
-		lMesh->BeginPolygon(i); // Material index.
+	SdkContext lSdk;
+	std::vector<JobResult> lResults(1);
+	bool lResult = ConvertFile(pOptions.mInput, lOutput, pOptions, lSdk, lResults[0]);
 
-		for (j = 0; j < 3; j++)
+	if (lToStdout)
+	{
+		// nothing is written if the conversion failed
+		if (!lResult)
+			lFbx.clear();
+		if (!WriteAndClose(lStdout, lFbx) && lResult)
 		{
-			lMesh->AddPolygon(lPolygonVertices[4 + 3 * (i - 1) + j]); // Control point index.
+			printf("Error: Unable to write the FBX file to stdout\n");
+			lResult = false;
 		}
-
-		lMesh->EndPolygon();
 	}
 
+	if (!pOptions.mStatsFile.empty())
+	{
+		std::vector<ConversionJob> lJobs(1);
+		lJobs[0].mInput = pOptions.mInput;
+		lJobs[0].mOutput = pOptions.mOutput;
+		WriteStatsReport(pOptions.mStatsFile, lJobs, lResults, lResults[0].mSeconds);
+	}
 
-	FbxNode* lNode = FbxNode::Create(pScene, pName);
-
-	lNode->SetNodeAttribute(lMesh);
-
-	CreateMaterials(pScene, lMesh);
-
-	return lNode;
+    // Destroy all objects created by the FBX SDK.
+	lSdk.Release(lResult);
+	return lResult;
 }
 
-FbxNode* CreatePyramidWithMaterialsRightHand(FbxScene* pScene, char* pName, const double& side, const double& height)
+// Threads to run at most pMaxWorkers jobs at a time: --jobs or one per hardware thread.
+unsigned WorkerCount(const ConversionOptions& pOptions, size_t pMaxWorkers)
 {
-	int i, j;
-	FbxMesh* lMesh = FbxMesh::Create(pScene, pName);
-
-	FbxVector4 vertex0(-side, 0, side);
-	FbxVector4 vertex1(side, 0, side);
-	FbxVector4 vertex2(side, 0, -side);
-	FbxVector4 vertex3(-side, 0, -side);
-	FbxVector4 vertex4(0, -height, 0);
-
-	FbxVector4 lNormalP0(0, -1, 0);
-	FbxVector4 lNormalP1(0, -0.447, 0.894);
-	FbxVector4 lNormalP2(0.894, -0.447, 0);
-	FbxVector4 lNormalP3(0, -0.447, -0.894);
-	FbxVector4 lNormalP4(-0.894, -0.447, 0);
-
-	// Create control points.
-	lMesh->InitControlPoints(16);
-	FbxVector4* lControlPoints = lMesh->GetControlPoints();
-
-	lControlPoints[0] = vertex0;
-	lControlPoints[1] = vertex1;
-	lControlPoints[2] = vertex2;
-	lControlPoints[3] = vertex3;
-	lControlPoints[4] = vertex0;
-	lControlPoints[5] = vertex1;
-	lControlPoints[6] = vertex4;
-	lControlPoints[7] = vertex1;
-	lControlPoints[8] = vertex2;
-	lControlPoints[9] = vertex4;
-	lControlPoints[10] = vertex2;
-	lControlPoints[11] = vertex3;
-	lControlPoints[12] = vertex4;
-	lControlPoints[13] = vertex3;
-	lControlPoints[14] = vertex0;
-	lControlPoints[15] = vertex4;
-
-	// specify normals per control point.
-
-	FbxGeometryElementNormal* lNormalElement = lMesh->CreateElementNormal();
-	lNormalElement->SetMappingMode(FbxGeometryElement::eByControlPoint);
-	lNormalElement->SetReferenceMode(FbxGeometryElement::eDirect);
-
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP0);
-	lNormalElement->GetDirectArray().Add(lNormalP1);
-	lNormalElement->GetDirectArray().Add(lNormalP1);
-	lNormalElement->GetDirectArray().Add(lNormalP1);
-	lNormalElement->GetDirectArray().Add(lNormalP2);
-	lNormalElement->GetDirectArray().Add(lNormalP2);
-	lNormalElement->GetDirectArray().Add(lNormalP2);
-	lNormalElement->GetDirectArray().Add(lNormalP3);
-	lNormalElement->GetDirectArray().Add(lNormalP3);
-	lNormalElement->GetDirectArray().Add(lNormalP3);
-	lNormalElement->GetDirectArray().Add(lNormalP4);
-	lNormalElement->GetDirectArray().Add(lNormalP4);
-	lNormalElement->GetDirectArray().Add(lNormalP4);
-
-	// Array of polygon vertices.
-	int lPolygonVertices[] = { 0, 3, 2, 1,
-		4, 5, 6,
-		7, 8, 9,
-		10, 11, 12,
-		13, 14, 15 };
-
-	// Set material mapping.
-	FbxGeometryElementMaterial* lMaterialElement = lMesh->CreateElementMaterial();
-	lMaterialElement->SetMappingMode(FbxGeometryElement::eByPolygon);
-	lMaterialElement->SetReferenceMode(FbxGeometryElement::eIndexToDirect);
-
-	// Create polygons. Assign material indices.
-
-	// Pyramid base.
-	lMesh->BeginPolygon(0); // Material index.
-
-	for (j = 0; j < 4; j++)
-	{
-		lMesh->AddPolygon(lPolygonVertices[j]); // Control point index.
-	}
+	unsigned lWorkers = pOptions.mWorkerCount ? pOptions.mWorkerCount : std::thread::hardware_concurrency();
+	if (lWorkers > pMaxWorkers)
+		lWorkers = unsigned(pMaxWorkers);
+	return lWorkers ? lWorkers : 1;
+}
 
-	lMesh->EndPolygon();
+// Ingest threads per job when pWorkers jobs run at a time, so that they
+// split the cores instead of every job parsing on all of them.
+static unsigned IngestThreadsPerJob(const ConversionOptions& pOptions, unsigned pWorkers)
+{
+	if (pOptions.mIngestThreads)
+		return pOptions.mIngestThreads;
+	unsigned lHardwareThreads = std::thread::hardware_concurrency();
+	return lHardwareThreads > pWorkers ? lHardwareThreads / pWorkers : 1;
+}
 
-	// Pyramid sides.
-	for (i = 1; i < 5; i++)
-	{
-		lMesh->BeginPolygon(i); // Material index.
+// Convert every job of the manifest on a pool of workers, each with its own
+// SDK objects. Jobs are scheduled largest input first with work stealing.
+bool ConvertBatch(const ConversionOptions& pOptions)
+{
+	std::vector<ConversionJob> lJobs;
+	if (!ReadBatchManifest(pOptions.mBatchManifest, lJobs))
+		return false;
 
-		for (j = 0; j < 3; j++)
-		{
-			lMesh->AddPolygon(lPolygonVertices[4 + 3 * (i - 1) + j]); // Control point index.
-		}
+	Clock::time_point lStart = Clock::now();
 
-		lMesh->EndPolygon();
-	}
+	std::vector<uint64_t> lSizes(lJobs.size());
+	for (size_t i = 0; i < lJobs.size(); i++)
+		lSizes[i] = GetFileSize(lJobs[i].mInput);
 
+	unsigned lWorkers = WorkerCount(pOptions, lJobs.size());
 
-	FbxNode* lNode = FbxNode::Create(pScene, pName);
+	ConversionOptions lJobOptions = pOptions;
+	lJobOptions.mIngestThreads = IngestThreadsPerJob(pOptions, lWorkers);
 
-	lNode->SetNodeAttribute(lMesh);
+	std::vector<SdkContext> lContexts(lWorkers);
+	std::vector<JobResult> lResults(lJobs.size());
+	std::mutex lPrintMutex;
+	size_t lFinished = 0;
 
-	CreateMaterials(pScene, lMesh);
+	RunWorkStealing(lSizes, lWorkers, [&](size_t pJob, unsigned pWorker)
+	{
+		SetTraceThreadName("worker " + std::to_string(pWorker));
+		ConvertFile(lJobs[pJob].mInput, ConversionOutput(lJobs[pJob].mOutput), lJobOptions, lContexts[pWorker], lResults[pJob]);
 
-	return lNode;
-}
+		std::lock_guard<std::mutex> lLock(lPrintMutex);
+		PrintJobResult(lFinished++, lJobs.size(), lJobs[pJob], lResults[pJob]);
+	});
 
-// Create a marker to use a point of interest for the camera. 
-FbxNode* CreateMarker(FbxScene* pScene, char* pName)
-{
-	FbxMarker* lMarker = FbxMarker::Create(pScene, pName);
+	double lSetupSeconds = 0.0;
+	for (size_t w = 0; w < lContexts.size(); w++)
+		lSetupSeconds += lContexts[w].mSetupSeconds;
 
-	FbxNode* lNode = FbxNode::Create(pScene, pName);
+	double lTotalSeconds = SecondsSince(lStart);
+	PrintBatchSummary(lResults, lWorkers, lSetupSeconds, lTotalSeconds);
 
-	lNode->SetNodeAttribute(lMarker);
+	if (!pOptions.mStatsFile.empty())
+		WriteStatsReport(pOptions.mStatsFile, lJobs, lResults, lTotalSeconds);
 
-	return lNode;
+	for (size_t i = 0; i < lResults.size(); i++)
+	{
+		if (!lResults[i].mSucceeded)
+			return false;
+	}
+	return true;
 }
 
-// Set marker default position.
-void SetMarkerDefaultPosition(FbxNode* pMarker, const FbxVector4& rotation)
+// Run the conversion daemon. Every worker keeps its SDK objects between
+// requests, so only the first SDK conversion of a worker pays for the setup.
+bool Serve(const ConversionOptions& pOptions)
 {
-	// The marker is positioned above the origin. There is no rotation and no scaling.
-	pMarker->LclTranslation.Set(FbxVector4(0.0, 0.0, 0.0));
-	pMarker->LclRotation.Set(rotation);
-	pMarker->LclScaling.Set(FbxVector4(1.0, 1.0, 1.0));
+	unsigned lWorkers = WorkerCount(pOptions, size_t(-1));
+
+	ConversionOptions lDefaults = pOptions;
+	lDefaults.mServeSocket.clear();
+	lDefaults.mStatsFile.clear();
+	lDefaults.mTraceFile.clear();
+	lDefaults.mIngestThreads = IngestThreadsPerJob(pOptions, lWorkers);
+
+	// every request, for the --stats report written when the server stops
+	std::mutex lServedMutex;
+	std::vector<ConversionJob> lServedJobs;
+	std::vector<JobResult> lServedResults;
+	Clock::time_point lStart = Clock::now();
+
+	std::vector<SdkContext> lContexts(lWorkers);
+#ifndef MOTION2FBX_NO_FBXSDK
+	// set up before the first request rather than while a client waits
+	if (!pOptions.mNativeWriter)
+	{
+		for (size_t w = 0; w < lContexts.size(); w++)
+			InitializeSdk(lContexts[w]);
+	}
+#endif
+
+	bool lResult = RunConversionServer(pOptions.mServeSocket, lWorkers, lDefaults,
+		[&](const ServeRequest& pRequest, unsigned pWorker, JobResult& pResult)
+	{
+		SetTraceThreadName("worker " + std::to_string(pWorker));
+		const ConversionOptions& lOptions = pRequest.mOptions;
+		bool lConverted = pRequest.mData
+			? ConvertBuffer(pRequest.mData, pRequest.mSize, ConversionOutput(lOptions.mOutput), lOptions, lContexts[pWorker], pResult)
+			: ConvertFile(lOptions.mInput, ConversionOutput(lOptions.mOutput), lOptions, lContexts[pWorker], pResult);
+
+		std::vector<ConversionJob> lJob(1);
+		lJob[0].mInput = lOptions.mInput;
+		lJob[0].mOutput = lOptions.mOutput;
+		if (!lOptions.mStatsFile.empty())
+			WriteStatsReport(lOptions.mStatsFile, lJob, std::vector<JobResult>(1, pResult), pResult.mSeconds);
+
+		std::lock_guard<std::mutex> lLock(lServedMutex);
+		lServedJobs.push_back(lJob[0]);
+		lServedResults.push_back(pResult);
+		return lConverted;
+	});
+
+	if (!pOptions.mStatsFile.empty())
+		WriteStatsReport(pOptions.mStatsFile, lServedJobs, lServedResults, SecondsSince(lStart));
+	return lResult;
 }